@@ -16,6 +16,26 @@ int _tmain(int /*argc*/, _TCHAR* /*argv[]*/)
     size_t const numGroups = 16;
     size_t const dimension = numGroups*groupSize;
 
+    // A buffer's ByteWidth is a UINT, and D3D11 limits a buffer to 2 GB
+    // (D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_C_TERM), so check
+    // the size before it is cast.
+    // TODO: To process more elements than that, split them over several
+    // buffers and dispatches.
+    size_t const maxBufferBytes = static_cast<size_t>(
+        D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_C_TERM) << 20;
+    if (dimension > maxBufferBytes / sizeof(float))
+    {
+        printf("%Iu elements don't fit in one buffer\n", dimension);
+        return 1;
+    }
+    UINT const byteWidth = static_cast<UINT>(sizeof(float) * dimension);
+
+    // Dispatch takes at most 65535 groups in each dimension, so the groups
+    // are laid out in rows of groupsX (see kernel.hlsl).
+    UINT const maxGroups = D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION;
+    UINT const groupsX = numGroups < maxGroups ? static_cast<UINT>(numGroups) : maxGroups;
+    UINT const groupsY = static_cast<UINT>((numGroups + groupsX - 1) / groupsX);
+
     // Create a D3D11 device and immediate context. 
     // TODO: The code below uses the default video adapter, with the
     // default set of feature levels.  Please see the MSDN docs if 
@@ -58,7 +78,7 @@ int _tmain(int /*argc*/, _TCHAR* /*argv[]*/)
     inputBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
     inputBufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
     inputBufferDesc.StructureByteStride = sizeof(float);
-    inputBufferDesc.ByteWidth = sizeof(float) * dimension;
+    inputBufferDesc.ByteWidth = byteWidth;
     ID3D11Buffer* xBuffer = nullptr;
     hr = device->CreateBuffer(&inputBufferDesc, NULL, &xBuffer);
     if (FAILED(hr))
@@ -105,7 +125,7 @@ int _tmain(int /*argc*/, _TCHAR* /*argv[]*/)
     outputBufferDesc.CPUAccessFlags = 0;
     outputBufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
     outputBufferDesc.StructureByteStride = sizeof(float);
-    outputBufferDesc.ByteWidth = sizeof(float) * dimension;
+    outputBufferDesc.ByteWidth = byteWidth;
     ID3D11Buffer* zBuffer = nullptr;
     hr = device->CreateBuffer(&outputBufferDesc, NULL, &zBuffer);
     if (FAILED(hr))
@@ -118,7 +138,7 @@ int _tmain(int /*argc*/, _TCHAR* /*argv[]*/)
     D3D11_UNORDERED_ACCESS_VIEW_DESC outputUAVDesc;
     outputUAVDesc.Buffer.FirstElement = 0;        
     outputUAVDesc.Buffer.Flags = 0;            
-    outputUAVDesc.Buffer.NumElements = dimension;
+    outputUAVDesc.Buffer.NumElements = static_cast<UINT>(dimension);
     outputUAVDesc.Format = DXGI_FORMAT_UNKNOWN;    
     outputUAVDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;   
     ID3D11UnorderedAccessView* zBufferUAV;
@@ -137,7 +157,7 @@ int _tmain(int /*argc*/, _TCHAR* /*argv[]*/)
     stagingBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
     stagingBufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
     stagingBufferDesc.StructureByteStride = sizeof(float);
-    stagingBufferDesc.ByteWidth = sizeof(float) * dimension;
+    stagingBufferDesc.ByteWidth = byteWidth;
     ID3D11Buffer* stagingBuffer;
     hr = device->CreateBuffer(&stagingBufferDesc, NULL, &stagingBuffer);
     if (FAILED(hr))
@@ -147,15 +167,23 @@ int _tmain(int /*argc*/, _TCHAR* /*argv[]*/)
     }
 
     // Create a constant buffer (this buffer is used to pass the constant 
-    // value 'a' to the kernel as cbuffer Constants).
+    // value 'a', the number of elements and the number of groups in a row
+    // to the kernel as cbuffer Constants).
+    struct Constants
+    {
+        float a;
+        UINT count;
+        UINT groupsX;
+        UINT padding;
+    };
     D3D11_BUFFER_DESC cbDesc;
     cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
     cbDesc.Usage = D3D11_USAGE_DYNAMIC;  
     cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
     cbDesc.MiscFlags = 0;
-    // Even though the constant buffer only has one float, DX expects
-    // ByteWidth to be a multiple of 4 floats (i.e., one 128-bit register).
-    cbDesc.ByteWidth = sizeof(float)*4;
+    // DX expects ByteWidth to be a multiple of 16 bytes (i.e., one 128-bit
+    // register), hence the padding.
+    cbDesc.ByteWidth = sizeof(Constants);
     ID3D11Buffer* constantBuffer = nullptr;
     hr = device->CreateBuffer( &cbDesc, NULL, &constantBuffer);
     if (FAILED(hr))
@@ -164,11 +192,14 @@ int _tmain(int /*argc*/, _TCHAR* /*argv[]*/)
         return hr;
     }
 
-    // Map the constant buffer and set the constant value 'a'.
+    // Map the constant buffer and set the constants.
     D3D11_MAPPED_SUBRESOURCE mappedResource;
     context->Map(constantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-    float* constants = reinterpret_cast<float*>(mappedResource.pData);
-    constants[0] = a;
+    Constants* constants = reinterpret_cast<Constants*>(mappedResource.pData);
+    constants->a = a;
+    constants->count = static_cast<UINT>(dimension);
+    constants->groupsX = groupsX;
+    constants->padding = 0;
     constants = nullptr;
     context->Unmap(constantBuffer, 0);
 
@@ -228,8 +259,9 @@ int _tmain(int /*argc*/, _TCHAR* /*argv[]*/)
     // Attach the constant buffer
     context->CSSetConstantBuffers(0, 1, &constantBuffer);
 
-    // Execute the shader, in 'numGroups' groups of 'groupSize' threads each.
-    context->Dispatch(numGroups, 1, 1);
+    // Execute the shader, in 'numGroups' groups of 'groupSize' threads each,
+    // in rows of groupsX groups.
+    context->Dispatch(groupsX, groupsY, 1);
 
     // Copy the z buffer to the staging buffer so that we can 
     // retrieve the data for accesss by the CPU.
@@ -249,6 +281,8 @@ int _tmain(int /*argc*/, _TCHAR* /*argv[]*/)
         // NOTE: This comparison assumes the GPU produces *exactly* the 
         // same result as the CPU.  In general, this will not be the case
         // with floating-point calculations.
+        // OpenCL/Verification/Verify.h has a multi-threaded SIMD check
+        // that accepts results within a few ULPs, which also works here.
         float const expected = a*x[i] + y[i];
         if (z[i] != expected)
         {
@@ -3,9 +3,13 @@
 // in the CPU code.
 #define GROUP_SIZE_X 512
 
+// 'count' is the number of elements, and 'groupsX' the number of groups
+// in each row of the dispatch.
 cbuffer Constants
 {
     float a;
+    uint count;
+    uint groupsX;
 };
 
 StructuredBuffer<float> x;
@@ -19,9 +23,16 @@ void saxpy(uint3 threadIDInGroup : SV_GroupThreadID,
     uint3 dispatchThreadID : SV_DispatchThreadID)
 {
     // Compute the index of the element to be processed by this thread.
-    int n = groupID.x*GROUP_SIZE_X + threadIDInGroup.x;
- 
+    // A dispatch holds at most 65535 groups in each dimension, so the
+    // groups are laid out in rows of groupsX.  A uint is enough, as a
+    // buffer holds at most 2 GB.
+    uint n = (groupID.y*groupsX + groupID.x)*GROUP_SIZE_X + threadIDInGroup.x;
+
     // Compute the output value z from input buffers x, y and the constant
-    // value a (which is defined up above in the "Constants" buffer).
-    z[n] = a*x[n] + y[n];
+    // value a (which is defined up above in the "Constants" buffer).  The
+    // last row of groups may run past the end.
+    if (n < count)
+    {
+        z[n] = a*x[n] + y[n];
+    }
 }
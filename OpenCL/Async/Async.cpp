@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include "Async.h"
+
+// What the completion callback needs: the promise to fulfil, and the
+// pooled buffers to give back.
+struct AsyncRuntime::Pending
+{
+    AsyncRuntime* owner;
+    std::promise<cl_int> promise;
+    std::vector<cl_mem> buffers;
+};
+
+Operation::Operation(cl_event event, std::shared_future<cl_int> future)
+    : event_(event, [](cl_event e) { if (e) clReleaseEvent(e); }),
+      future_(std::move(future))
+{
+}
+
+AsyncRuntime::AsyncRuntime(Runtime* runtime)
+    : runtime_(runtime), outstanding_(0)
+{
+}
+
+AsyncRuntime::~AsyncRuntime()
+{
+    // The callbacks refer to this object, so it has to outlive them.
+    waitAll();
+}
+
+void AsyncRuntime::waitAll()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return 0 == outstanding_; });
+}
+
+cl_mem AsyncRuntime::acquireBuffer(size_t size, cl_int* error)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return runtimeAcquireBuffer(runtime_, size, error);
+}
+
+void AsyncRuntime::releaseBuffer(cl_mem buffer)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    runtimeReleaseBuffer(runtime_, buffer);
+}
+
+Operation AsyncRuntime::track(std::unique_lock<std::mutex>& lock, cl_int r,
+                              cl_event event, std::vector<cl_mem> buffers)
+{
+    Pending* pending = new Pending;
+    pending->owner = this;
+    pending->buffers.swap(buffers);
+    std::shared_future<cl_int> future = pending->promise.get_future().share();
+    if (CL_SUCCESS == r)
+        ++ outstanding_;
+
+    // The runtime may run the callback at once, on this thread, if the
+    // event has already completed, and complete() takes the mutex.
+    lock.unlock();
+    if (CL_SUCCESS == r)
+    {
+        // The callback only comes once the commands have been submitted,
+        // which without a flush may not happen until something waits.
+        clFlush(runtime_->queue);
+        r = clSetEventCallback(event, CL_COMPLETE, onComplete, pending);
+        if (CL_SUCCESS != r)
+        {
+            printf("clSetEventCallback failed with return code %d\n", r);
+            lock.lock();
+            -- outstanding_;
+            idle_.notify_all();
+            lock.unlock();
+        }
+    }
+    if (CL_SUCCESS != r)
+    {
+        // Some of the commands may have been enqueued before the failure;
+        // let them finish before their buffers can be reused.
+        clFinish(runtime_->queue);
+        lock.lock();
+        for (cl_mem buffer : pending->buffers)
+        {
+            runtimeReleaseBuffer(runtime_, buffer);
+        }
+        lock.unlock();
+        pending->promise.set_value(r);
+        delete pending;
+    }
+    return Operation(event, future);
+}
+
+void CL_CALLBACK AsyncRuntime::onComplete(cl_event, cl_int status, void* data)
+{
+    Pending* pending = static_cast<Pending*>(data);
+    pending->owner->complete(pending, status);
+}
+
+void AsyncRuntime::complete(Pending* pending, cl_int status)
+{
+    // The status is CL_COMPLETE (which is CL_SUCCESS), or a negative error
+    // code if the command, or one it waited for, failed.
+    pending->promise.set_value(status < 0 ? status : CL_SUCCESS);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (cl_mem buffer : pending->buffers)
+        {
+            runtimeReleaseBuffer(runtime_, buffer);
+        }
+        -- outstanding_;
+        // Notify while holding the lock, so that the destructor can't
+        // finish before this is done with the object.
+        idle_.notify_all();
+    }
+    delete pending;
+}
+
+Operation AsyncRuntime::write(cl_mem buffer, void const* source, size_t size,
+                              std::vector<cl_event> const& waitFor)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cl_event event = 0;
+    cl_int const r = clEnqueueWriteBuffer(runtime_->queue, buffer, CL_FALSE, 0,
+                                          size, source, (cl_uint) waitFor.size(),
+                                          waitFor.empty() ? NULL : waitFor.data(),
+                                          &event);
+    return track(lock, r, event, std::vector<cl_mem>());
+}
+
+Operation AsyncRuntime::read(cl_mem buffer, void* destination, size_t size,
+                             std::vector<cl_event> const& waitFor)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cl_event event = 0;
+    cl_int const r = clEnqueueReadBuffer(runtime_->queue, buffer, CL_FALSE, 0,
+                                         size, destination, (cl_uint) waitFor.size(),
+                                         waitFor.empty() ? NULL : waitFor.data(),
+                                         &event);
+    return track(lock, r, event, std::vector<cl_mem>());
+}
+
+Operation AsyncRuntime::saxpy(float a, cl_mem x, cl_mem y, cl_mem z, size_t count,
+                              std::vector<cl_event> const& waitFor)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cl_event event = 0;
+    cl_int const r = runtimeEnqueueSaxpy(runtime_, a, x, y, z, count,
+                                         (cl_uint) waitFor.size(),
+                                         waitFor.empty() ? NULL : waitFor.data(),
+                                         &event);
+    return track(lock, r, event, std::vector<cl_mem>());
+}
+
+Operation AsyncRuntime::saxpy(float a, float const* x, float const* y, float* z,
+                              size_t count, std::vector<cl_event> const& waitFor)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    size_t const size = count * sizeof(cl_float);
+    std::vector<cl_mem> buffers;
+    cl_int r = CL_SUCCESS;
+    for (int b = 0; b < 3 && CL_SUCCESS == r; ++ b)
+    {
+        cl_mem buffer = runtimeAcquireBuffer(runtime_, size, &r);
+        if (CL_SUCCESS == r)
+            buffers.push_back(buffer);
+    }
+
+    // The runtime's queue is in order, but the commands are chained with
+    // events too, so that the chain holds on a queue that isn't.
+    cl_event written[2] = {0, 0};
+    cl_event computed = 0;
+    cl_event event = 0;
+    cl_uint const waitCount = (cl_uint) waitFor.size();
+    cl_event const* waitList = waitFor.empty() ? NULL : waitFor.data();
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime_->queue, buffers[0], CL_FALSE, 0, size, x,
+                                 waitCount, waitList, &written[0]);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime_->queue, buffers[1], CL_FALSE, 0, size, y,
+                                 waitCount, waitList, &written[1]);
+    if (CL_SUCCESS == r)
+        r = runtimeEnqueueSaxpy(runtime_, a, buffers[0], buffers[1], buffers[2],
+                                count, 2, written, &computed);
+    if (CL_SUCCESS == r)
+        r = clEnqueueReadBuffer(runtime_->queue, buffers[2], CL_FALSE, 0, size, z,
+                                1, &computed, &event);
+    for (cl_event e : written)
+    {
+        if (e)
+            clReleaseEvent(e);
+    }
+    if (computed)
+        clReleaseEvent(computed);
+    return track(lock, r, event, std::move(buffers));
+}
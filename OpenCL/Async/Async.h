@@ -0,0 +1,106 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#include "Runtime.h"
+
+// An asynchronous layer over the Runtime library (see ../Runtime).  Every
+// call enqueues its commands, flushes the queue and returns at once with
+// an Operation.  The Operation holds the event of its last command, which
+// can go into the wait list of later calls so that dependent work is
+// chained on the device, and a future that clSetEventCallback completes
+// with CL_SUCCESS or the (negative) execution status of the command.
+//
+// The calls may be made from any number of threads; enqueueing is
+// serialized with a mutex, and the host thread only blocks if it asks a
+// future for its value before the work is done.
+
+class Operation
+{
+public:
+    Operation() {}
+    Operation(cl_event event, std::shared_future<cl_int> future);
+
+    // The event of the operation's last command, to wait for in later
+    // calls.  Still owned by the Operation.
+    cl_event event() const { return event_.get(); }
+    std::shared_future<cl_int> const& future() const { return future_; }
+
+    // Wait for the operation and return its status.
+    cl_int wait() const { return future_.get(); }
+    bool ready() const
+    {
+        return std::future_status::ready
+            == future_.wait_for(std::chrono::seconds(0));
+    }
+
+private:
+    std::shared_ptr<std::remove_pointer<cl_event>::type> event_;
+    std::shared_future<cl_int> future_;
+};
+
+class AsyncRuntime
+{
+public:
+    // The runtime must outlive the AsyncRuntime, and must not be used
+    // directly while the AsyncRuntime exists.
+    explicit AsyncRuntime(Runtime* runtime);
+    // Waits for every operation to complete.
+    ~AsyncRuntime();
+
+    // Copy 'size' bytes from host memory into a device buffer.  'source'
+    // must stay valid until the operation completes.
+    Operation write(cl_mem buffer, void const* source, size_t size,
+                    std::vector<cl_event> const& waitFor = {});
+
+    // Copy 'size' bytes from a device buffer into host memory.
+    Operation read(cl_mem buffer, void* destination, size_t size,
+                   std::vector<cl_event> const& waitFor = {});
+
+    // z = a*x + y on device buffers.
+    Operation saxpy(float a, cl_mem x, cl_mem y, cl_mem z, size_t count,
+                    std::vector<cl_event> const& waitFor = {});
+
+    // z = a*x + y on host arrays, with device buffers from the runtime's
+    // pool that go back to the pool when the operation completes.  x, y
+    // and z must stay valid until then.
+    Operation saxpy(float a, float const* x, float const* y, float* z,
+                    size_t count, std::vector<cl_event> const& waitFor = {});
+
+    // Take a buffer from the runtime's pool, or give one back.  Give a
+    // buffer back only after the operations that use it have completed.
+    cl_mem acquireBuffer(size_t size, cl_int* error);
+    void releaseBuffer(cl_mem buffer);
+
+    // Wait until every operation has completed.
+    void waitAll();
+
+    AsyncRuntime(AsyncRuntime const&) = delete;
+    AsyncRuntime& operator=(AsyncRuntime const&) = delete;
+
+private:
+    struct Pending;
+    static void CL_CALLBACK onComplete(cl_event event, cl_int status, void* data);
+
+    // Register the completion callback on 'event' (which the Operation
+    // takes ownership of), or complete it at once with 'r' if enqueueing
+    // failed.  Called with mutex_ held by 'lock', which it releases before
+    // making any call that may block or run the callback on this thread.
+    Operation track(std::unique_lock<std::mutex>& lock, cl_int r, cl_event event,
+                    std::vector<cl_mem> buffers);
+    // Called from the callback, which may run on the thread that set it.
+    void complete(Pending* pending, cl_int status);
+
+    Runtime* runtime_;
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    size_t outstanding_;
+};
+
+#endif
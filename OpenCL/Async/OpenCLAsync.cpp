@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "Async.h"
+
+// This sample compares blocking and asynchronous submission of many
+// small saxpy (z=a*x+y) operations, as a service handling requests would
+// issue them.
+//
+// Blocking, each call ends in a blocking clEnqueueReadBuffer, and the
+// host thread sits idle for the whole round trip to the device.
+// Asynchronously, each call returns at once with an Operation whose
+// future is completed from a clSetEventCallback, so one thread keeps many
+// operations in flight and only waits when it needs a result.
+//
+// The sample also chains dependent operations on device buffers through
+// their events, without any host synchronization until the end.
+
+static double now()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Check that results are correct.  Like the Minimal sample, this depends
+// on the computation being exact.
+static bool check(float a, std::vector<float> const& x, std::vector<float> const& y,
+                  std::vector<float> const& z)
+{
+    for (size_t i = 0; i < x.size(); ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                   x[i], a, y[i], z[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLAsync [elements [operations [inFlight]]]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : 1 << 16;
+    int const operations = argc > 2 ? atoi(argv[2]) : 256;
+    int const inFlight = argc > 3 ? atoi(argv[3]) : 16;
+    if (0 == dimension || operations < 1 || inFlight < 1)
+    {
+        printf("Usage: %s [elements [operations [inFlight]]]\n", argv[0]);
+        return 1;
+    }
+
+    RuntimeOptions options;
+    runtimeDefaultOptions(&options);
+    options.kernelPath = "../Runtime/kernel.cl";
+    Runtime runtime;
+    cl_int r = runtimeCreate(&runtime, &options);
+    if (CL_SUCCESS != r)
+        return r;
+
+    // Set values to something easy to verify.  Every operation in flight
+    // needs its own output array.
+    float const a = 2.0f;
+    std::vector<float> x(dimension);
+    std::vector<float> y(dimension);
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+    std::vector<std::vector<float> > z(inFlight, std::vector<float>(dimension));
+
+    // Blocking: one operation at a time.  Warm up the buffer pool first.
+    r = runtimeSaxpy(&runtime, a, x.data(), y.data(), z[0].data(), dimension);
+    double start = now();
+    for (int op = 0; op < operations && CL_SUCCESS == r; ++ op)
+    {
+        r = runtimeSaxpy(&runtime, a, x.data(), y.data(),
+                         z[op % inFlight].data(), dimension);
+    }
+    double const blockingTime = now() - start;
+    if (CL_SUCCESS != r)
+    {
+        printf("runtimeSaxpy failed with return code %d\n", r);
+        return r;
+    }
+    if (!check(a, x, y, z[0]))
+        return 100;
+    printf("Blocking      %4d operations in %9.3f ms, %8.1f operations/s\n",
+           operations, blockingTime * 1e3, operations / blockingTime);
+
+    bool correct = true;
+    {
+        AsyncRuntime async(&runtime);
+
+        // Asynchronous: keep up to inFlight operations going, and only
+        // wait for the oldest one when its output array is needed again.
+        // Apart from that wait, the thread is only busy while submitting,
+        // and is free for other work the rest of the time.
+        std::vector<Operation> slots(inFlight);
+        double submitting = 0.0;
+        start = now();
+        for (int op = 0; op < operations + inFlight && CL_SUCCESS == r; ++ op)
+        {
+            int const slot = op % inFlight;
+            if (slots[slot].future().valid())
+            {
+                r = slots[slot].wait();
+                slots[slot] = Operation();
+                if (CL_SUCCESS == r && !check(a, x, y, z[slot]))
+                    correct = false;
+            }
+            if (op < operations && CL_SUCCESS == r)
+            {
+                double const callStart = now();
+                slots[slot] = async.saxpy(a, x.data(), y.data(), z[slot].data(),
+                                          dimension);
+                submitting += now() - callStart;
+            }
+        }
+        double const asyncTime = now() - start;
+        if (CL_SUCCESS != r)
+        {
+            printf("An asynchronous saxpy failed with return code %d\n", r);
+            return r;
+        }
+        printf("Asynchronous  %4d operations in %9.3f ms, %8.1f operations/s "
+               "(%d in flight, %.0f%% of the time spent submitting)\n",
+               operations, asyncTime * 1e3, operations / asyncTime, inFlight,
+               100.0 * submitting / asyncTime);
+
+        // Chained on the device: w = a*(a*x + y) + y, with the second saxpy
+        // and the read waiting on events rather than on the host.
+        size_t const size = dimension * sizeof(cl_float);
+        cl_mem devX = async.acquireBuffer(size, &r);
+        cl_mem devY = CL_SUCCESS == r ? async.acquireBuffer(size, &r) : 0;
+        cl_mem devZ = CL_SUCCESS == r ? async.acquireBuffer(size, &r) : 0;
+        cl_mem devW = CL_SUCCESS == r ? async.acquireBuffer(size, &r) : 0;
+        if (CL_SUCCESS != r)
+        {
+            printf("Unable to allocate device buffers, return code %d\n", r);
+            return r;
+        }
+        std::vector<float> w(dimension);
+        Operation const writeX = async.write(devX, x.data(), size);
+        Operation const writeY = async.write(devY, y.data(), size);
+        Operation const first = async.saxpy(a, devX, devY, devZ, dimension,
+                                            {writeX.event(), writeY.event()});
+        Operation const second = async.saxpy(a, devZ, devY, devW, dimension,
+                                             {first.event()});
+        Operation const readW = async.read(devW, w.data(), size, {second.event()});
+        r = readW.wait();
+        if (CL_SUCCESS != r)
+        {
+            printf("The chained operations failed with return code %d\n", r);
+            return r;
+        }
+        for (size_t i = 0; i < dimension && correct; ++ i)
+        {
+            float const expected = a*(a*x[i] + y[i]) + y[i];
+            if (w[i] != expected)
+            {
+                printf("Unexpected chained result at element %zu: %f instead of %f\n",
+                       i, w[i], expected);
+                correct = false;
+            }
+        }
+        printf("Chained       write, write, saxpy, saxpy, read with one wait\n");
+
+        async.releaseBuffer(devX);
+        async.releaseBuffer(devY);
+        async.releaseBuffer(devZ);
+        async.releaseBuffer(devW);
+    }
+    if (!correct)
+        return 100;
+    printf("Computation appears to have completed successfully.\n");
+
+    runtimeRelease(&runtime);
+    return 0;
+}
@@ -0,0 +1,507 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <CL/opencl.h>
+
+// This sample chooses the launch configuration of a saxpy (z=a*x+y) by
+// measurement instead of leaving the local size to the runtime.  It times
+// every work-group size the kernel allows, both for the one-element-per-
+// work-item kernel and for a grid-stride kernel with several elements per
+// work-item, and keeps the fastest.
+//
+// Results are saved in a tuning database (a text file), keyed by device,
+// kernel and problem-size bucket, so later runs look the configuration up
+// instead of tuning again.
+
+// The launch configuration for one device, kernel and size bucket.
+typedef struct
+{
+    size_t localSize;
+    // 1 means the saxpy kernel; more means saxpy_strided with a global
+    // size of (elements / itemsPerWorkItem).
+    size_t itemsPerWorkItem;
+    cl_ulong nanoseconds;
+} Tuning;
+
+// The tuning database has one line per entry, with tab-separated fields:
+// device, kernel, size bucket, local size, items per work-item, and the
+// measured time in nanoseconds.
+#define MAX_LINE 2048
+
+// Split a database line into its six fields.  Returns 0 for a malformed
+// line.
+static int splitLine(char* line, char** fields)
+{
+    for (int f = 0; f < 6; ++ f)
+    {
+        fields[f] = line;
+        line += strcspn(line, f < 5 ? "\t" : "\r\n");
+        if (f < 5 && '\t' != *line)
+            return 0;
+        *line++ = 0;
+    }
+    return 1;
+}
+
+static int lookupTuning(char const* path, char const* device,
+                        char const* kernel, int bucket, Tuning* tuning)
+{
+    FILE* file = fopen(path, "r");
+    if (NULL == file)
+    {
+        return 0;
+    }
+    char line[MAX_LINE];
+    char* fields[6];
+    int found = 0;
+    while (!found && NULL != fgets(line, sizeof(line), file))
+    {
+        if (splitLine(line, fields)
+            && 0 == strcmp(fields[0], device)
+            && 0 == strcmp(fields[1], kernel)
+            && atoi(fields[2]) == bucket)
+        {
+            tuning->localSize = (size_t) strtoull(fields[3], NULL, 10);
+            tuning->itemsPerWorkItem = (size_t) strtoull(fields[4], NULL, 10);
+            tuning->nanoseconds = strtoull(fields[5], NULL, 10);
+            // A hand-edited or corrupt entry doesn't count as a hit.
+            found = tuning->localSize > 0 && tuning->itemsPerWorkItem > 0;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+// Add an entry to the database, replacing any entry with the same key.
+// The new database is written to a temporary file and renamed into place,
+// so that a concurrent reader never sees a partial file.
+static int storeTuning(char const* path, char const* device,
+                       char const* kernel, int bucket, Tuning const* tuning)
+{
+    char temporaryPath[1024];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%.1000s.%ld.tmp", path,
+             (long) getpid());
+    FILE* out = fopen(temporaryPath, "w");
+    if (NULL == out)
+    {
+        return 0;
+    }
+    FILE* in = fopen(path, "r");
+    if (NULL != in)
+    {
+        char line[MAX_LINE];
+        char copy[MAX_LINE];
+        char* fields[6];
+        while (NULL != fgets(line, sizeof(line), in))
+        {
+            strcpy(copy, line);
+            if (splitLine(copy, fields)
+                && !(0 == strcmp(fields[0], device)
+                     && 0 == strcmp(fields[1], kernel)
+                     && atoi(fields[2]) == bucket))
+            {
+                fputs(line, out);
+            }
+        }
+        fclose(in);
+    }
+    fprintf(out, "%s\t%s\t%d\t%zu\t%zu\t%llu\n", device, kernel, bucket,
+            tuning->localSize, tuning->itemsPerWorkItem,
+            (unsigned long long) tuning->nanoseconds);
+    if (0 != fclose(out) || 0 != rename(temporaryPath, path))
+    {
+        remove(temporaryPath);
+        return 0;
+    }
+    return 1;
+}
+
+// Run one configuration and return its device time (from event
+// profiling) in *nanoseconds.
+static cl_int launch(cl_command_queue queue, cl_kernel kernel, size_t count,
+                     size_t localSize, size_t itemsPerWorkItem,
+                     cl_ulong* nanoseconds)
+{
+    size_t const workItems = (count + itemsPerWorkItem - 1) / itemsPerWorkItem;
+    size_t const global = (workItems + localSize - 1) / localSize * localSize;
+    cl_event event = 0;
+    cl_int r = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &global,
+                                      &localSize, 0, NULL, &event);
+    if (CL_SUCCESS == r)
+    {
+        r = clWaitForEvents(1, &event);
+    }
+    if (CL_SUCCESS == r && NULL != nanoseconds)
+    {
+        cl_ulong start = 0;
+        cl_ulong end = 0;
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START,
+                                sizeof(start), &start, NULL);
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END,
+                                sizeof(end), &end, NULL);
+        *nanoseconds = end > start ? end - start : 0;
+    }
+    if (event)
+    {
+        clReleaseEvent(event);
+    }
+    return r;
+}
+
+// Time every candidate configuration and return the fastest.  The local
+// sizes tried are the powers of two from the kernel's preferred multiple
+// up to CL_KERNEL_WORK_GROUP_SIZE.
+static cl_int tune(cl_command_queue queue, cl_device_id device,
+                   cl_kernel kernel, cl_kernel stridedKernel, size_t count,
+                   Tuning* best)
+{
+    // TODO: Add or remove candidates here.  More elements per work-item
+    // mean fewer work-groups, which mostly helps CPU devices.
+    size_t const itemCounts[] = {1, 2, 4, 8, 16, 32, 64};
+    int const trials = 3;
+
+    best->nanoseconds = 0;
+    for (size_t c = 0; c < sizeof(itemCounts) / sizeof(itemCounts[0]); ++ c)
+    {
+        size_t const items = itemCounts[c];
+        cl_kernel k = 1 == items ? kernel : stridedKernel;
+
+        size_t maxLocal = 1;
+        size_t preferredMultiple = 1;
+        clGetKernelWorkGroupInfo(k, device, CL_KERNEL_WORK_GROUP_SIZE,
+                                 sizeof(maxLocal), &maxLocal, NULL);
+        clGetKernelWorkGroupInfo(k, device,
+                                 CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+                                 sizeof(preferredMultiple), &preferredMultiple, NULL);
+        size_t local = 1;
+        while (local * 2 <= preferredMultiple)
+            local *= 2;
+
+        for (; local <= maxLocal; local *= 2)
+        {
+            // One untimed run, then the best of a few timed ones.
+            cl_int r = launch(queue, k, count, local, items, NULL);
+            cl_ulong time = 0;
+            for (int t = 0; t < trials && CL_SUCCESS == r; ++ t)
+            {
+                cl_ulong trialTime = 0;
+                r = launch(queue, k, count, local, items, &trialTime);
+                if (0 == t || trialTime < time)
+                    time = trialTime;
+            }
+            if (CL_SUCCESS != r)
+            {
+                // Some configurations may exceed a resource limit; skip
+                // them rather than giving up.
+                printf("  local %5zu x %2zu items: failed with code %d\n",
+                       local, items, r);
+                continue;
+            }
+            printf("  local %5zu x %2zu items: %10.3f ms\n", local, items,
+                   time * 1e-6);
+            if (0 == best->nanoseconds || time < best->nanoseconds)
+            {
+                best->localSize = local;
+                best->itemsPerWorkItem = items;
+                best->nanoseconds = time;
+            }
+        }
+    }
+    return best->nanoseconds ? CL_SUCCESS : CL_INVALID_WORK_GROUP_SIZE;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLAutoTune [elements [retune]]
+    // With "retune" the database entry is ignored and replaced.
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) 1 << 22;
+    int const retune = argc > 2 && 0 == strcmp(argv[2], "retune");
+    if (0 == dimension)
+    {
+        printf("Usage: %s [elements [retune]]\n", argv[0]);
+        return 1;
+    }
+
+    // The database location can be set with OPENCL_TUNING_DB.
+    char const* databasePath = getenv("OPENCL_TUNING_DB");
+    if (NULL == databasePath || 0 == *databasePath)
+        databasePath = "autotune.db";
+
+    // Get the list of platforms.
+    int const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint numPlatforms = 0;
+    cl_int r = clGetPlatformIDs(maxPlatformCount, &platforms[0], &numPlatforms);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: You may want to look at the list of platforms that are
+    // returned, and choose the most appropriate one for your needs.
+    int const platformToUse = 0;
+
+    // Get the devices available for the chosen platform.
+    cl_uint deviceCount = 0;
+    size_t const maxDeviceCount = 8;
+    cl_device_id devices[maxDeviceCount];
+    r = clGetDeviceIDs(platforms[platformToUse], CL_DEVICE_TYPE_ALL,
+                       maxDeviceCount, &devices[0], &deviceCount);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: If you have multiple devices, you may specify which one
+    // you'd like to use by changing this variable.
+    int const deviceToUse = 0;
+    cl_device_id device = devices[deviceToUse];
+
+    cl_context context = clCreateContext(0, 1, &device, NULL, NULL, &r);
+    if (0 == context || CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return value %p and code %d\n",
+               context, r);
+        return r;
+    }
+
+    // Profiling is enabled so that configurations can be timed.
+    cl_command_queue commandQueue = clCreateCommandQueue(context, device,
+                                    CL_QUEUE_PROFILING_ENABLE, &r);
+    if (0 == commandQueue || CL_SUCCESS != r)
+    {
+        printf("clCreateCommandQueue failed with return value %p and code %d\n",
+               commandQueue, r);
+        return r;
+    }
+
+    // Read the kernel source and build it.
+    FILE* kernelFile = fopen("kernel.cl", "rb");
+    if (NULL == kernelFile)
+    {
+        printf("Unable to open kernel source file\n");
+        return 1;
+    }
+    fseek(kernelFile, 0, SEEK_END);
+    long kernelSize = ftell(kernelFile);
+    fseek(kernelFile, 0, SEEK_SET);
+    char* kernelSource = (char*) malloc(kernelSize+1);
+    if (kernelSize != (long) fread(kernelSource, 1, kernelSize, kernelFile))
+    {
+        printf("Unable to read kernel source\n");
+        return 4;
+    }
+    fclose(kernelFile);
+    kernelSource[kernelSize] = 0;
+
+    const char* sourceLines[1] = {kernelSource};
+    cl_program program = clCreateProgramWithSource(context, 1,
+                         &sourceLines[0], NULL, &r);
+    free(kernelSource);
+    kernelSource = NULL;
+    if (0 == program || CL_SUCCESS != r)
+    {
+        printf("clCreateProgramWithSource failed with return value %p and code %d\n",
+               program, r);
+        return r;
+    }
+
+    r = clBuildProgram(program, 0, 0, 0, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("clBuildProgram failed with return value %d; error log:\n", r);
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG,
+                                            sizeof(buildLog), buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            printf("%s\n", buildLog);
+        }
+        return r;
+    }
+
+    cl_kernel kernel = clCreateKernel(program, "saxpy", &r);
+    cl_kernel stridedKernel = 0;
+    if (CL_SUCCESS == r)
+        stridedKernel = clCreateKernel(program, "saxpy_strided", &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateKernel failed with code %d\n", r);
+        return r;
+    }
+
+    // Allocate host memory for input and output vectors, and set values
+    // to something easy to verify.
+    float const a = 2.0f;
+    float* x = (float*) malloc(sizeof(float) * dimension);
+    float* y = (float*) malloc(sizeof(float) * dimension);
+    float* z = (float*) malloc(sizeof(float) * dimension);
+    if (NULL == x || NULL == y || NULL == z)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+        z[i] = - (float) i;
+    }
+
+    cl_mem devXmem = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                    dimension*sizeof(cl_float), x, &r);
+    cl_mem devYmem = 0;
+    cl_mem devZmem = 0;
+    if (CL_SUCCESS == r)
+        devYmem = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                 dimension*sizeof(cl_float), y, &r);
+    if (CL_SUCCESS == r)
+        devZmem = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+                                 dimension*sizeof(cl_float), NULL, &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    // Both kernels take the same arguments.
+    cl_ulong const count = dimension;
+    cl_kernel const both[2] = {kernel, stridedKernel};
+    for (int k = 0; k < 2; ++ k)
+    {
+        clSetKernelArg(both[k], 0, sizeof(cl_mem), &devXmem);
+        clSetKernelArg(both[k], 1, sizeof(cl_mem), &devYmem);
+        clSetKernelArg(both[k], 2, sizeof(cl_mem), &devZmem);
+        clSetKernelArg(both[k], 3, sizeof(cl_float), &a);
+        r = clSetKernelArg(both[k], 4, sizeof(cl_ulong), &count);
+        if (CL_SUCCESS != r)
+        {
+            printf("clSetKernelArg failed with return code %d\n", r);
+            return r;
+        }
+    }
+
+    // The database key: the device and driver, the operation, and the
+    // problem size rounded down to a power of two.
+    char deviceName[256] = "";
+    char driverVersion[256] = "";
+    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(deviceName), deviceName, NULL);
+    clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(driverVersion),
+                    driverVersion, NULL);
+    char deviceKey[600];
+    snprintf(deviceKey, sizeof(deviceKey), "%s | %s", deviceName, driverVersion);
+    for (char* c = deviceKey; *c; ++ c)
+    {
+        if ('\t' == *c || '\n' == *c || '\r' == *c)
+            *c = ' ';
+    }
+    int bucket = 0;
+    while (((size_t) 2 << bucket) <= dimension)
+        ++ bucket;
+
+    Tuning tuning;
+    int hit = !retune && lookupTuning(databasePath, deviceKey, "saxpy", bucket, &tuning);
+    if (hit)
+    {
+        // The kernel may allow smaller work-groups than when it was tuned,
+        // e.g. after a change to its source.
+        size_t maxLocal = 0;
+        clGetKernelWorkGroupInfo(1 == tuning.itemsPerWorkItem ? kernel : stridedKernel,
+                                 device, CL_KERNEL_WORK_GROUP_SIZE,
+                                 sizeof(maxLocal), &maxLocal, NULL);
+        if (tuning.localSize > maxLocal)
+        {
+            printf("Tuning database entry for %s, 2^%d elements has local size "
+                   "%zu, above the kernel's limit of %zu\n", deviceName, bucket,
+                   tuning.localSize, maxLocal);
+            hit = 0;
+        }
+    }
+    if (hit)
+    {
+        printf("Tuning database hit for %s, 2^%d elements\n", deviceName, bucket);
+    }
+    else
+    {
+        printf("Tuning %s for 2^%d elements:\n", deviceName, bucket);
+        r = tune(commandQueue, device, kernel, stridedKernel, dimension, &tuning);
+        if (CL_SUCCESS != r)
+        {
+            printf("No configuration ran successfully\n");
+            return r;
+        }
+        if (!storeTuning(databasePath, deviceKey, "saxpy", bucket, &tuning))
+        {
+            printf("Unable to update the tuning database %s\n", databasePath);
+        }
+    }
+    printf("Using local size %zu with %zu element(s) per work-item "
+           "(%.3f ms when tuned)\n", tuning.localSize,
+           tuning.itemsPerWorkItem, tuning.nanoseconds * 1e-6);
+
+    // The tuning runs left correct results in devZmem; fill it with NaN
+    // first, so that the check below sees only what this run writes.
+    float const sentinel = NAN;
+    r = clEnqueueFillBuffer(commandQueue, devZmem, &sentinel, sizeof(sentinel), 0,
+                            dimension*sizeof(cl_float), 0, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clEnqueueFillBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    // Run with the chosen configuration and copy the results back to host
+    // memory.
+    r = launch(commandQueue, 1 == tuning.itemsPerWorkItem ? kernel : stridedKernel,
+               dimension, tuning.localSize, tuning.itemsPerWorkItem, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("Running the tuned configuration failed with code %d\n", r);
+        return r;
+    }
+    r = clEnqueueReadBuffer(commandQueue, devZmem, CL_TRUE, 0,
+                            dimension*sizeof(cl_float), z, 0, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("clEnqueueReadBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    // Check that results are correct.  Note that the code below
+    // depends on the computation being exact, which may not be the
+    // case for more complicated computations.
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                   x[i], a, y[i], z[i]);
+            return 100;
+        }
+    }
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(x);
+    free(y);
+    free(z);
+
+    // Release device memory, kernels, program, command queue, and context.
+    clReleaseMemObject(devXmem);
+    clReleaseMemObject(devYmem);
+    clReleaseMemObject(devZmem);
+    clReleaseKernel(kernel);
+    clReleaseKernel(stridedKernel);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(commandQueue);
+    clReleaseContext(context);
+
+    return 0;
+}
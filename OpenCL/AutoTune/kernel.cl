@@ -0,0 +1,32 @@
+// These kernels compute z = a*x + y over 'count' elements.
+//
+// saxpy processes one element per work-item.  It checks its bound, so the
+// global size may be rounded up to a multiple of the work-group size.
+
+__kernel void saxpy(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong count)
+{
+    // Get element index n.
+    size_t n = get_global_id(0);
+
+    if (n < count)
+    {
+        z[n] = a*x[n] + y[n];
+    }
+}
+
+// saxpy_strided is a grid-stride loop: each work-item processes elements
+// n, n + global size, n + 2*global size, and so on, so the host can launch
+// fewer work-items than there are elements.  Consecutive work-items still
+// access consecutive elements on every iteration.
+
+__kernel void saxpy_strided(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong count)
+{
+    size_t const stride = get_global_size(0);
+
+    for (size_t n = get_global_id(0); n < count; n += stride)
+    {
+        z[n] = a*x[n] + y[n];
+    }
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Batch.h"
+
+cl_int batchCreate(Batch* batch, Runtime* runtime, cl_uint problemCount,
+                   float const* a, cl_ulong const* offsets,
+                   cl_ulong const* lengths)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->runtime = runtime;
+    batch->problemCount = problemCount;
+    if (0 == problemCount)
+        return CL_INVALID_VALUE;
+
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(runtime, "saxpy_batched", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    size_t workGroupSize = 0;
+    r = clGetKernelWorkGroupInfo(kernel, runtime->device, CL_KERNEL_WORK_GROUP_SIZE,
+                                 sizeof(workGroupSize), &workGroupSize, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clGetKernelWorkGroupInfo failed with return code %d\n", r);
+        return r;
+    }
+    // TODO: Tune the work-group size and the elements per work-item for
+    // your device.  Larger tiles mean fewer work-groups and fewer
+    // problem lookups, smaller ones spread small batches over more
+    // compute units.
+    batch->localSize = workGroupSize < 256 ? workGroupSize : 256;
+    batch->tileSize = 4 * (cl_ulong) batch->localSize;
+
+    // The schedule: where each problem's elements start, and the problem
+    // each work-group starts in.
+    cl_ulong* begins = (cl_ulong*) malloc((problemCount + 1) * sizeof(cl_ulong));
+    if (NULL == begins)
+        return CL_OUT_OF_HOST_MEMORY;
+    begins[0] = 0;
+    for (cl_uint p = 0; p < problemCount; ++ p)
+    {
+        begins[p + 1] = begins[p] + lengths[p];
+    }
+    batch->elementCount = begins[problemCount];
+    batch->groupCount = (size_t) ((batch->elementCount + batch->tileSize - 1)
+                                  / batch->tileSize);
+    size_t const groups = batch->groupCount ? batch->groupCount : 1;
+    cl_uint* groupFirst = (cl_uint*) malloc(groups * sizeof(cl_uint));
+    if (NULL == groupFirst)
+    {
+        free(begins);
+        return CL_OUT_OF_HOST_MEMORY;
+    }
+    groupFirst[0] = 0;
+    cl_uint p = 0;
+    for (size_t g = 0; g < batch->groupCount; ++ g)
+    {
+        // The last problem that starts at or before the tile, which (as
+        // the tile is not past the end) is the one its first element is in.
+        cl_ulong const tileStart = g * batch->tileSize;
+        while (p + 1 < problemCount && begins[p + 1] <= tileStart)
+            ++ p;
+        groupFirst[g] = p;
+    }
+
+    cl_context const context = runtime->context;
+    cl_mem_flags const flags = CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR;
+    batch->a = clCreateBuffer(context, flags, problemCount * sizeof(cl_float),
+                              (void*) a, &r);
+    if (CL_SUCCESS == r)
+        batch->offsets = clCreateBuffer(context, flags, problemCount * sizeof(cl_ulong),
+                                        (void*) offsets, &r);
+    if (CL_SUCCESS == r)
+        batch->begins = clCreateBuffer(context, flags,
+                                       (problemCount + 1) * sizeof(cl_ulong), begins, &r);
+    if (CL_SUCCESS == r)
+        batch->groupFirst = clCreateBuffer(context, flags, groups * sizeof(cl_uint),
+                                           groupFirst, &r);
+    free(begins);
+    free(groupFirst);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateBuffer failed with return code %d\n", r);
+        batchRelease(batch);
+    }
+    return r;
+}
+
+void batchRelease(Batch* batch)
+{
+    if (batch->a)
+        clReleaseMemObject(batch->a);
+    if (batch->offsets)
+        clReleaseMemObject(batch->offsets);
+    if (batch->begins)
+        clReleaseMemObject(batch->begins);
+    if (batch->groupFirst)
+        clReleaseMemObject(batch->groupFirst);
+    memset(batch, 0, sizeof(*batch));
+}
+
+cl_int batchEnqueueSaxpy(Batch* batch, cl_mem x, cl_mem y, cl_mem z,
+                         cl_uint waitCount, cl_event const* waitList,
+                         cl_event* event)
+{
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(batch->runtime, "saxpy_batched", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    if (0 == batch->groupCount)
+    {
+        // Nothing to compute, but the caller may want an event.
+        return clEnqueueMarkerWithWaitList(batch->runtime->queue, waitCount,
+                                           waitList, event);
+    }
+
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &x);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &y);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &z);
+    clSetKernelArg(kernel, 3, sizeof(cl_mem), &batch->a);
+    clSetKernelArg(kernel, 4, sizeof(cl_mem), &batch->offsets);
+    clSetKernelArg(kernel, 5, sizeof(cl_mem), &batch->begins);
+    clSetKernelArg(kernel, 6, sizeof(cl_mem), &batch->groupFirst);
+    clSetKernelArg(kernel, 7, sizeof(cl_ulong), &batch->tileSize);
+    clSetKernelArg(kernel, 8, sizeof(cl_ulong), &batch->elementCount);
+    size_t const global = batch->groupCount * batch->localSize;
+    size_t const local = batch->localSize;
+    return clEnqueueNDRangeKernel(batch->runtime->queue, kernel, 1, NULL,
+                                  &global, &local, waitCount, waitList, event);
+}
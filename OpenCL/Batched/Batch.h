@@ -0,0 +1,56 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "Runtime.h"
+
+// Many independent saxpy problems, z = a[p]*x + y over a range of shared
+// x, y and z arenas for each problem p, run in a single kernel launch
+// instead of one launch per problem.  Uses a Runtime (see ../Runtime)
+// created with this directory's kernel.cl.
+//
+// batchCreate takes the layout of the problems (their offsets and
+// lengths in the arenas, and their 'a') and uploads it together with a
+// schedule that gives every work-group the same number of elements.  The
+// same Batch can then be run on any arenas with that layout.  Problems
+// must not overlap in z, and must lie within the arenas; neither is
+// checked.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    Runtime* runtime;
+    // The work-group size, and the elements each work-group handles.
+    size_t localSize;
+    cl_ulong tileSize;
+    size_t groupCount;
+    cl_uint problemCount;
+    // The total number of elements over all problems.
+    cl_ulong elementCount;
+    // Per problem: a, offset in the arenas, and the number of elements
+    // before it (with the total at the end).  Per work-group: the problem
+    // of its first element.
+    cl_mem a;
+    cl_mem offsets;
+    cl_mem begins;
+    cl_mem groupFirst;
+} Batch;
+
+// Set up a batch of 'problemCount' problems.  The arrays are copied.
+cl_int batchCreate(Batch* batch, Runtime* runtime, cl_uint problemCount,
+                   float const* a, cl_ulong const* offsets,
+                   cl_ulong const* lengths);
+void batchRelease(Batch* batch);
+
+// Enqueue z = a[p]*x + y for every problem p, without waiting for it.
+cl_int batchEnqueueSaxpy(Batch* batch, cl_mem x, cl_mem y, cl_mem z,
+                         cl_uint waitCount, cl_event const* waitList,
+                         cl_event* event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
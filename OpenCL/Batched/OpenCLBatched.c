@@ -0,0 +1,242 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Batch.h"
+
+// This sample runs batches of many short, independent saxpy problems
+// (z = a[p]*x + y, each problem with its own a), stored one after another
+// in shared x, y and z arenas.
+//
+// Launching a kernel per problem, as the Minimal sample does for its one
+// problem, is dominated by the cost of the launches when the problems are
+// short.  The batched kernel (see Batch.h) runs every problem of a batch
+// in one launch.  The sample times both, for batches of increasing size,
+// and checks the results of each.
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int compareDoubles(void const* a, void const* b)
+{
+    double const x = *(double const*) a;
+    double const y = *(double const*) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Enqueue one launch per problem, and wait for them.
+static cl_int runLoop(Runtime* runtime, cl_uint problemCount, float const* a,
+                      cl_ulong const* offsets, cl_ulong const* lengths,
+                      cl_mem x, cl_mem y, cl_mem z)
+{
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(runtime, "saxpy_range", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &x);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &y);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &z);
+    for (cl_uint p = 0; p < problemCount && CL_SUCCESS == r; ++ p)
+    {
+        if (0 == lengths[p])
+            continue;
+        size_t const global = (size_t) lengths[p];
+        clSetKernelArg(kernel, 3, sizeof(cl_float), &a[p]);
+        clSetKernelArg(kernel, 4, sizeof(cl_ulong), &offsets[p]);
+        clSetKernelArg(kernel, 5, sizeof(cl_ulong), &lengths[p]);
+        r = clEnqueueNDRangeKernel(runtime->queue, kernel, 1, NULL, &global, NULL,
+                                   0, NULL, NULL);
+    }
+    if (CL_SUCCESS == r)
+        r = clFinish(runtime->queue);
+    return r;
+}
+
+// Clear z, run the batch one way or the other, and check every problem.
+// Each a is a power of two, so the results are exact whether or not the
+// device fuses the multiply and add.
+static cl_int runAndCheck(Runtime* runtime, Batch* batch, int batched,
+                          cl_uint problemCount, float const* a,
+                          cl_ulong const* offsets, cl_ulong const* lengths,
+                          float const* x, float const* y, float* z,
+                          cl_mem devX, cl_mem devY, cl_mem devZ,
+                          size_t arenaSize, int repeats, double* times,
+                          int* failed)
+{
+    memset(z, 0, arenaSize);
+    cl_int r = clEnqueueWriteBuffer(runtime->queue, devZ, CL_TRUE, 0, arenaSize, z,
+                                    0, NULL, NULL);
+    for (int t = 0; t < repeats && CL_SUCCESS == r; ++ t)
+    {
+        double const start = now();
+        if (batched)
+        {
+            r = batchEnqueueSaxpy(batch, devX, devY, devZ, 0, NULL, NULL);
+            if (CL_SUCCESS == r)
+                r = clFinish(runtime->queue);
+        }
+        else
+        {
+            r = runLoop(runtime, problemCount, a, offsets, lengths, devX, devY, devZ);
+        }
+        times[t] = now() - start;
+    }
+    if (CL_SUCCESS == r)
+        r = clEnqueueReadBuffer(runtime->queue, devZ, CL_TRUE, 0, arenaSize, z,
+                                0, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("Running the %s saxpy failed with return code %d\n",
+               batched ? "batched" : "per-problem", r);
+        return r;
+    }
+    for (cl_uint p = 0; p < problemCount && !*failed; ++ p)
+    {
+        for (cl_ulong i = offsets[p]; i < offsets[p] + lengths[p]; ++ i)
+        {
+            if (x[i]*a[p] + y[i] != z[i])
+            {
+                printf("Unexpected result in problem %u at element %llu:\n",
+                       p, (unsigned long long) i);
+                printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                       x[i], a[p], y[i], z[i]);
+                *failed = 1;
+                break;
+            }
+        }
+    }
+    return CL_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLBatched [max-problems [max-length [repeats]]]
+    cl_uint const maxProblems = argc > 1 ? (cl_uint) strtoul(argv[1], NULL, 10) : 16384;
+    cl_ulong const maxLength = argc > 2 ? strtoull(argv[2], NULL, 10) : 2048;
+    int const repeats = argc > 3 ? atoi(argv[3]) : 10;
+    if (0 == maxProblems || 0 == maxLength || repeats < 1)
+    {
+        printf("Usage: %s [max-problems [max-length [repeats]]]\n", argv[0]);
+        return 1;
+    }
+
+    Runtime runtime;
+    cl_int r = runtimeCreate(&runtime, NULL);
+    if (CL_SUCCESS != r)
+        return r;
+
+    // Problem lengths are drawn from 1 to maxLength (with a fixed seed, so
+    // that runs are comparable), and the problems are packed one after
+    // another.  The a values cycle through powers of two.
+    static float const aValues[4] = {0.5f, 1.0f, 2.0f, 4.0f};
+    float* a = (float*) malloc(maxProblems * sizeof(float));
+    cl_ulong* offsets = (cl_ulong*) malloc(maxProblems * sizeof(cl_ulong));
+    cl_ulong* lengths = (cl_ulong*) malloc(maxProblems * sizeof(cl_ulong));
+    double* times = (double*) malloc(sizeof(double) * repeats);
+    if (NULL == a || NULL == offsets || NULL == lengths || NULL == times)
+    {
+        printf("Unable to allocate host memory for %u problems\n", maxProblems);
+        return 1;
+    }
+    unsigned seed = 12345;
+    cl_ulong arenaElements = 0;
+    for (cl_uint p = 0; p < maxProblems; ++ p)
+    {
+        seed = seed * 1103515245u + 12345u;
+        a[p] = aValues[p % 4];
+        offsets[p] = arenaElements;
+        lengths[p] = 1 + (seed >> 8) % maxLength;
+        arenaElements += lengths[p];
+    }
+
+    // The arenas hold every problem of the largest batch; smaller batches
+    // use the problems at the start.
+    size_t const arenaSize = (size_t) arenaElements * sizeof(cl_float);
+    float* x = (float*) malloc(arenaSize);
+    float* y = (float*) malloc(arenaSize);
+    float* z = (float*) malloc(arenaSize);
+    if (NULL == x || NULL == y || NULL == z)
+    {
+        printf("Unable to allocate host memory for %llu elements\n",
+               (unsigned long long) arenaElements);
+        return 1;
+    }
+    for (size_t i = 0; i < arenaElements; ++ i)
+    {
+        x[i] = (float) (i % 65536);
+        y[i] = 100 - (float) (i % 65536);
+    }
+    cl_mem devX = runtimeAcquireBuffer(&runtime, arenaSize, &r);
+    cl_mem devY = 0;
+    cl_mem devZ = 0;
+    if (CL_SUCCESS == r)
+        devY = runtimeAcquireBuffer(&runtime, arenaSize, &r);
+    if (CL_SUCCESS == r)
+        devZ = runtimeAcquireBuffer(&runtime, arenaSize, &r);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime.queue, devX, CL_TRUE, 0, arenaSize, x, 0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime.queue, devY, CL_TRUE, 0, arenaSize, y, 0, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("Unable to set up device buffers, return code %d\n", r);
+        return r;
+    }
+
+    printf("Problems of 1 to %llu elements; median of %d runs\n",
+           (unsigned long long) maxLength, repeats);
+    printf("%9s %11s %13s %13s %9s\n",
+           "problems", "elements", "loop ms", "batched ms", "speedup");
+    int failed = 0;
+    for (cl_uint problems = maxProblems < 16 ? maxProblems : 16; ;
+         problems = problems * 4 < maxProblems ? problems * 4 : maxProblems)
+    {
+        Batch batch;
+        r = batchCreate(&batch, &runtime, problems, a, offsets, lengths);
+        if (CL_SUCCESS != r)
+            return r;
+
+        double medians[2];
+        for (int batched = 0; batched < 2 && CL_SUCCESS == r; ++ batched)
+        {
+            r = runAndCheck(&runtime, &batch, batched, problems, a, offsets, lengths,
+                            x, y, z, devX, devY, devZ, arenaSize, repeats, times,
+                            &failed);
+            qsort(times, repeats, sizeof(double), compareDoubles);
+            medians[batched] = times[repeats / 2];
+        }
+        if (CL_SUCCESS != r)
+            return r;
+        printf("%9u %11llu %13.3f %13.3f %8.2fx\n", problems,
+               (unsigned long long) batch.elementCount, medians[0] * 1e3,
+               medians[1] * 1e3, medians[1] > 0 ? medians[0] / medians[1] : 0.0);
+        batchRelease(&batch);
+        if (problems == maxProblems)
+            break;
+    }
+    if (failed)
+        return 100;
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(a);
+    free(offsets);
+    free(lengths);
+    free(times);
+    free(x);
+    free(y);
+    free(z);
+
+    // Give the buffers back and release everything.
+    runtimeReleaseBuffer(&runtime, devX);
+    runtimeReleaseBuffer(&runtime, devY);
+    runtimeReleaseBuffer(&runtime, devZ);
+    runtimeRelease(&runtime);
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+// Kernels for many independent saxpy problems (z = a*x + y), each with
+// its own 'a', stored one after another in shared x, y and z arenas.
+
+// One problem: elements [offset, offset + count) of the arenas.  This is
+// what a loop with one launch per problem uses.
+__kernel void saxpy_range(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong offset, ulong count)
+{
+    size_t n = get_global_id(0);
+
+    if (n < count)
+    {
+        size_t const i = offset + n;
+        z[i] = a*x[i] + y[i];
+    }
+}
+
+// Every problem in one launch.  The problems' elements are numbered one
+// after another (problem p's are [begins[p], begins[p+1])), and each
+// work-group takes the next 'tileSize' of them, whichever problems they
+// belong to.  So every work-group has the same amount of work: short
+// problems share a work-group, and long ones are spread over several.
+// groupFirst[g] is the problem of work-group g's first element; the
+// work-items walk forward from it as their elements cross into the next
+// problems.
+__kernel void saxpy_batched(__global float const* x, __global float const* y,
+    __global float* z, __global float const* a, __global ulong const* offsets,
+    __global ulong const* begins, __global uint const* groupFirst,
+    ulong tileSize, ulong total)
+{
+    ulong const tileStart = get_group_id(0) * tileSize;
+    ulong const tileEnd = min(tileStart + tileSize, total);
+
+    uint p = groupFirst[get_group_id(0)];
+    ulong begin = begins[p];
+    ulong end = begins[p + 1];
+    for (ulong e = tileStart + get_local_id(0); e < tileEnd; e += get_local_size(0))
+    {
+        // Skip to the problem of element e (past any empty ones).
+        while (e >= end)
+        {
+            ++ p;
+            begin = end;
+            end = begins[p + 1];
+        }
+        ulong const i = offsets[p] + (e - begin);
+        z[i] = a[p]*x[i] + y[i];
+    }
+}
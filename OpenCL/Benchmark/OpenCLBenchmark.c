@@ -0,0 +1,882 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <CL/opencl.h>
+
+// This sample times the saxpy from the Minimal sample with OpenCL event
+// profiling.  It sweeps the vector size and the work-group size, repeats
+// every point a number of times after some warmup iterations, and writes
+// the median and 99th percentile of the upload, kernel and readback times
+// (plus the effective bandwidth of each) as CSV or JSON.
+//
+// Each point can also be run with host-visible buffers instead of copies
+// (see MemoryMode), in which case the time saved against the copying
+// path is reported as well.
+
+// How x, y and z get between host and device memory.
+typedef enum
+{
+    // Buffers in device memory; x and y are written with
+    // clEnqueueWriteBuffer and z read with clEnqueueReadBuffer, as in the
+    // Minimal sample.
+    MEMORY_COPY,
+    // Buffers created with CL_MEM_USE_HOST_PTR over the page-aligned host
+    // arrays, and accessed by mapping them.  On integrated GPUs and CPU
+    // devices the kernel works on the host arrays directly.
+    MEMORY_USE_HOST,
+    // Buffers created with CL_MEM_ALLOC_HOST_PTR, so the driver allocates
+    // host-accessible (usually pinned) memory, and accessed by mapping
+    // them.
+    MEMORY_ALLOC_HOST,
+    MEMORY_MODE_COUNT
+} MemoryMode;
+
+static char const* const memoryModeNames[MEMORY_MODE_COUNT] =
+{
+    "copy", "use-host", "alloc-host"
+};
+
+// Command line options; see usage() for a description of each.
+typedef struct
+{
+    int platformToUse;
+    int deviceToUse;
+    cl_device_type deviceType;
+    size_t minBytes;
+    size_t maxBytes;
+    size_t localSizes[32];
+    int localSizeCount;
+    int memoryModes[MEMORY_MODE_COUNT];
+    int warmup;
+    int repeats;
+    int json;
+    char const* outputPath;
+} Options;
+
+// Timings (in nanoseconds) of every repeat of a single sweep point.
+typedef struct
+{
+    cl_ulong* upload;
+    cl_ulong* kernel;
+    cl_ulong* readback;
+    cl_ulong* total;
+} Timings;
+
+static void usage(char const* program)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --platform=N      platform index (default 0)\n"
+        "  --device=N        device index within the platform (default 0)\n"
+        "  --type=T          device type: all, cpu, gpu or accelerator (default all)\n"
+        "  --min-bytes=S     smallest vector size in bytes (default 4K)\n"
+        "  --max-bytes=S     largest vector size in bytes (default: 1/8 of device memory)\n"
+        "  --local=N[,N...]  work-group sizes to try; 0 lets the runtime choose\n"
+        "                    (default: 0 and every power of two the kernel allows)\n"
+        "  --memory=M[,M...] memory modes: copy, use-host, alloc-host or all\n"
+        "                    (default copy)\n"
+        "  --warmup=N        untimed iterations per point (default 2)\n"
+        "  --repeat=N        timed iterations per point (default 10)\n"
+        "  --format=F        csv or json (default csv)\n"
+        "  --output=FILE     write results to FILE instead of stdout\n"
+        "Sizes may have a K, M or G suffix.\n",
+        program);
+}
+
+// Parse a byte count such as "4096", "64K" or "1G".
+static int parseSize(char const* text, size_t* size)
+{
+    char* end = NULL;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text)
+    {
+        return 0;
+    }
+    switch (*end)
+    {
+    case 'k': case 'K': value <<= 10; ++ end; break;
+    case 'm': case 'M': value <<= 20; ++ end; break;
+    case 'g': case 'G': value <<= 30; ++ end; break;
+    }
+    if (*end != 0)
+    {
+        return 0;
+    }
+    *size = (size_t) value;
+    return 1;
+}
+
+static int parseOptions(int argc, char** argv, Options* options)
+{
+    memset(options, 0, sizeof(*options));
+    options->deviceType = CL_DEVICE_TYPE_ALL;
+    options->minBytes = 4 << 10;
+    options->memoryModes[MEMORY_COPY] = 1;
+    options->warmup = 2;
+    options->repeats = 10;
+
+    for (int i = 1; i < argc; ++ i)
+    {
+        char const* arg = argv[i];
+        char const* value = strchr(arg, '=');
+        value = value ? value + 1 : "";
+
+        if (0 == strncmp(arg, "--platform=", 11))
+        {
+            options->platformToUse = atoi(value);
+        }
+        else if (0 == strncmp(arg, "--device=", 9))
+        {
+            options->deviceToUse = atoi(value);
+        }
+        else if (0 == strncmp(arg, "--type=", 7))
+        {
+            if (0 == strcmp(value, "all"))
+                options->deviceType = CL_DEVICE_TYPE_ALL;
+            else if (0 == strcmp(value, "cpu"))
+                options->deviceType = CL_DEVICE_TYPE_CPU;
+            else if (0 == strcmp(value, "gpu"))
+                options->deviceType = CL_DEVICE_TYPE_GPU;
+            else if (0 == strcmp(value, "accelerator"))
+                options->deviceType = CL_DEVICE_TYPE_ACCELERATOR;
+            else
+                return 0;
+        }
+        else if (0 == strncmp(arg, "--min-bytes=", 12))
+        {
+            if (!parseSize(value, &options->minBytes))
+                return 0;
+        }
+        else if (0 == strncmp(arg, "--max-bytes=", 12))
+        {
+            if (!parseSize(value, &options->maxBytes))
+                return 0;
+        }
+        else if (0 == strncmp(arg, "--local=", 8))
+        {
+            char* end = NULL;
+            options->localSizeCount = 0;
+            do
+            {
+                if (options->localSizeCount == 32)
+                    return 0;
+                options->localSizes[options->localSizeCount++] =
+                    (size_t) strtoul(value, &end, 10);
+                value = end + 1;
+            } while (*end == ',');
+            if (*end != 0)
+                return 0;
+        }
+        else if (0 == strncmp(arg, "--memory=", 9))
+        {
+            memset(options->memoryModes, 0, sizeof(options->memoryModes));
+            while (*value)
+            {
+                size_t const length = strcspn(value, ",");
+                int found = 0;
+                for (int m = 0; m < MEMORY_MODE_COUNT; ++ m)
+                {
+                    if ((length == 3 && 0 == strncmp(value, "all", 3))
+                        || (length == strlen(memoryModeNames[m])
+                            && 0 == strncmp(value, memoryModeNames[m], length)))
+                    {
+                        options->memoryModes[m] = 1;
+                        found = 1;
+                    }
+                }
+                if (!found)
+                    return 0;
+                value += length;
+                if (',' == *value)
+                    ++ value;
+            }
+        }
+        else if (0 == strncmp(arg, "--warmup=", 9))
+        {
+            options->warmup = atoi(value);
+        }
+        else if (0 == strncmp(arg, "--repeat=", 9))
+        {
+            options->repeats = atoi(value);
+        }
+        else if (0 == strncmp(arg, "--format=", 9))
+        {
+            if (0 == strcmp(value, "json"))
+                options->json = 1;
+            else if (0 == strcmp(value, "csv"))
+                options->json = 0;
+            else
+                return 0;
+        }
+        else if (0 == strncmp(arg, "--output=", 9))
+        {
+            options->outputPath = value;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    return options->repeats > 0 && options->warmup >= 0
+        && options->minBytes >= sizeof(cl_float);
+}
+
+// Read a whole text file into a null-terminated, malloc'd string.
+static char* loadSource(char const* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (NULL == file)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* source = (char*) malloc(size + 1);
+    if (NULL != source && (size_t) size != fread(source, 1, size, file))
+    {
+        free(source);
+        source = NULL;
+    }
+    fclose(file);
+    if (NULL != source)
+    {
+        source[size] = 0;
+    }
+    return source;
+}
+
+// Return a host timestamp in nanoseconds, for host work that has no
+// event.
+static cl_ulong hostNanoseconds(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (cl_ulong) t.tv_sec * 1000000000u + (cl_ulong) t.tv_nsec;
+}
+
+// Return the time (in nanoseconds) the device spent executing a command.
+static cl_ulong eventDuration(cl_event event)
+{
+    cl_ulong start = 0;
+    cl_ulong end = 0;
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START,
+                            sizeof(start), &start, NULL);
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END,
+                            sizeof(end), &end, NULL);
+    return end > start ? end - start : 0;
+}
+
+static int compareTimes(void const* a, void const* b)
+{
+    cl_ulong const ta = *(cl_ulong const*) a;
+    cl_ulong const tb = *(cl_ulong const*) b;
+    return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+// Return the p-th percentile (nearest rank) of count samples.  The samples
+// are sorted in place.
+static cl_ulong percentile(cl_ulong* samples, int count, double p)
+{
+    qsort(samples, count, sizeof(cl_ulong), compareTimes);
+    int rank = (int) (p / 100.0 * count + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    if (rank > count)
+        rank = count;
+    return samples[rank - 1];
+}
+
+// Write a string as a quoted CSV or JSON field.
+static void writeString(FILE* out, char const* text, int json)
+{
+    fputc('"', out);
+    for (char const* c = text; *c; ++ c)
+    {
+        if ('"' == *c)
+            fputs(json ? "\\\"" : "\"\"", out);
+        else if (json && '\\' == *c)
+            fputs("\\\\", out);
+        else if (json && (unsigned char) *c < 0x20)
+            fprintf(out, "\\u%04x", *c);
+        else
+            fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+// Write the statistics of one phase (upload, kernel or readback).  Times
+// are written in milliseconds; since the samples are in nanoseconds,
+// bytes per nanosecond is the bandwidth in GB/s.
+static void writePhase(FILE* out, char const* name, cl_ulong* samples,
+                       int count, size_t bytes, int json, int last)
+{
+    cl_ulong const median = percentile(samples, count, 50.0);
+    cl_ulong const p99 = percentile(samples, count, 99.0);
+    double const gbps = median ? (double) bytes / (double) median : 0.0;
+    if (json)
+    {
+        fprintf(out, "\"%s\": {\"median_ms\": %.6f, \"p99_ms\": %.6f, "
+                "\"gbps\": %.3f}%s", name, median * 1e-6, p99 * 1e-6, gbps,
+                last ? "" : ", ");
+    }
+    else
+    {
+        fprintf(out, ",%.6f,%.6f,%.3f", median * 1e-6, p99 * 1e-6, gbps);
+    }
+}
+
+// Upload x and y, run the kernel and read back z, 'warmup' times without
+// timing and then 'repeats' times recording the profiled duration of each
+// phase.
+//
+// In the mapped modes "upload" is mapping x and y for writing, copying
+// them into the mapping where it isn't the host array itself, and
+// unmapping them again, and "readback" is mapping z for reading; with
+// zero-copy buffers both are close to free.  z is left mapped after the
+// last repeat and returned in *result, for the caller to check and unmap.
+// In copy mode *result is simply z.
+static cl_int runPoint(cl_command_queue queue, cl_kernel kernel,
+                       MemoryMode mode,
+                       cl_mem devXmem, cl_mem devYmem, cl_mem devZmem,
+                       float const* x, float const* y, float* z,
+                       size_t dimension, size_t localSize,
+                       int warmup, int repeats, Timings* timings,
+                       float const** result)
+{
+    size_t const bytes = dimension * sizeof(cl_float);
+    for (int i = -warmup; i < repeats; ++ i)
+    {
+        cl_event events[6] = {0, 0, 0, 0, 0, 0};
+        cl_int r = CL_SUCCESS;
+        cl_ulong hostCopy = 0;
+        if (MEMORY_COPY == mode)
+        {
+            r = clEnqueueWriteBuffer(queue, devXmem, CL_FALSE, 0, bytes,
+                                     x, 0, NULL, &events[0]);
+            if (CL_SUCCESS == r)
+            {
+                r = clEnqueueWriteBuffer(queue, devYmem, CL_FALSE, 0, bytes,
+                                         y, 0, NULL, &events[1]);
+            }
+        }
+        else
+        {
+            cl_mem const inputs[2] = {devXmem, devYmem};
+            float const* const sources[2] = {x, y};
+            for (int b = 0; b < 2 && CL_SUCCESS == r; ++ b)
+            {
+                void* mapped = clEnqueueMapBuffer(queue, inputs[b], CL_TRUE,
+                               CL_MAP_WRITE_INVALIDATE_REGION, 0, bytes,
+                               0, NULL, &events[2*b], &r);
+                if (CL_SUCCESS != r)
+                    break;
+                // With CL_MEM_USE_HOST_PTR the mapping is the host array
+                // itself, which already holds the data.  Otherwise the
+                // data has to be copied in, just as copy mode has to
+                // transfer it, so the copy counts towards the upload.
+                if (mapped != (void*) sources[b])
+                {
+                    cl_ulong const start = hostNanoseconds();
+                    memcpy(mapped, sources[b], bytes);
+                    hostCopy += hostNanoseconds() - start;
+                }
+                r = clEnqueueUnmapMemObject(queue, inputs[b], mapped,
+                                            0, NULL, &events[2*b + 1]);
+            }
+        }
+        if (CL_SUCCESS == r)
+        {
+            r = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &dimension,
+                                       localSize ? &localSize : NULL,
+                                       0, NULL, &events[4]);
+        }
+        float* output = z;
+        if (CL_SUCCESS == r && MEMORY_COPY == mode)
+        {
+            r = clEnqueueReadBuffer(queue, devZmem, CL_FALSE, 0, bytes,
+                                    z, 0, NULL, &events[5]);
+        }
+        else if (CL_SUCCESS == r)
+        {
+            output = (float*) clEnqueueMapBuffer(queue, devZmem, CL_FALSE,
+                     CL_MAP_READ, 0, bytes, 0, NULL, &events[5], &r);
+        }
+        if (CL_SUCCESS == r)
+        {
+            r = clFinish(queue);
+        }
+        if (CL_SUCCESS == r && i >= 0)
+        {
+            timings->upload[i] = eventDuration(events[0])
+                                 + eventDuration(events[1])
+                                 + eventDuration(events[2])
+                                 + eventDuration(events[3]) + hostCopy;
+            timings->kernel[i] = eventDuration(events[4]);
+            timings->readback[i] = eventDuration(events[5]);
+            timings->total[i] = timings->upload[i] + timings->kernel[i]
+                                + timings->readback[i];
+        }
+        for (int e = 0; e < 6; ++ e)
+        {
+            if (events[e])
+                clReleaseEvent(events[e]);
+        }
+        if (CL_SUCCESS != r)
+        {
+            clFinish(queue);
+            return r;
+        }
+        if (MEMORY_COPY != mode && i + 1 < repeats)
+        {
+            clEnqueueUnmapMemObject(queue, devZmem, output, 0, NULL, NULL);
+        }
+        *result = output;
+    }
+    return CL_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Get the list of platforms.
+    int const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint numPlatforms = 0;
+    cl_int r = clGetPlatformIDs(maxPlatformCount, &platforms[0], &numPlatforms);
+    if (r != CL_SUCCESS)
+    {
+        fprintf(stderr, "clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+    if (options.platformToUse >= (int) numPlatforms)
+    {
+        fprintf(stderr, "Platform %d requested but only %u available\n",
+                options.platformToUse, numPlatforms);
+        return 1;
+    }
+
+    // Get the devices available for the chosen platform.  Unlike the
+    // Minimal sample this accepts any device type by default, so that the
+    // benchmark also runs on CPU implementations such as PoCL.
+    cl_uint deviceCount = 0;
+    size_t const maxDeviceCount = 8;
+    cl_device_id devices[maxDeviceCount];
+    r = clGetDeviceIDs(platforms[options.platformToUse], options.deviceType,
+                       maxDeviceCount, &devices[0], &deviceCount);
+    if (r != CL_SUCCESS)
+    {
+        fprintf(stderr, "clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+    if (options.deviceToUse >= (int) deviceCount)
+    {
+        fprintf(stderr, "Device %d requested but only %u available\n",
+                options.deviceToUse, deviceCount);
+        return 1;
+    }
+    cl_device_id device = devices[options.deviceToUse];
+
+    // Describe the device, so that results from different drivers can be
+    // told apart.
+    char platformName[256] = "";
+    char deviceName[256] = "";
+    char driverVersion[256] = "";
+    char deviceVersion[256] = "";
+    cl_ulong maxAllocSize = 0;
+    cl_ulong globalMemSize = 0;
+    cl_uint baseAddressAlign = 0;
+    size_t maxWorkItemSizes[3] = {0, 0, 0};
+    clGetPlatformInfo(platforms[options.platformToUse], CL_PLATFORM_NAME,
+                      sizeof(platformName), platformName, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(deviceName), deviceName, NULL);
+    clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(driverVersion),
+                    driverVersion, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_VERSION, sizeof(deviceVersion),
+                    deviceVersion, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(maxAllocSize),
+                    &maxAllocSize, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMemSize),
+                    &globalMemSize, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_MEM_BASE_ADDR_ALIGN,
+                    sizeof(baseAddressAlign), &baseAddressAlign, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_ITEM_SIZES,
+                    sizeof(maxWorkItemSizes), maxWorkItemSizes, NULL);
+    fprintf(stderr, "Using %s / %s (driver %s)\n", platformName, deviceName,
+            driverVersion);
+
+    // The largest vector must fit in a single allocation, and all three
+    // vectors must fit in device memory at once.  By default stay well
+    // below that: the host arrays are as large again, and on integrated
+    // GPUs and CPU devices host and device share the same memory.
+    cl_ulong deviceLimit = globalMemSize / 3;
+    if (maxAllocSize < deviceLimit)
+        deviceLimit = maxAllocSize;
+    cl_ulong defaultLimit = globalMemSize / 8;
+    if (deviceLimit < defaultLimit)
+        defaultLimit = deviceLimit;
+    if (0 == options.maxBytes)
+        options.maxBytes = (size_t) defaultLimit;
+    else if (options.maxBytes > deviceLimit)
+        options.maxBytes = (size_t) deviceLimit;
+
+    // Create the context for the selected device only.
+    cl_context context = clCreateContext(0, 1, &device, NULL, NULL, &r);
+    if (0 == context || CL_SUCCESS != r)
+    {
+        fprintf(stderr, "clCreateContext failed with return value %p and code %d\n",
+                context, r);
+        return r;
+    }
+
+    // Create a command queue with profiling enabled, so that every command
+    // records when it started and finished executing on the device.
+    cl_command_queue commandQueue = clCreateCommandQueue(context, device,
+                                    CL_QUEUE_PROFILING_ENABLE, &r);
+    if (0 == commandQueue || CL_SUCCESS != r)
+    {
+        fprintf(stderr, "clCreateCommandQueue failed with return value %p and code %d\n",
+                commandQueue, r);
+        return r;
+    }
+
+    // Read the kernel source and build it.
+    char* kernelSource = loadSource("kernel.cl");
+    if (NULL == kernelSource)
+    {
+        fprintf(stderr, "Unable to read kernel source file\n");
+        return 1;
+    }
+    const char* sourceLines[1] = {kernelSource};
+    cl_program program = clCreateProgramWithSource(context, 1,
+                         &sourceLines[0], NULL, &r);
+    free(kernelSource);
+    kernelSource = NULL;
+    if (0 == program || CL_SUCCESS != r)
+    {
+        fprintf(stderr, "clCreateProgramWithSource failed with return value %p and code %d\n",
+                program, r);
+        return r;
+    }
+
+    r = clBuildProgram(program, 0, 0, 0, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        fprintf(stderr, "clBuildProgram failed with return value %d; error log:\n", r);
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG,
+                                            sizeof(buildLog), buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            fprintf(stderr, "%s\n", buildLog);
+        }
+        return r;
+    }
+
+    cl_kernel kernel = clCreateKernel(program, "saxpy", &r);
+    if (0 == kernel || CL_SUCCESS != r)
+    {
+        fprintf(stderr, "clCreateKernel failed with return value %p and code %d\n",
+                kernel, r);
+        return r;
+    }
+
+    // Work out which work-group sizes to sweep.  Unless they were given on
+    // the command line, these are the runtime's own choice (a NULL local
+    // size, as in the Minimal sample) followed by every power of two from
+    // the preferred multiple up to the largest size this kernel allows.
+    if (0 == options.localSizeCount)
+    {
+        size_t kernelMaxLocal = 0;
+        size_t preferredMultiple = 1;
+        clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE,
+                                 sizeof(kernelMaxLocal), &kernelMaxLocal, NULL);
+        clGetKernelWorkGroupInfo(kernel, device,
+                                 CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+                                 sizeof(preferredMultiple), &preferredMultiple, NULL);
+        if (maxWorkItemSizes[0] && maxWorkItemSizes[0] < kernelMaxLocal)
+            kernelMaxLocal = maxWorkItemSizes[0];
+        size_t local = 1;
+        while (local * 2 <= preferredMultiple)
+            local *= 2;
+        options.localSizes[options.localSizeCount++] = 0;
+        for (; local <= kernelMaxLocal && options.localSizeCount < 32; local *= 2)
+            options.localSizes[options.localSizeCount++] = local;
+    }
+
+    // Allocate host memory for the largest vectors and set values to
+    // something easy to verify.  Smaller sweep points use a prefix.  The
+    // arrays are page aligned, which is what CL_MEM_USE_HOST_PTR needs for
+    // the driver to use them in place instead of making a copy.
+    size_t const maxDimension = options.maxBytes / sizeof(cl_float);
+    size_t alignment = 4096;
+    if (baseAddressAlign / 8 > alignment)
+        alignment = baseAddressAlign / 8;
+    size_t const hostBytes = (maxDimension * sizeof(float) + alignment - 1)
+                             / alignment * alignment;
+    float* x = NULL;
+    float* y = NULL;
+    float* z = NULL;
+    cl_ulong* samples = (cl_ulong*) malloc(4 * sizeof(cl_ulong) * options.repeats);
+    if (0 != posix_memalign((void**) &x, alignment, hostBytes)
+        || 0 != posix_memalign((void**) &y, alignment, hostBytes)
+        || 0 != posix_memalign((void**) &z, alignment, hostBytes)
+        || NULL == samples)
+    {
+        fprintf(stderr, "Unable to allocate %zu bytes of host memory per vector; "
+                "try a smaller --max-bytes\n", options.maxBytes);
+        return 1;
+    }
+    for (size_t i = 0; i < maxDimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+    Timings timings = {samples, samples + options.repeats,
+                       samples + 2 * options.repeats,
+                       samples + 3 * options.repeats};
+
+    FILE* out = stdout;
+    if (NULL != options.outputPath)
+    {
+        out = fopen(options.outputPath, "w");
+        if (NULL == out)
+        {
+            fprintf(stderr, "Unable to open %s for writing\n", options.outputPath);
+            return 1;
+        }
+    }
+
+    if (options.json)
+    {
+        fputs("{\n  \"platform\": ", out);
+        writeString(out, platformName, 1);
+        fputs(",\n  \"device\": ", out);
+        writeString(out, deviceName, 1);
+        fputs(",\n  \"driver\": ", out);
+        writeString(out, driverVersion, 1);
+        fputs(",\n  \"device_version\": ", out);
+        writeString(out, deviceVersion, 1);
+        fprintf(out, ",\n  \"warmup\": %d,\n  \"repeats\": %d,\n  \"results\": [",
+                options.warmup, options.repeats);
+    }
+    else
+    {
+        fputs("platform,device,driver,memory,bytes,elements,local_size,repeats,"
+              "upload_median_ms,upload_p99_ms,upload_gbps,"
+              "kernel_median_ms,kernel_p99_ms,kernel_gbps,"
+              "readback_median_ms,readback_p99_ms,readback_gbps,"
+              "total_median_ms,saved_vs_copy_ms\n", out);
+    }
+
+    // Sweep the vector size in powers of two, and at each vector size every
+    // memory mode and every work-group size.  Sizes are rounded to a power
+    // of two number of elements so that every power-of-two work-group size
+    // divides them.  Copy mode runs first, so that the other modes can be
+    // compared with it at the same size and work-group size.
+    size_t dimension = 1;
+    while (dimension * sizeof(cl_float) < options.minBytes)
+        dimension *= 2;
+    int firstRow = 1;
+    cl_int sweepResult = CL_SUCCESS;
+    float const a = 2.0f;
+    for (; dimension <= maxDimension && CL_SUCCESS == sweepResult; dimension *= 2)
+    {
+        size_t const bytes = dimension * sizeof(cl_float);
+        fprintf(stderr, "Measuring %zu bytes per vector\n", bytes);
+
+        // Median total time of copy mode for each work-group size, or 0 if
+        // copy mode wasn't measured.
+        cl_ulong copyTotal[32];
+        memset(copyTotal, 0, sizeof(copyTotal));
+
+        for (int m = 0; m < MEMORY_MODE_COUNT && CL_SUCCESS == sweepResult; ++ m)
+        {
+            if (!options.memoryModes[m])
+                continue;
+            MemoryMode const mode = (MemoryMode) m;
+
+            cl_mem_flags hostFlags = 0;
+            if (MEMORY_USE_HOST == mode)
+                hostFlags = CL_MEM_USE_HOST_PTR;
+            else if (MEMORY_ALLOC_HOST == mode)
+                hostFlags = CL_MEM_ALLOC_HOST_PTR;
+            cl_mem devXmem = clCreateBuffer(context, CL_MEM_READ_ONLY | hostFlags,
+                             bytes, MEMORY_USE_HOST == mode ? x : NULL, &r);
+            cl_mem devYmem = clCreateBuffer(context, CL_MEM_READ_ONLY | hostFlags,
+                             bytes, MEMORY_USE_HOST == mode ? y : NULL, &r);
+            cl_mem devZmem = clCreateBuffer(context, CL_MEM_WRITE_ONLY | hostFlags,
+                             bytes, MEMORY_USE_HOST == mode ? z : NULL, &r);
+            if (0 == devXmem || 0 == devYmem || 0 == devZmem)
+            {
+                // Near the device limit allocation may fail; stop the sweep
+                // here but keep the results measured so far.
+                fprintf(stderr, "clCreateBuffer failed with code %d at %zu bytes; "
+                        "stopping the sweep\n", r, bytes);
+                sweepResult = r;
+            }
+
+            if (CL_SUCCESS == sweepResult)
+            {
+                clSetKernelArg(kernel, 0, sizeof(cl_mem), &devXmem);
+                clSetKernelArg(kernel, 1, sizeof(cl_mem), &devYmem);
+                clSetKernelArg(kernel, 2, sizeof(cl_mem), &devZmem);
+                r = clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+                if (CL_SUCCESS != r)
+                {
+                    fprintf(stderr, "clSetKernelArg failed with return code %d\n", r);
+                    sweepResult = r;
+                }
+            }
+
+            for (int l = 0; l < options.localSizeCount && CL_SUCCESS == sweepResult; ++ l)
+            {
+                size_t const localSize = options.localSizes[l];
+                if (localSize > dimension || (localSize && dimension % localSize))
+                    continue;
+
+                // Clear z, and fill the device result with NaN, so that the
+                // check below sees only what this point writes and not the
+                // results of an earlier one.  In use-host mode z backs
+                // devZmem, so it is cleared through the fill instead.
+                if (MEMORY_USE_HOST != mode)
+                    memset(z, 0, bytes);
+                float const sentinel = NAN;
+                r = clEnqueueFillBuffer(commandQueue, devZmem, &sentinel,
+                                        sizeof(sentinel), 0, bytes, 0, NULL, NULL);
+                if (CL_SUCCESS == r)
+                    r = clFinish(commandQueue);
+                if (CL_SUCCESS != r)
+                {
+                    fprintf(stderr, "clEnqueueFillBuffer failed with return code %d\n", r);
+                    sweepResult = r;
+                    break;
+                }
+
+                float const* result = NULL;
+                r = runPoint(commandQueue, kernel, mode, devXmem, devYmem, devZmem,
+                             x, y, z, dimension, localSize,
+                             options.warmup, options.repeats, &timings, &result);
+                if (CL_SUCCESS != r)
+                {
+                    fprintf(stderr, "Run with %zu bytes, %s memory and local size "
+                            "%zu failed with code %d; stopping the sweep\n",
+                            bytes, memoryModeNames[m], localSize, r);
+                    sweepResult = r;
+                    break;
+                }
+
+                // Check the results of the last repeat, as the Minimal sample
+                // does.
+                for (size_t i = 0; i < dimension; ++ i)
+                {
+                    if (x[i]*a + y[i] != result[i])
+                    {
+                        fprintf(stderr, "Unexpected result at element %zu:\n", i);
+                        fprintf(stderr, " x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                                x[i], a, y[i], result[i]);
+                        return 100;
+                    }
+                }
+                if (MEMORY_COPY != mode)
+                {
+                    clEnqueueUnmapMemObject(commandQueue, devZmem, (void*) result,
+                                            0, NULL, NULL);
+                    clFinish(commandQueue);
+                }
+
+                cl_ulong const total = percentile(timings.total, options.repeats, 50.0);
+                if (MEMORY_COPY == mode)
+                    copyTotal[l] = total;
+
+                if (options.json)
+                {
+                    fprintf(out, "%s\n    {\"memory\": \"%s\", \"bytes\": %zu, "
+                            "\"elements\": %zu, \"local_size\": %zu, ",
+                            firstRow ? "" : ",", memoryModeNames[m],
+                            bytes, dimension, localSize);
+                }
+                else
+                {
+                    writeString(out, platformName, 0);
+                    fputc(',', out);
+                    writeString(out, deviceName, 0);
+                    fputc(',', out);
+                    writeString(out, driverVersion, 0);
+                    fprintf(out, ",%s,%zu,%zu,%zu,%d", memoryModeNames[m],
+                            bytes, dimension, localSize, options.repeats);
+                }
+                writePhase(out, "upload", timings.upload, options.repeats,
+                           2 * bytes, options.json, 0);
+                writePhase(out, "kernel", timings.kernel, options.repeats,
+                           3 * bytes, options.json, 0);
+                writePhase(out, "readback", timings.readback, options.repeats,
+                           bytes, options.json, 0);
+
+                // The time saved against copy mode is the difference of the
+                // median totals (negative if this mode is slower).  It is
+                // left empty when copy mode wasn't measured.
+                if (options.json)
+                {
+                    fprintf(out, "\"total_median_ms\": %.6f, \"saved_vs_copy_ms\": ",
+                            total * 1e-6);
+                    if (copyTotal[l])
+                        fprintf(out, "%.6f}", ((double) copyTotal[l] - total) * 1e-6);
+                    else
+                        fputs("null}", out);
+                }
+                else
+                {
+                    fprintf(out, ",%.6f,", total * 1e-6);
+                    if (copyTotal[l])
+                        fprintf(out, "%.6f", ((double) copyTotal[l] - total) * 1e-6);
+                    fputc('\n', out);
+                }
+                fflush(out);
+                firstRow = 0;
+            }
+
+            if (devXmem)
+                clReleaseMemObject(devXmem);
+            if (devYmem)
+                clReleaseMemObject(devYmem);
+            if (devZmem)
+                clReleaseMemObject(devZmem);
+        }
+    }
+
+    if (options.json)
+    {
+        fputs("\n  ]\n}\n", out);
+    }
+    if (stdout != out)
+    {
+        fclose(out);
+    }
+
+    // Free memory
+    free(samples);
+    free(x);
+    free(y);
+    free(z);
+
+    // Release kernel, program, command queue, and context.
+    clReleaseKernel(kernel);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(commandQueue);
+    clReleaseContext(context);
+
+    // A sweep that stopped at the device limit still produced useful
+    // results, so only report failure if nothing was measured.
+    return firstRow ? 1 : 0;
+}
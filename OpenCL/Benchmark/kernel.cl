@@ -0,0 +1,13 @@
+// This sample kernel computes z = a*x + y.
+// It is assumed that z, x, and y are all vectors of the same size, and
+// that the global size is exactly the number of elements.
+
+__kernel void saxpy(__global float const* x, __global float const* y,
+    __global float* z, float a)
+{
+    // Get element index n.  The benchmark sweeps sizes up to the device
+    // memory limit, so use size_t rather than int for the index.
+    size_t n = get_global_id(0);
+
+    z[n] = a*x[n] + y[n];
+}
@@ -0,0 +1,414 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <CL/opencl.h>
+
+// This sample is the Minimal saxpy with a persistent, on-disk cache of the
+// compiled program.  After the first run, the program is created with
+// clCreateProgramWithBinary from the CL_PROGRAM_BINARIES saved by an
+// earlier run, which skips the compiler front end and most of the cost of
+// clBuildProgram.
+//
+// A cache entry records the key it was built for: a hash of the kernel
+// source, the build options, the platform version, the device name and
+// the driver version.  If any of those change, or the driver rejects the
+// binary, the program is built from source again and the entry is
+// rewritten.
+
+// TODO: Put any build options (e.g. "-cl-mad-enable") here; they are part
+// of the cache key.
+static char const* const buildOptions = "";
+
+// The first line of every cache file.
+static char const* const cacheMagic = "OpenCL program binary cache v1";
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// 64-bit FNV-1a hash.
+static cl_ulong hashBytes(cl_ulong hash, void const* data, size_t size)
+{
+    unsigned char const* bytes = (unsigned char const*) data;
+    for (size_t i = 0; i < size; ++ i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static cl_ulong const hashSeed = 0xcbf29ce484222325ULL;
+
+// Read a whole file into a malloc'd buffer with a terminating null byte.
+static char* loadFile(char const* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (NULL == file)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* data = length >= 0 ? (char*) malloc(length + 1) : NULL;
+    if (NULL != data && (size_t) length != fread(data, 1, length, file))
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    if (NULL != data)
+    {
+        data[length] = 0;
+        *size = (size_t) length;
+    }
+    return data;
+}
+
+// Try to create and build the program from the cache file.  Returns 0 if
+// the file is missing, was written for a different key, or holds a binary
+// the driver rejects.
+static cl_program loadCachedProgram(cl_context context, cl_device_id device,
+                                    char const* cachePath, char const* key)
+{
+    size_t fileSize = 0;
+    char* file = loadFile(cachePath, &fileSize);
+    if (NULL == file)
+    {
+        return 0;
+    }
+
+    // The file is the magic line, the key line, the binary size on a line
+    // of its own, and then the binary.
+    size_t const magicLength = strlen(cacheMagic);
+    size_t const keyLength = strlen(key);
+    char* sizeLine = file + magicLength + 1 + keyLength + 1;
+    if (fileSize < magicLength + keyLength + 2
+        || 0 != memcmp(file, cacheMagic, magicLength)
+        || '\n' != file[magicLength]
+        || 0 != memcmp(file + magicLength + 1, key, keyLength)
+        || '\n' != file[magicLength + 1 + keyLength])
+    {
+        free(file);
+        return 0;
+    }
+    char* binaryStart = NULL;
+    size_t const binarySize = (size_t) strtoull(sizeLine, &binaryStart, 10);
+    if ('\n' != *binaryStart
+        || (size_t) (binaryStart + 1 - file) + binarySize != fileSize)
+    {
+        free(file);
+        return 0;
+    }
+    unsigned char const* binary = (unsigned char const*) binaryStart + 1;
+
+    cl_int binaryStatus = CL_SUCCESS;
+    cl_int r = CL_SUCCESS;
+    cl_program program = clCreateProgramWithBinary(context, 1, &device,
+                         &binarySize, &binary, &binaryStatus, &r);
+    free(file);
+    if (0 == program || CL_SUCCESS != r || CL_SUCCESS != binaryStatus)
+    {
+        printf("Cached binary rejected (codes %d, %d)\n", r, binaryStatus);
+        if (program)
+            clReleaseProgram(program);
+        return 0;
+    }
+
+    // A program created from a binary still has to be built, but this
+    // doesn't involve the compiler front end.
+    r = clBuildProgram(program, 1, &device, buildOptions, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("Building the cached binary failed with code %d\n", r);
+        clReleaseProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// Write the program's binary to the cache.  The entry is written to a
+// temporary file and renamed into place, so that concurrent processes
+// never see a partly written entry.
+static void storeCachedProgram(cl_program program, char const* cachePath,
+                               char const* key)
+{
+    size_t binarySize = 0;
+    cl_int r = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES,
+                                sizeof(binarySize), &binarySize, NULL);
+    if (CL_SUCCESS != r || 0 == binarySize)
+    {
+        printf("No program binary available to cache (code %d)\n", r);
+        return;
+    }
+    unsigned char* binary = (unsigned char*) malloc(binarySize);
+    r = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binary),
+                         &binary, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clGetProgramInfo for CL_PROGRAM_BINARIES failed with code %d\n", r);
+        free(binary);
+        return;
+    }
+
+    char temporaryPath[1024 + 32];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.%ld.tmp", cachePath,
+             (long) getpid());
+    FILE* file = fopen(temporaryPath, "wb");
+    if (NULL == file)
+    {
+        printf("Unable to write cache file %s\n", temporaryPath);
+        free(binary);
+        return;
+    }
+    fprintf(file, "%s\n%s\n%zu\n", cacheMagic, key, binarySize);
+    int const ok = binarySize == fwrite(binary, 1, binarySize, file);
+    free(binary);
+    if (0 != fclose(file) || !ok || 0 != rename(temporaryPath, cachePath))
+    {
+        printf("Unable to write cache file %s\n", cachePath);
+        remove(temporaryPath);
+    }
+}
+
+int main()
+{
+    // This example operates on buffers of size 32k elements, processing
+    // blocks of 512 elements at a time.
+    size_t const blockSize = 512;
+    size_t const blocks = 64;
+    size_t const dimension = blocks*blockSize;
+
+    // Get the list of platforms.
+    int const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint numPlatforms = 0;
+    cl_int r = clGetPlatformIDs(maxPlatformCount, &platforms[0], &numPlatforms);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: You may want to look at the list of platforms that are
+    // returned, and choose the most appropriate one for your needs.
+    int const platformToUse = 0;
+
+    // Get the devices available for the chosen platform.
+    cl_uint deviceCount = 0;
+    size_t const maxDeviceCount = 8;
+    cl_device_id devices[maxDeviceCount];
+    r = clGetDeviceIDs(platforms[platformToUse], CL_DEVICE_TYPE_ALL,
+                       maxDeviceCount, &devices[0], &deviceCount);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: If you have multiple devices, you may specify which one
+    // you'd like to use by changing this variable.  The cache holds one
+    // binary per device and driver.
+    int const deviceToUse = 0;
+    cl_device_id device = devices[deviceToUse];
+
+    cl_context context = clCreateContext(0, 1, &device, NULL, NULL, &r);
+    if (0 == context || CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return value %p and code %d\n",
+               context, r);
+        return r;
+    }
+
+    cl_command_queue commandQueue = clCreateCommandQueue(context, device, 0, &r);
+    if (0 == commandQueue || CL_SUCCESS != r)
+    {
+        printf("clCreateCommandQueue failed with return value %p and code %d\n",
+               commandQueue, r);
+        return r;
+    }
+
+    // Read the kernel source.  It is needed even when the cache is used,
+    // to check that the cached binary was built from the same source.
+    size_t kernelSize = 0;
+    char* kernelSource = loadFile("kernel.cl", &kernelSize);
+    if (NULL == kernelSource)
+    {
+        printf("Unable to read kernel source file\n");
+        return 1;
+    }
+
+    // Build the cache key.  The binary is only valid for the same source
+    // and options on the same device with the same driver.
+    char platformVersion[256] = "";
+    char deviceName[256] = "";
+    char driverVersion[256] = "";
+    clGetPlatformInfo(platforms[platformToUse], CL_PLATFORM_VERSION,
+                      sizeof(platformVersion), platformVersion, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(deviceName), deviceName, NULL);
+    clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(driverVersion),
+                    driverVersion, NULL);
+    char key[1024];
+    snprintf(key, sizeof(key), "source=%016llx options=%s platform=%s "
+             "device=%s driver=%s",
+             (unsigned long long) hashBytes(hashSeed, kernelSource, kernelSize),
+             buildOptions, platformVersion, deviceName, driverVersion);
+    for (char* c = key; *c; ++ c)
+    {
+        if ('\n' == *c || '\r' == *c)
+            *c = ' ';
+    }
+
+    // The cache directory can be set with OPENCL_CACHE_DIR.  Each device
+    // and driver gets its own file, so machines with several devices don't
+    // keep replacing one entry.
+    char const* cacheDirectory = getenv("OPENCL_CACHE_DIR");
+    if (NULL == cacheDirectory || 0 == *cacheDirectory)
+        cacheDirectory = ".";
+    cl_ulong deviceHash = hashBytes(hashSeed, deviceName, strlen(deviceName));
+    deviceHash = hashBytes(deviceHash, driverVersion, strlen(driverVersion));
+    char cachePath[1024];
+    snprintf(cachePath, sizeof(cachePath), "%s/saxpy-%016llx.clbin",
+             cacheDirectory, (unsigned long long) deviceHash);
+
+    // Try the cache first, and fall back to building from source.
+    double const buildStart = now();
+    cl_program program = loadCachedProgram(context, device, cachePath, key);
+    int const cacheHit = 0 != program;
+    if (!cacheHit)
+    {
+        const char* sourceLines[1] = {kernelSource};
+        program = clCreateProgramWithSource(context, 1, &sourceLines[0], NULL, &r);
+        if (0 == program || CL_SUCCESS != r)
+        {
+            printf("clCreateProgramWithSource failed with return value %p and code %d\n",
+                   program, r);
+            return r;
+        }
+
+        r = clBuildProgram(program, 1, &device, buildOptions, 0, 0);
+        if (CL_SUCCESS != r)
+        {
+            printf("clBuildProgram failed with return value %d; error log:\n", r);
+            char buildLog[1024*16];
+            cl_int rlog = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG,
+                                                sizeof(buildLog), buildLog, NULL);
+            if (CL_SUCCESS == rlog)
+            {
+                printf("%s\n", buildLog);
+            }
+            return r;
+        }
+    }
+    double const buildSeconds = now() - buildStart;
+    free(kernelSource);
+    kernelSource = NULL;
+
+    printf("Program cache %s (%s): program ready in %.3f ms\n",
+           cacheHit ? "hit" : "miss", cachePath, buildSeconds * 1e3);
+    if (!cacheHit)
+    {
+        storeCachedProgram(program, cachePath, key);
+    }
+
+    // Create the kernel
+    cl_kernel kernel = clCreateKernel(program, "saxpy", &r);
+    if (0 == kernel || CL_SUCCESS != r)
+    {
+        printf("clCreateKernel failed with return value %p and code %d\n",
+               kernel, r);
+        return r;
+    }
+
+    // Allocate host memory for input and output vectors, and set values
+    // to something easy to verify.
+    float* x = (float*) malloc(sizeof(float) * dimension);
+    float* y = (float*) malloc(sizeof(float) * dimension);
+    float* z = (float*) malloc(sizeof(float) * dimension);
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+        z[i] = - (float) i;
+    }
+
+    // Allocate device memory, copying x and y in.
+    cl_mem devXmem = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                    dimension*sizeof(cl_float), x, &r);
+    cl_mem devYmem = 0;
+    cl_mem devZmem = 0;
+    if (CL_SUCCESS == r)
+        devYmem = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                 dimension*sizeof(cl_float), y, &r);
+    if (CL_SUCCESS == r)
+        devZmem = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+                                 dimension*sizeof(cl_float), NULL, &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    // Set kernel parameters, execute the kernel and copy the results back.
+    float a = 2.0f;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &devXmem);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &devYmem);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &devZmem);
+    r = clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+    if (CL_SUCCESS != r)
+    {
+        printf("clSetKernelArg failed with return code %d\n", r);
+        return r;
+    }
+    r = clEnqueueNDRangeKernel(commandQueue, kernel, 1, 0, &dimension, 0, 0, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("clEnqueueNDRangeKernel failed with return code %d\n", r);
+        return r;
+    }
+    r = clEnqueueReadBuffer(commandQueue, devZmem, CL_TRUE, 0,
+                            dimension*sizeof(cl_float), z, 0, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("clEnqueueReadBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    // Check that results are correct.  Note that the code below
+    // depends on the computation being exact, which may not be the
+    // case for more complicated computations.
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                   x[i], a, y[i], z[i]);
+            return 100;
+        }
+    }
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(x);
+    free(y);
+    free(z);
+
+    // Release device memory, kernel, program, command queue, and context.
+    clReleaseMemObject(devXmem);
+    clReleaseMemObject(devYmem);
+    clReleaseMemObject(devZmem);
+    clReleaseKernel(kernel);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(commandQueue);
+    clReleaseContext(context);
+
+    return 0;
+}
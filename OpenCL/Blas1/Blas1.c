@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <string.h>
+#include "Blas1.h"
+
+static char const* const reductionKernels[] =
+{
+    "dot_partials", "nrm2", "axpy_dot", "axpby_nrm2", "sum_partials"
+};
+
+cl_int blas1Create(Blas1* blas, Runtime* runtime)
+{
+    memset(blas, 0, sizeof(*blas));
+    blas->runtime = runtime;
+
+    // The local size is the largest power of two, up to 256, that every
+    // reduction kernel can be launched with.
+    size_t maxLocal = 256;
+    cl_int r = CL_SUCCESS;
+    for (size_t k = 0; k < sizeof(reductionKernels) / sizeof(reductionKernels[0]); ++ k)
+    {
+        cl_kernel kernel = runtimeKernel(runtime, reductionKernels[k], &r);
+        if (CL_SUCCESS != r)
+            return r;
+        size_t workGroupSize = 0;
+        r = clGetKernelWorkGroupInfo(kernel, runtime->device,
+                                     CL_KERNEL_WORK_GROUP_SIZE,
+                                     sizeof(workGroupSize), &workGroupSize, NULL);
+        if (CL_SUCCESS != r)
+        {
+            printf("clGetKernelWorkGroupInfo failed with return code %d\n", r);
+            return r;
+        }
+        if (workGroupSize < maxLocal)
+            maxLocal = workGroupSize;
+    }
+    blas->localSize = 1;
+    while (2 * blas->localSize <= maxLocal)
+        blas->localSize *= 2;
+
+    // A few work-groups per compute unit are enough to fill the device;
+    // each work-group strides over the vector.
+    // TODO: Tune the number of work-groups per compute unit for your device.
+    cl_uint computeUnits = 1;
+    clGetDeviceInfo(runtime->device, CL_DEVICE_MAX_COMPUTE_UNITS,
+                    sizeof(computeUnits), &computeUnits, NULL);
+    blas->groupCount = 8 * (size_t) computeUnits;
+
+    blas->partials = clCreateBuffer(runtime->context, CL_MEM_READ_WRITE,
+                                    blas->groupCount * sizeof(cl_float), NULL, &r);
+    if (CL_SUCCESS == r)
+        blas->result = clCreateBuffer(runtime->context, CL_MEM_READ_WRITE,
+                                      sizeof(cl_float), NULL, &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateBuffer failed with return code %d\n", r);
+        blas1Release(blas);
+    }
+    return r;
+}
+
+void blas1Release(Blas1* blas)
+{
+    if (blas->partials)
+        clReleaseMemObject(blas->partials);
+    if (blas->result)
+        clReleaseMemObject(blas->result);
+    memset(blas, 0, sizeof(*blas));
+}
+
+// Enqueue an element-wise kernel over 'count' elements.
+static cl_int launchElementwise(Blas1* blas, cl_kernel kernel, size_t count)
+{
+    if (0 == count)
+        return CL_SUCCESS;
+    return clEnqueueNDRangeKernel(blas->runtime->queue, kernel, 1, NULL,
+                                  &count, NULL, 0, NULL, NULL);
+}
+
+// The number of work-groups for the first stage of a reduction: no more
+// than there are groups of elements.
+static size_t reductionGroups(Blas1 const* blas, size_t count)
+{
+    size_t const needed = (count + blas->localSize - 1) / blas->localSize;
+    return needed < 1 ? 1 : needed < blas->groupCount ? needed : blas->groupCount;
+}
+
+// Enqueue the first stage of a reduction, whose other arguments have been
+// set, followed by the second stage, and read the result.
+static cl_int launchReduction(Blas1* blas, cl_kernel kernel, size_t count,
+                              cl_uint partialsArg, int takeSqrt, float* result)
+{
+    cl_int r = CL_SUCCESS;
+    cl_kernel sumPartials = runtimeKernel(blas->runtime, "sum_partials", &r);
+    if (CL_SUCCESS != r)
+        return r;
+
+    cl_uint const groups = (cl_uint) reductionGroups(blas, count);
+    size_t const local = blas->localSize;
+    size_t const global = groups * local;
+    clSetKernelArg(kernel, partialsArg, sizeof(cl_mem), &blas->partials);
+    clSetKernelArg(kernel, partialsArg + 1, local * sizeof(cl_float), NULL);
+    r = clEnqueueNDRangeKernel(blas->runtime->queue, kernel, 1, NULL,
+                               &global, &local, 0, NULL, NULL);
+    if (CL_SUCCESS != r)
+        return r;
+
+    clSetKernelArg(sumPartials, 0, sizeof(cl_mem), &blas->partials);
+    clSetKernelArg(sumPartials, 1, sizeof(cl_uint), &groups);
+    clSetKernelArg(sumPartials, 2, sizeof(cl_int), &takeSqrt);
+    clSetKernelArg(sumPartials, 3, sizeof(cl_mem), &blas->result);
+    clSetKernelArg(sumPartials, 4, local * sizeof(cl_float), NULL);
+    r = clEnqueueNDRangeKernel(blas->runtime->queue, sumPartials, 1, NULL,
+                               &local, &local, 0, NULL, NULL);
+    if (CL_SUCCESS != r)
+        return r;
+
+    return clEnqueueReadBuffer(blas->runtime->queue, blas->result, CL_TRUE, 0,
+                               sizeof(cl_float), result, 0, NULL, NULL);
+}
+
+cl_int blas1Axpy(Blas1* blas, size_t count, float a, cl_mem x, cl_mem y)
+{
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(blas->runtime, "axpy", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    cl_ulong const elements = count;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &x);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &y);
+    clSetKernelArg(kernel, 2, sizeof(cl_float), &a);
+    clSetKernelArg(kernel, 3, sizeof(cl_ulong), &elements);
+    return launchElementwise(blas, kernel, count);
+}
+
+cl_int blas1Axpby(Blas1* blas, size_t count, float a, cl_mem x, float b,
+                  cl_mem y)
+{
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(blas->runtime, "axpby", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    cl_ulong const elements = count;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &x);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &y);
+    clSetKernelArg(kernel, 2, sizeof(cl_float), &a);
+    clSetKernelArg(kernel, 3, sizeof(cl_float), &b);
+    clSetKernelArg(kernel, 4, sizeof(cl_ulong), &elements);
+    return launchElementwise(blas, kernel, count);
+}
+
+cl_int blas1Scal(Blas1* blas, size_t count, float a, cl_mem x)
+{
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(blas->runtime, "scal", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    cl_ulong const elements = count;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &x);
+    clSetKernelArg(kernel, 1, sizeof(cl_float), &a);
+    clSetKernelArg(kernel, 2, sizeof(cl_ulong), &elements);
+    return launchElementwise(blas, kernel, count);
+}
+
+cl_int blas1Dot(Blas1* blas, size_t count, cl_mem x, cl_mem y,
+                float* result)
+{
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(blas->runtime, "dot_partials", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    cl_ulong const elements = count;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &x);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &y);
+    clSetKernelArg(kernel, 2, sizeof(cl_ulong), &elements);
+    return launchReduction(blas, kernel, count, 3, 0, result);
+}
+
+cl_int blas1Nrm2(Blas1* blas, size_t count, cl_mem x, float* result)
+{
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(blas->runtime, "nrm2", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    cl_ulong const elements = count;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &x);
+    clSetKernelArg(kernel, 1, sizeof(cl_ulong), &elements);
+    return launchReduction(blas, kernel, count, 2, 1, result);
+}
+
+cl_int blas1AxpyDot(Blas1* blas, size_t count, float a, cl_mem x, cl_mem y,
+                    cl_mem w, float* result)
+{
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(blas->runtime, "axpy_dot", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    cl_ulong const elements = count;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &x);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &y);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &w);
+    clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+    clSetKernelArg(kernel, 4, sizeof(cl_ulong), &elements);
+    return launchReduction(blas, kernel, count, 5, 0, result);
+}
+
+cl_int blas1AxpbyNrm2(Blas1* blas, size_t count, float a, cl_mem x, float b,
+                      cl_mem y, float* result)
+{
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(blas->runtime, "axpby_nrm2", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    cl_ulong const elements = count;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &x);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &y);
+    clSetKernelArg(kernel, 2, sizeof(cl_float), &a);
+    clSetKernelArg(kernel, 3, sizeof(cl_float), &b);
+    clSetKernelArg(kernel, 4, sizeof(cl_ulong), &elements);
+    return launchReduction(blas, kernel, count, 5, 1, result);
+}
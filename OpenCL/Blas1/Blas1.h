@@ -0,0 +1,62 @@
+#ifndef BLAS1_H
+#define BLAS1_H
+
+#include "Runtime.h"
+
+// BLAS-1 operations on float device buffers, using a Runtime (see
+// ../Runtime) for the context, queue and kernels.  Besides the usual
+// operations there are fused ones, which update a vector and reduce it in
+// a single pass over memory:
+//
+//   blas1AxpyDot    y = a*x + y,    then dot(y, w)
+//   blas1AxpbyNrm2  y = a*x + b*y,  then ||y||
+//
+// Reductions are done in two stages (per work-group partial sums in local
+// memory, then a single work-group that adds up the partials), and the
+// functions that return a value wait for it.  The runtime must have been
+// created with this directory's kernel.cl.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    Runtime* runtime;
+    // The work-group size of the reductions (a power of two), and the
+    // largest number of work-groups the first stage is launched with.
+    size_t localSize;
+    size_t groupCount;
+    // groupCount partial sums, and the final result.
+    cl_mem partials;
+    cl_mem result;
+} Blas1;
+
+cl_int blas1Create(Blas1* blas, Runtime* runtime);
+void blas1Release(Blas1* blas);
+
+// y = a*x + y
+cl_int blas1Axpy(Blas1* blas, size_t count, float a, cl_mem x, cl_mem y);
+// y = a*x + b*y
+cl_int blas1Axpby(Blas1* blas, size_t count, float a, cl_mem x, float b,
+                  cl_mem y);
+// x = a*x
+cl_int blas1Scal(Blas1* blas, size_t count, float a, cl_mem x);
+// *result = dot(x, y)
+cl_int blas1Dot(Blas1* blas, size_t count, cl_mem x, cl_mem y,
+                float* result);
+// *result = ||x||
+cl_int blas1Nrm2(Blas1* blas, size_t count, cl_mem x, float* result);
+
+// y = a*x + y, and *result = dot(y, w) with the updated y.  w may be y.
+cl_int blas1AxpyDot(Blas1* blas, size_t count, float a, cl_mem x, cl_mem y,
+                    cl_mem w, float* result);
+// y = a*x + b*y, and *result = ||y|| with the updated y.
+cl_int blas1AxpbyNrm2(Blas1* blas, size_t count, float a, cl_mem x, float b,
+                      cl_mem y, float* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
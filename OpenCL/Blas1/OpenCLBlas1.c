@@ -0,0 +1,240 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Blas1.h"
+
+// This sample compares fused BLAS-1 operations with the same operations
+// run back to back, as an iterative solver would chain them:
+//
+//   axpy+dot    y = a*x + y, then dot(y, w)
+//   axpby+nrm2  y = a*x + b*y, then ||y||
+//
+// Unfused, the vector y is written by the first kernel and read again by
+// the second; fused, it is reduced while it is being written, which saves
+// one pass over memory.  For these bandwidth-bound operations the time
+// should drop roughly in proportion to the bytes moved (5 to 4 vectors
+// for axpy+dot, and 4 to 3 for axpby+nrm2).
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int compareDoubles(void const* a, void const* b)
+{
+    double const x = *(double const*) a;
+    double const y = *(double const*) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+enum
+{
+    AXPY_DOT,
+    AXPBY_NRM2,
+    OPERATION_COUNT
+};
+
+static char const* const operationNames[OPERATION_COUNT] =
+{
+    "axpy+dot", "axpby+nrm2"
+};
+
+// Vectors read or written, unfused and fused.
+static int const unfusedPasses[OPERATION_COUNT] = {5, 4};
+static int const fusedPasses[OPERATION_COUNT] = {4, 3};
+
+static float const a = 0.5f;
+static float const b = 0.25f;
+
+// Run one operation, fused or not, and wait for its result.
+static cl_int run(Blas1* blas, int operation, int fused, size_t count,
+                  cl_mem x, cl_mem y, cl_mem w, float* result)
+{
+    cl_int r = CL_SUCCESS;
+    if (AXPY_DOT == operation)
+    {
+        if (fused)
+            return blas1AxpyDot(blas, count, a, x, y, w, result);
+        r = blas1Axpy(blas, count, a, x, y);
+        if (CL_SUCCESS == r)
+            r = blas1Dot(blas, count, y, w, result);
+    }
+    else
+    {
+        if (fused)
+            return blas1AxpbyNrm2(blas, count, a, x, b, y, result);
+        r = blas1Axpby(blas, count, a, x, b, y);
+        if (CL_SUCCESS == r)
+            r = blas1Nrm2(blas, count, y, result);
+    }
+    return r;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLBlas1 [elements [repeats]]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) 1 << 24;
+    int const repeats = argc > 2 ? atoi(argv[2]) : 20;
+    if (0 == dimension || repeats < 1)
+    {
+        printf("Usage: %s [elements [repeats]]\n", argv[0]);
+        return 1;
+    }
+
+    Runtime runtime;
+    cl_int r = runtimeCreate(&runtime, NULL);
+    if (CL_SUCCESS != r)
+        return r;
+    Blas1 blas;
+    r = blas1Create(&blas, &runtime);
+    if (CL_SUCCESS != r)
+        return r;
+    printf("%zu elements, reductions use %zu work-groups of %zu\n",
+           dimension, blas.groupCount, blas.localSize);
+
+    // Small values that cycle, so the float reductions stay accurate.
+    float* x = (float*) malloc(sizeof(float) * dimension);
+    float* y = (float*) malloc(sizeof(float) * dimension);
+    float* w = (float*) malloc(sizeof(float) * dimension);
+    float* updated = (float*) malloc(sizeof(float) * dimension);
+    double* times = (double*) malloc(sizeof(double) * repeats);
+    if (NULL == x || NULL == y || NULL == w || NULL == updated || NULL == times)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) (i % 16) * 0.125f;
+        y[i] = 1.0f - (float) (i % 8) * 0.0625f;
+        w[i] = (float) (i % 4) * 0.5f;
+    }
+
+    size_t const size = dimension * sizeof(cl_float);
+    cl_mem devX = runtimeAcquireBuffer(&runtime, size, &r);
+    cl_mem devY = 0;
+    cl_mem devW = 0;
+    cl_mem devInitialY = 0;
+    if (CL_SUCCESS == r)
+        devY = runtimeAcquireBuffer(&runtime, size, &r);
+    if (CL_SUCCESS == r)
+        devW = runtimeAcquireBuffer(&runtime, size, &r);
+    if (CL_SUCCESS == r)
+        devInitialY = runtimeAcquireBuffer(&runtime, size, &r);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime.queue, devX, CL_TRUE, 0, size, x, 0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime.queue, devW, CL_TRUE, 0, size, w, 0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime.queue, devInitialY, CL_TRUE, 0, size, y, 0, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("Unable to set up device buffers, return code %d\n", r);
+        return r;
+    }
+
+    int failed = 0;
+    for (int operation = 0; operation < OPERATION_COUNT; ++ operation)
+    {
+        // The expected result, in double precision.
+        double expected = 0.0;
+        for (size_t i = 0; i < dimension; ++ i)
+        {
+            double const v = AXPY_DOT == operation
+                ? (double) a * x[i] + y[i]
+                : (double) a * x[i] + (double) b * y[i];
+            expected += AXPY_DOT == operation ? v * w[i] : v * v;
+        }
+        if (AXPBY_NRM2 == operation)
+            expected = sqrt(expected);
+
+        double medians[2];
+        for (int fused = 0; fused < 2; ++ fused)
+        {
+            float result = 0.0f;
+            for (int t = 0; t < repeats; ++ t)
+            {
+                // Every run starts from the same y.
+                r = clEnqueueCopyBuffer(runtime.queue, devInitialY, devY, 0, 0,
+                                        size, 0, NULL, NULL);
+                if (CL_SUCCESS == r)
+                    r = clFinish(runtime.queue);
+                double const start = now();
+                if (CL_SUCCESS == r)
+                    r = run(&blas, operation, fused, dimension, devX, devY, devW,
+                            &result);
+                times[t] = now() - start;
+                if (CL_SUCCESS != r)
+                {
+                    printf("%s failed with return code %d\n",
+                           operationNames[operation], r);
+                    return r;
+                }
+            }
+            qsort(times, repeats, sizeof(double), compareDoubles);
+            medians[fused] = times[repeats / 2];
+            int const passes = fused ? fusedPasses[operation] : unfusedPasses[operation];
+            printf("%-11s %-8s %9.3f ms %8.2f GB/s  result %.7g (expected %.7g)\n",
+                   operationNames[operation], fused ? "fused" : "unfused",
+                   medians[fused] * 1e3,
+                   (double) passes * size / medians[fused] * 1e-9,
+                   result, expected);
+
+            // The result is summed in float in a different order than on
+            // the host, so it is only compared to a relative tolerance.
+            if (fabs(result - expected) > 1e-3 * fabs(expected))
+            {
+                printf("Unexpected result %.7g instead of %.7g\n", result, expected);
+                failed = 1;
+            }
+
+            // Check the updated y, which may differ in the last bit if the
+            // device contracts a*x + y into a fused multiply-add.
+            r = clEnqueueReadBuffer(runtime.queue, devY, CL_TRUE, 0, size, updated,
+                                    0, NULL, NULL);
+            if (CL_SUCCESS != r)
+            {
+                printf("clEnqueueReadBuffer failed with return code %d\n", r);
+                return r;
+            }
+            for (size_t i = 0; i < dimension; ++ i)
+            {
+                float const v = AXPY_DOT == operation ? a*x[i] + y[i] : a*x[i] + b*y[i];
+                if (fabsf(updated[i] - v) > 1e-6f * fabsf(v))
+                {
+                    printf("Unexpected y[%zu] = %f instead of %f\n", i, updated[i], v);
+                    failed = 1;
+                    break;
+                }
+            }
+        }
+        printf("%-11s fused is %.2fx as fast\n", operationNames[operation],
+               medians[1] > 0 ? medians[0] / medians[1] : 0.0);
+    }
+    if (failed)
+        return 100;
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(x);
+    free(y);
+    free(w);
+    free(updated);
+    free(times);
+
+    // Give the buffers back and release everything.
+    runtimeReleaseBuffer(&runtime, devX);
+    runtimeReleaseBuffer(&runtime, devY);
+    runtimeReleaseBuffer(&runtime, devW);
+    runtimeReleaseBuffer(&runtime, devInitialY);
+    blas1Release(&blas);
+    runtimeRelease(&runtime);
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+// BLAS-1 kernels on float vectors of 'count' elements, in plain and fused
+// variants.  The fused kernels update a vector and reduce it in the same
+// pass, so the updated vector isn't read from memory a second time:
+//
+//   axpy_dot     y = a*x + y,    partial sums of dot(y, w)
+//   axpby_nrm2   y = a*x + b*y,  partial sums of dot(y, y)
+//
+// A reduction runs in two stages.  The first kernel is launched with a
+// fixed number of work-groups that stride over the whole vector; each
+// work-group sums its values in local memory and writes one partial sum.
+// sum_partials then adds up the partials in a single work-group.  The
+// local size must be a power of two, and 'scratch' must hold one float
+// per work-item.
+
+// Sum 'value' over the work-group.  Every work-item gets the sum.
+float groupSum(float value, __local float* scratch)
+{
+    size_t const lid = get_local_id(0);
+    scratch[lid] = value;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (size_t s = get_local_size(0) / 2; s > 0; s >>= 1)
+    {
+        if (lid < s)
+        {
+            scratch[lid] += scratch[lid + s];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    float const sum = scratch[0];
+    // Make sure everyone has read the sum before scratch is reused.
+    barrier(CLK_LOCAL_MEM_FENCE);
+    return sum;
+}
+
+// y = a*x + y
+__kernel void axpy(__global float const* x, __global float* y, float a,
+    ulong count)
+{
+    size_t n = get_global_id(0);
+    if (n < count)
+    {
+        y[n] = a*x[n] + y[n];
+    }
+}
+
+// y = a*x + b*y
+__kernel void axpby(__global float const* x, __global float* y, float a,
+    float b, ulong count)
+{
+    size_t n = get_global_id(0);
+    if (n < count)
+    {
+        y[n] = a*x[n] + b*y[n];
+    }
+}
+
+// x = a*x
+__kernel void scal(__global float* x, float a, ulong count)
+{
+    size_t n = get_global_id(0);
+    if (n < count)
+    {
+        x[n] = a*x[n];
+    }
+}
+
+// partials[group] = the group's share of dot(x, y)
+__kernel void dot_partials(__global float const* x, __global float const* y,
+    ulong count, __global float* partials, __local float* scratch)
+{
+    float sum = 0.0f;
+    for (size_t n = get_global_id(0); n < count; n += get_global_size(0))
+    {
+        sum += x[n]*y[n];
+    }
+    sum = groupSum(sum, scratch);
+    if (0 == get_local_id(0))
+    {
+        partials[get_group_id(0)] = sum;
+    }
+}
+
+// partials[group] = the group's share of dot(x, x)
+__kernel void nrm2(__global float const* x, ulong count,
+    __global float* partials, __local float* scratch)
+{
+    float sum = 0.0f;
+    for (size_t n = get_global_id(0); n < count; n += get_global_size(0))
+    {
+        sum += x[n]*x[n];
+    }
+    sum = groupSum(sum, scratch);
+    if (0 == get_local_id(0))
+    {
+        partials[get_group_id(0)] = sum;
+    }
+}
+
+// y = a*x + y, and partials[group] = the group's share of dot(y, w).
+// w may be the same buffer as y.
+__kernel void axpy_dot(__global float const* x, __global float* y,
+    __global float const* w, float a, ulong count,
+    __global float* partials, __local float* scratch)
+{
+    float sum = 0.0f;
+    for (size_t n = get_global_id(0); n < count; n += get_global_size(0))
+    {
+        float const v = a*x[n] + y[n];
+        y[n] = v;
+        // If w is y, w[n] is read after this work-item wrote it, so it is
+        // the updated value.
+        sum += v*w[n];
+    }
+    sum = groupSum(sum, scratch);
+    if (0 == get_local_id(0))
+    {
+        partials[get_group_id(0)] = sum;
+    }
+}
+
+// y = a*x + b*y, and partials[group] = the group's share of dot(y, y).
+__kernel void axpby_nrm2(__global float const* x, __global float* y,
+    float a, float b, ulong count, __global float* partials,
+    __local float* scratch)
+{
+    float sum = 0.0f;
+    for (size_t n = get_global_id(0); n < count; n += get_global_size(0))
+    {
+        float const v = a*x[n] + b*y[n];
+        y[n] = v;
+        sum += v*v;
+    }
+    sum = groupSum(sum, scratch);
+    if (0 == get_local_id(0))
+    {
+        partials[get_group_id(0)] = sum;
+    }
+}
+
+// result[0] = the sum of partials[0..count), or its square root if
+// takeSqrt is set.  Launched as a single work-group.
+__kernel void sum_partials(__global float const* partials, uint count,
+    int takeSqrt, __global float* result, __local float* scratch)
+{
+    float sum = 0.0f;
+    for (size_t n = get_local_id(0); n < count; n += get_local_size(0))
+    {
+        sum += partials[n];
+    }
+    sum = groupSum(sum, scratch);
+    if (0 == get_local_id(0))
+    {
+        result[0] = takeSqrt ? sqrt(sum) : sum;
+    }
+}
@@ -0,0 +1,499 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Catalogue.h"
+
+// The probes' sizes.  They are meant to take well under a second each on
+// a discrete GPU, and a few seconds at most on a slow CPU device.
+#define PROBE_ELEMENTS ((size_t) 1 << 23)
+#define PROBE_REPEATS 5
+#define LAUNCH_REPEATS 50
+// The reference job of catalogueScore.
+#define SCORE_ELEMENTS ((double) (1 << 24))
+
+// Fields of a cache file line, separated by tabs: platform, device,
+// driver version, device version (these four are the key), then the
+// transfer, launch and saxpy results.
+#define CACHE_FIELDS 7
+#define CACHE_LINE 1024
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int compareDoubles(void const* a, void const* b)
+{
+    double const x = *(double const*) a;
+    double const y = *(double const*) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Make a string returned by the driver safe to store in a cache line.
+static void sanitize(char* s, size_t size)
+{
+    s[size - 1] = 0;
+    for (; *s; ++ s)
+    {
+        if ('\t' == *s || '\n' == *s || '\r' == *s)
+            *s = ' ';
+    }
+}
+
+cl_int catalogueCreate(Catalogue* catalogue)
+{
+    memset(catalogue, 0, sizeof(*catalogue));
+
+    // The same limits as the Runtime, so that the indices agree.
+    cl_uint const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint platformCount = 0;
+    cl_int r = clGetPlatformIDs(maxPlatformCount, platforms, &platformCount);
+    if (CL_SUCCESS != r)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+    // The count is of all platforms, not just those that fit.
+    if (platformCount > maxPlatformCount)
+        platformCount = maxPlatformCount;
+    for (cl_uint p = 0; p < platformCount; ++ p)
+    {
+        char platformName[128] = "";
+        clGetPlatformInfo(platforms[p], CL_PLATFORM_NAME, sizeof(platformName),
+                          platformName, NULL);
+        sanitize(platformName, sizeof(platformName));
+
+        cl_uint const maxDeviceCount = 8;
+        cl_device_id devices[maxDeviceCount];
+        cl_uint deviceCount = 0;
+        r = clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, maxDeviceCount,
+                           devices, &deviceCount);
+        if (CL_DEVICE_NOT_FOUND == r)
+            continue;
+        if (CL_SUCCESS != r)
+        {
+            printf("clGetDeviceIDs failed on platform %u with return code %d\n", p, r);
+            continue;
+        }
+        if (deviceCount > maxDeviceCount)
+            deviceCount = maxDeviceCount;
+        for (cl_uint d = 0; d < deviceCount && catalogue->count < CATALOGUE_MAX_DEVICES; ++ d)
+        {
+            CatalogueDevice* device = &catalogue->devices[catalogue->count++];
+            cl_device_id const id = devices[d];
+            device->platformIndex = p;
+            device->deviceIndex = d;
+            strcpy(device->platformName, platformName);
+            clGetDeviceInfo(id, CL_DEVICE_TYPE, sizeof(device->type), &device->type, NULL);
+            clGetDeviceInfo(id, CL_DEVICE_NAME, sizeof(device->deviceName),
+                            device->deviceName, NULL);
+            clGetDeviceInfo(id, CL_DRIVER_VERSION, sizeof(device->driverVersion),
+                            device->driverVersion, NULL);
+            clGetDeviceInfo(id, CL_DEVICE_VERSION, sizeof(device->deviceVersion),
+                            device->deviceVersion, NULL);
+            clGetDeviceInfo(id, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(device->computeUnits),
+                            &device->computeUnits, NULL);
+            clGetDeviceInfo(id, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(device->globalMemory),
+                            &device->globalMemory, NULL);
+            sanitize(device->deviceName, sizeof(device->deviceName));
+            sanitize(device->driverVersion, sizeof(device->driverVersion));
+            sanitize(device->deviceVersion, sizeof(device->deviceVersion));
+        }
+    }
+    if (0 == catalogue->count)
+    {
+        printf("No OpenCL devices found\n");
+        return CL_DEVICE_NOT_FOUND;
+    }
+    return CL_SUCCESS;
+}
+
+// Run the probes on one device.
+static cl_int probeDevice(CatalogueDevice* device, char const* kernelPath)
+{
+    RuntimeOptions options;
+    runtimeDefaultOptions(&options);
+    catalogueApply(device, &options);
+    options.kernelPath = kernelPath;
+    Runtime runtime;
+    cl_int r = runtimeCreate(&runtime, &options);
+    if (CL_SUCCESS != r)
+        return r;
+
+    // Keep the buffers well within what the device can allocate.
+    cl_ulong maxAllocation = 0;
+    clGetDeviceInfo(runtime.device, CL_DEVICE_MAX_MEM_ALLOC_SIZE,
+                    sizeof(maxAllocation), &maxAllocation, NULL);
+    size_t count = PROBE_ELEMENTS;
+    if (count * sizeof(cl_float) > maxAllocation / 2)
+        count = (size_t) (maxAllocation / 2 / sizeof(cl_float));
+    size_t const size = count * sizeof(cl_float);
+    float const a = 2.0f;
+    float* host = (float*) malloc(size);
+    float* z = (float*) malloc(size);
+    cl_mem devX = 0;
+    cl_mem devY = 0;
+    cl_mem devZ = 0;
+    if (0 == count || NULL == host || NULL == z)
+        r = CL_OUT_OF_HOST_MEMORY;
+    if (CL_SUCCESS == r)
+        devX = runtimeAcquireBuffer(&runtime, size, &r);
+    if (CL_SUCCESS == r)
+        devY = runtimeAcquireBuffer(&runtime, size, &r);
+    if (CL_SUCCESS == r)
+        devZ = runtimeAcquireBuffer(&runtime, size, &r);
+
+    // Transfer: the same data down and back up, for x and then y.  x and
+    // y are the same, so z = 3*x.
+    double times[LAUNCH_REPEATS];
+    if (CL_SUCCESS == r)
+    {
+        for (size_t i = 0; i < count; ++ i)
+        {
+            host[i] = (float) (i % 1024);
+        }
+    }
+    for (int t = 0; t < PROBE_REPEATS && CL_SUCCESS == r; ++ t)
+    {
+        cl_mem const buffer = t % 2 ? devY : devX;
+        double const start = now();
+        r = clEnqueueWriteBuffer(runtime.queue, buffer, CL_TRUE, 0, size, host,
+                                 0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clEnqueueReadBuffer(runtime.queue, buffer, CL_TRUE, 0, size, z,
+                                    0, NULL, NULL);
+        times[t] = now() - start;
+    }
+    if (CL_SUCCESS == r)
+    {
+        qsort(times, PROBE_REPEATS, sizeof(double), compareDoubles);
+        device->transferGBs = 2.0 * size / times[PROBE_REPEATS / 2] * 1e-9;
+    }
+
+    // Launch: a one-element saxpy, after one to warm up.
+    for (int t = -1; t < LAUNCH_REPEATS && CL_SUCCESS == r; ++ t)
+    {
+        double const start = now();
+        r = runtimeEnqueueSaxpy(&runtime, a, devX, devY, devZ, 1, 0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clFinish(runtime.queue);
+        if (t >= 0)
+            times[t] = now() - start;
+    }
+    if (CL_SUCCESS == r)
+    {
+        qsort(times, LAUNCH_REPEATS, sizeof(double), compareDoubles);
+        device->launchMicroseconds = times[LAUNCH_REPEATS / 2] * 1e6;
+    }
+
+    // Saxpy on the device buffers.
+    for (int t = 0; t < PROBE_REPEATS && CL_SUCCESS == r; ++ t)
+    {
+        double const start = now();
+        r = runtimeEnqueueSaxpy(&runtime, a, devX, devY, devZ, count, 0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clFinish(runtime.queue);
+        times[t] = now() - start;
+    }
+    if (CL_SUCCESS == r)
+    {
+        qsort(times, PROBE_REPEATS, sizeof(double), compareDoubles);
+        device->saxpyGBs = 3.0 * size / times[PROBE_REPEATS / 2] * 1e-9;
+        r = clEnqueueReadBuffer(runtime.queue, devZ, CL_TRUE, 0, size, z, 0, NULL, NULL);
+    }
+
+    // A fast device that computes the wrong thing is no use.  The result
+    // is exact whether or not the device fuses the multiply and add.
+    for (size_t i = 0; i < count && CL_SUCCESS == r; ++ i)
+    {
+        if (host[i]*a + host[i] != z[i])
+        {
+            printf("Device %u:%u computed a wrong result at element %zu\n",
+                   device->platformIndex, device->deviceIndex, i);
+            r = CL_INVALID_VALUE;
+        }
+    }
+
+    free(host);
+    free(z);
+    if (devX)
+        runtimeReleaseBuffer(&runtime, devX);
+    if (devY)
+        runtimeReleaseBuffer(&runtime, devY);
+    if (devZ)
+        runtimeReleaseBuffer(&runtime, devZ);
+    runtimeRelease(&runtime);
+    return r;
+}
+
+// Split a cache line into its fields, in place.  Returns the number of
+// fields.
+static int splitLine(char* line, char** fields)
+{
+    line[strcspn(line, "\r\n")] = 0;
+    if ('#' == line[0] || 0 == line[0])
+        return 0;
+    int count = 0;
+    fields[count++] = line;
+    for (char* c = line; *c && count < CACHE_FIELDS; ++ c)
+    {
+        if ('\t' == *c)
+        {
+            *c = 0;
+            fields[count++] = c + 1;
+        }
+    }
+    return count;
+}
+
+static int isModel(CatalogueDevice const* device, char* const* fields)
+{
+    return 0 == strcmp(fields[0], device->platformName)
+        && 0 == strcmp(fields[1], device->deviceName);
+}
+
+static int isDevice(CatalogueDevice const* device, char* const* fields)
+{
+    return isModel(device, fields)
+        && 0 == strcmp(fields[2], device->driverVersion)
+        && 0 == strcmp(fields[3], device->deviceVersion);
+}
+
+// Read the lines of the cache file, if there is one.  Returns the number
+// of lines, which are allocated.
+static size_t readCache(char const* path, char*** lines)
+{
+    *lines = NULL;
+    FILE* file = fopen(path, "r");
+    if (NULL == file)
+        return 0;
+    size_t count = 0;
+    size_t capacity = 0;
+    char line[CACHE_LINE];
+    while (fgets(line, sizeof(line), file))
+    {
+        if (count == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 16;
+            char** grown = (char**) realloc(*lines, capacity * sizeof(char*));
+            if (NULL == grown)
+                break;
+            *lines = grown;
+        }
+        line[strcspn(line, "\r\n")] = 0;
+        (*lines)[count] = strdup(line);
+        if (NULL == (*lines)[count])
+            break;
+        ++ count;
+    }
+    fclose(file);
+    return count;
+}
+
+// Write the cache file: the devices of this catalogue, and the entries
+// of other devices (perhaps of another machine sharing the file) as they
+// were.  Entries for the devices of this catalogue with other drivers
+// are dropped, as they are out of date.
+static void writeCache(Catalogue const* catalogue, char const* path,
+                       char** lines, size_t lineCount)
+{
+    FILE* file = fopen(path, "w");
+    if (NULL == file)
+    {
+        printf("Unable to write the device cache %s\n", path);
+        return;
+    }
+    fprintf(file, "# platform\tdevice\tdriver version\tdevice version"
+            "\ttransfer GB/s\tlaunch us\tsaxpy GB/s\n");
+    for (unsigned d = 0; d < catalogue->count; ++ d)
+    {
+        CatalogueDevice const* device = &catalogue->devices[d];
+        if (!device->probed)
+            continue;
+        // Identical devices share an entry.
+        int duplicate = 0;
+        for (unsigned e = 0; e < d && !duplicate; ++ e)
+        {
+            CatalogueDevice const* earlier = &catalogue->devices[e];
+            duplicate = earlier->probed
+                && 0 == strcmp(earlier->platformName, device->platformName)
+                && 0 == strcmp(earlier->deviceName, device->deviceName)
+                && 0 == strcmp(earlier->driverVersion, device->driverVersion)
+                && 0 == strcmp(earlier->deviceVersion, device->deviceVersion);
+        }
+        if (!duplicate)
+            fprintf(file, "%s\t%s\t%s\t%s\t%g\t%g\t%g\n", device->platformName,
+                    device->deviceName, device->driverVersion, device->deviceVersion,
+                    device->transferGBs, device->launchMicroseconds, device->saxpyGBs);
+    }
+    for (size_t l = 0; l < lineCount; ++ l)
+    {
+        char line[CACHE_LINE];
+        char* fields[CACHE_FIELDS];
+        strcpy(line, lines[l]);
+        if (splitLine(line, fields) != CACHE_FIELDS)
+            continue;
+        int current = 0;
+        for (unsigned d = 0; d < catalogue->count && !current; ++ d)
+        {
+            current = isModel(&catalogue->devices[d], fields);
+        }
+        if (!current)
+            fprintf(file, "%s\n", lines[l]);
+    }
+    if (0 != fclose(file))
+        printf("Unable to write the device cache %s\n", path);
+}
+
+cl_int catalogueProbe(Catalogue* catalogue, char const* cachePath,
+                      char const* kernelPath, int refresh)
+{
+    char** lines = NULL;
+    size_t const lineCount = readCache(cachePath, &lines);
+
+    for (unsigned d = 0; d < catalogue->count; ++ d)
+    {
+        CatalogueDevice* device = &catalogue->devices[d];
+        device->probed = 0;
+        device->cached = 0;
+        device->error = CL_SUCCESS;
+        for (size_t l = 0; l < lineCount && !refresh && !device->probed; ++ l)
+        {
+            char line[CACHE_LINE];
+            char* fields[CACHE_FIELDS];
+            strcpy(line, lines[l]);
+            if (CACHE_FIELDS == splitLine(line, fields) && isDevice(device, fields))
+            {
+                device->transferGBs = strtod(fields[4], NULL);
+                device->launchMicroseconds = strtod(fields[5], NULL);
+                device->saxpyGBs = strtod(fields[6], NULL);
+                device->probed = 1;
+                device->cached = 1;
+            }
+        }
+        if (device->probed)
+            continue;
+
+        printf("Probing %u:%u %s...\n", device->platformIndex, device->deviceIndex,
+               device->deviceName);
+        fflush(stdout);
+        device->error = probeDevice(device, kernelPath);
+        if (CL_SUCCESS == device->error)
+            device->probed = 1;
+        else
+            printf("Probing %u:%u failed with return code %d\n",
+                   device->platformIndex, device->deviceIndex, device->error);
+    }
+
+    writeCache(catalogue, cachePath, lines, lineCount);
+    for (size_t l = 0; l < lineCount; ++ l)
+    {
+        free(lines[l]);
+    }
+    free(lines);
+    return CL_SUCCESS;
+}
+
+double catalogueScore(CatalogueDevice const* device)
+{
+    if (!device->probed || device->transferGBs <= 0 || device->saxpyGBs <= 0)
+        return -1.0;
+    // x and y go to the device and z comes back, and the kernel reads x
+    // and y and writes z: 12 bytes per element each way.
+    // TODO: Weigh the probes to match your workload, e.g. leave out the
+    // transfers if your data stays on the device.
+    double const bytes = 3.0 * sizeof(cl_float) * SCORE_ELEMENTS;
+    return device->launchMicroseconds * 1e-6
+         + bytes / (device->transferGBs * 1e9)
+         + bytes / (device->saxpyGBs * 1e9);
+}
+
+int catalogueFind(Catalogue const* catalogue, char const* choice)
+{
+    unsigned platformIndex = 0;
+    unsigned deviceIndex = 0;
+    char extra = 0;
+    int const byIndex = 2 == sscanf(choice, "%u:%u%c", &platformIndex,
+                                    &deviceIndex, &extra);
+    for (unsigned d = 0; d < catalogue->count; ++ d)
+    {
+        CatalogueDevice const* device = &catalogue->devices[d];
+        if (byIndex ? device->platformIndex == platformIndex
+                      && device->deviceIndex == deviceIndex
+                    : NULL != strstr(device->deviceName, choice))
+        {
+            return (int) d;
+        }
+    }
+    return -1;
+}
+
+int catalogueSelect(Catalogue const* catalogue, char const* choice)
+{
+    if (NULL == choice)
+        choice = getenv(CATALOGUE_DEVICE_VARIABLE);
+    if (NULL != choice && 0 != choice[0])
+    {
+        int const found = catalogueFind(catalogue, choice);
+        if (found < 0)
+            printf("There is no device \"%s\"\n", choice);
+        return found;
+    }
+
+    int best = -1;
+    double bestScore = 0.0;
+    for (unsigned d = 0; d < catalogue->count; ++ d)
+    {
+        double const score = catalogueScore(&catalogue->devices[d]);
+        if (score > 0 && (best < 0 || score < bestScore))
+        {
+            best = (int) d;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+void catalogueApply(CatalogueDevice const* device, RuntimeOptions* options)
+{
+    options->platformIndex = device->platformIndex;
+    options->deviceIndex = device->deviceIndex;
+    options->deviceType = CL_DEVICE_TYPE_ALL;
+}
+
+static char const* typeName(cl_device_type type)
+{
+    if (type & CL_DEVICE_TYPE_GPU)
+        return "GPU";
+    if (type & CL_DEVICE_TYPE_CPU)
+        return "CPU";
+    if (type & CL_DEVICE_TYPE_ACCELERATOR)
+        return "accel";
+    return "other";
+}
+
+void cataloguePrint(Catalogue const* catalogue, int selected)
+{
+    printf("  dev  type   CUs    memory   transfer     launch       saxpy   score  device\n");
+    for (unsigned d = 0; d < catalogue->count; ++ d)
+    {
+        CatalogueDevice const* device = &catalogue->devices[d];
+        printf("%c %u:%u %-5s %5u %6llu MB", (int) d == selected ? '*' : ' ',
+               device->platformIndex, device->deviceIndex, typeName(device->type),
+               device->computeUnits,
+               (unsigned long long) (device->globalMemory >> 20));
+        if (device->probed)
+            printf(" %5.1f GB/s %7.1f us %6.1f GB/s %5.0f ms",
+                   device->transferGBs, device->launchMicroseconds,
+                   device->saxpyGBs, catalogueScore(device) * 1e3);
+        else
+            printf(" %-41s", "(not probed)");
+        printf("  %s (%s, driver %s)%s\n", device->deviceName, device->platformName,
+               device->driverVersion, device->cached ? " [cached]" : "");
+    }
+}
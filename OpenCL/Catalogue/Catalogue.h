@@ -0,0 +1,93 @@
+#ifndef CATALOGUE_H
+#define CATALOGUE_H
+
+#include "Runtime.h"
+
+// A catalogue of every OpenCL device on every platform (GPUs, CPUs and
+// accelerators alike), with measured performance to choose one by.
+//
+// catalogueCreate lists the devices.  catalogueProbe then measures each
+// one with a few short probes, using a Runtime (see ../Runtime):
+//
+//   transfer  host to device and back, GB/s
+//   launch    a one-element kernel, enqueued and waited for, in us
+//   saxpy     z = a*x + y on device buffers, GB/s of x, y and z
+//
+// Probing takes a second or so per device, so the results are kept in a
+// cache file, keyed by platform, device and driver version; a new driver
+// gets probed again.  catalogueSelect picks the best device, unless the
+// user asked for one.  Devices are numbered as the Runtime numbers them
+// (platform index, and device index among all the platform's devices),
+// so catalogueApply can point RuntimeOptions at the chosen one.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CATALOGUE_MAX_DEVICES 64
+// The environment variable that overrides the choice of device, as
+// "platform:device" or as part of a device name.
+#define CATALOGUE_DEVICE_VARIABLE "OPENCL_DEVICE"
+
+typedef struct
+{
+    unsigned platformIndex;
+    unsigned deviceIndex;
+    cl_device_type type;
+    char platformName[128];
+    char deviceName[128];
+    char driverVersion[64];
+    char deviceVersion[64];
+    cl_uint computeUnits;
+    cl_ulong globalMemory;
+    // The probe results are valid, and whether they came from the cache.
+    // 'error' is set if probing failed.
+    int probed;
+    int cached;
+    cl_int error;
+    double transferGBs;
+    double launchMicroseconds;
+    double saxpyGBs;
+} CatalogueDevice;
+
+typedef struct
+{
+    unsigned count;
+    CatalogueDevice devices[CATALOGUE_MAX_DEVICES];
+} Catalogue;
+
+// List every device of every platform.
+cl_int catalogueCreate(Catalogue* catalogue);
+
+// Fill in the probe results, from the cache file if it has them (and
+// 'refresh' is 0), and by probing otherwise; then write the cache file
+// back.  'kernelPath' is a file with the Runtime's saxpy kernel.  A
+// device that fails to probe is reported and left out of the choice.
+cl_int catalogueProbe(Catalogue* catalogue, char const* cachePath,
+                      char const* kernelPath, int refresh);
+
+// The estimated time, in seconds, of a reference job on a device: a
+// saxpy of 16M elements, copied from and back to the host.  Lower is
+// better; negative if the device wasn't probed.
+double catalogueScore(CatalogueDevice const* device);
+
+// Return the index in the catalogue of the device given by 'choice'
+// ("platform:device", or part of a device name), or -1.
+int catalogueFind(Catalogue const* catalogue, char const* choice);
+
+// Return the index of the device to use: the one given by 'choice' if it
+// is not NULL, else by the environment variable if it is set, else the
+// probed device with the best score.  -1 if there is none.
+int catalogueSelect(Catalogue const* catalogue, char const* choice);
+
+// Point the runtime options at a device of the catalogue.
+void catalogueApply(CatalogueDevice const* device, RuntimeOptions* options);
+
+// Print the catalogue, marking the device at index 'selected'.
+void cataloguePrint(Catalogue const* catalogue, int selected);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
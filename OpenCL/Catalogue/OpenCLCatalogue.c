@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Catalogue.h"
+
+// This sample lists every OpenCL device (including CPU devices), probes
+// their transfer bandwidth, launch latency and saxpy throughput (or takes
+// the results from devices.cache), and picks the best one, instead of
+// the first device of the first platform as the Minimal sample does.  It
+// then runs a saxpy (z=a*x+y) on the chosen device.
+//
+// The choice can be overridden on the command line, or with the
+// OPENCL_DEVICE environment variable, as "platform:device" or as part of
+// the device name.
+
+int main(int argc, char** argv)
+{
+    // OpenCLCatalogue [--refresh] [--cache file] [device]
+    int refresh = 0;
+    char const* cachePath = "devices.cache";
+    char const* choice = NULL;
+    for (int i = 1; i < argc; ++ i)
+    {
+        if (0 == strcmp(argv[i], "--refresh"))
+        {
+            refresh = 1;
+        }
+        else if (0 == strcmp(argv[i], "--cache") && i + 1 < argc)
+        {
+            cachePath = argv[++ i];
+        }
+        else if ('-' != argv[i][0] && NULL == choice)
+        {
+            choice = argv[i];
+        }
+        else
+        {
+            printf("Usage: %s [--refresh] [--cache file] [device]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Catalogue catalogue;
+    cl_int r = catalogueCreate(&catalogue);
+    if (CL_SUCCESS != r)
+        return r;
+    r = catalogueProbe(&catalogue, cachePath, "../Runtime/kernel.cl", refresh);
+    if (CL_SUCCESS != r)
+        return r;
+    int const selected = catalogueSelect(&catalogue, choice);
+    cataloguePrint(&catalogue, selected);
+    if (selected < 0)
+    {
+        printf("No usable device\n");
+        return 1;
+    }
+    CatalogueDevice const* device = &catalogue.devices[selected];
+    printf("Using %u:%u %s\n", device->platformIndex, device->deviceIndex,
+           device->deviceName);
+
+    // Run the Minimal sample's computation on the chosen device.
+    RuntimeOptions options;
+    runtimeDefaultOptions(&options);
+    catalogueApply(device, &options);
+    options.kernelPath = "../Runtime/kernel.cl";
+    Runtime runtime;
+    r = runtimeCreate(&runtime, &options);
+    if (CL_SUCCESS != r)
+        return r;
+
+    size_t const dimension = (size_t) 1 << 20;
+    float const a = 2.0f;
+    float* x = (float*) malloc(sizeof(float) * dimension);
+    float* y = (float*) malloc(sizeof(float) * dimension);
+    float* z = (float*) malloc(sizeof(float) * dimension);
+    if (NULL == x || NULL == y || NULL == z)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+    r = runtimeSaxpy(&runtime, a, x, y, z, dimension);
+    if (CL_SUCCESS != r)
+        return r;
+
+    // Check that results are correct.  Note that the code below depends
+    // on the computation being exact.
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                   x[i], a, y[i], z[i]);
+            return 100;
+        }
+    }
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory, and release the runtime.
+    free(x);
+    free(y);
+    free(z);
+    runtimeRelease(&runtime);
+
+    return 0;
+}
@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "CoExecution.h"
+
+// Ranges start on 16-element (64-byte) boundaries, so that no two
+// threads, or the device and a thread, write to the same cache line.
+static size_t const alignment = 16;
+
+static double now()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// z = a*x + y over 'count' elements.  Multiply and add are separate, as
+// in the OpenCL kernel without -cl-mad-enable.
+static void saxpyRange(float a, float const* x, float const* y, float* z,
+                       size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX__)
+    __m256 const va = _mm256_set1_ps(a);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 const ax = _mm256_mul_ps(va, _mm256_loadu_ps(x + i));
+        _mm256_storeu_ps(z + i, _mm256_add_ps(ax, _mm256_loadu_ps(y + i)));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 const va = _mm_set1_ps(a);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 const ax = _mm_mul_ps(va, _mm_loadu_ps(x + i));
+        _mm_storeu_ps(z + i, _mm_add_ps(ax, _mm_loadu_ps(y + i)));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t const va = vdupq_n_f32(a);
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t const ax = vmulq_f32(va, vld1q_f32(x + i));
+        vst1q_f32(z + i, vaddq_f32(ax, vld1q_f32(y + i)));
+    }
+#endif
+    for (; i < count; ++ i)
+    {
+        z[i] = a*x[i] + y[i];
+    }
+}
+
+char const* CpuExecutor::instructionSet()
+{
+#if defined(__AVX__)
+    return "AVX";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "SSE2";
+#elif defined(__ARM_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+CpuExecutor::CpuExecutor(unsigned threadCount)
+    : generation_(0), busy_(0), stop_(false),
+      a_(0.0f), x_(NULL), y_(NULL), z_(NULL), count_(0)
+{
+    if (0 == threadCount)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    // The calling thread is the first one.
+    for (unsigned t = 1; t < threadCount; ++ t)
+    {
+        workers_.emplace_back(&CpuExecutor::work, this, t);
+    }
+}
+
+CpuExecutor::~CpuExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (std::thread& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void CpuExecutor::work(unsigned index)
+{
+    unsigned long seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+        }
+        run(index);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (0 == -- busy_)
+            done_.notify_one();
+    }
+}
+
+void CpuExecutor::run(unsigned index)
+{
+    size_t const blocks = (count_ + alignment - 1) / alignment;
+    size_t const threads = threadCount();
+    size_t const begin = std::min(count_, blocks * index / threads * alignment);
+    size_t const end = std::min(count_, blocks * (index + 1) / threads * alignment);
+    if (begin < end)
+        saxpyRange(a_, x_ + begin, y_ + begin, z_ + begin, end - begin);
+}
+
+void CpuExecutor::saxpy(float a, float const* x, float const* y, float* z,
+                        size_t count)
+{
+    std::lock_guard<std::mutex> job(job_);
+    // TODO: Small jobs may be faster on fewer threads, or on the calling
+    // thread alone.
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        a_ = a;
+        x_ = x;
+        y_ = y;
+        z_ = z;
+        count_ = count;
+        busy_ = (unsigned) workers_.size();
+        ++ generation_;
+    }
+    start_.notify_all();
+    run(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return 0 == busy_; });
+}
+
+CoExecutor::CoExecutor(Runtime* runtime, CpuExecutor* cpu)
+    : runtime_(runtime), cpu_(cpu), deviceShare_(runtime ? 0.5 : 0.0)
+{
+}
+
+void CoExecutor::setDeviceShare(double share)
+{
+    deviceShare_ = runtime_ ? std::min(1.0, std::max(0.0, share)) : 0.0;
+}
+
+cl_int CoExecutor::saxpy(float a, float const* x, float const* y, float* z,
+                         size_t count)
+{
+    size_t deviceCount = (size_t) (deviceShare_ * count);
+    if (deviceCount < count)
+        deviceCount -= deviceCount % alignment;
+    if (0 == deviceCount)
+    {
+        cpu_->saxpy(a, x, y, z, count);
+        return CL_SUCCESS;
+    }
+    if (count == deviceCount)
+        return runtimeSaxpy(runtime_, a, x, y, z, count);
+
+    // Start the device's part, and have it submitted before the CPU gets
+    // busy with the rest.
+    size_t const size = deviceCount * sizeof(cl_float);
+    cl_mem buffers[3] = {0, 0, 0};
+    cl_int r = CL_SUCCESS;
+    for (int b = 0; b < 3 && CL_SUCCESS == r; ++ b)
+    {
+        buffers[b] = runtimeAcquireBuffer(runtime_, size, &r);
+    }
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime_->queue, buffers[0], CL_FALSE, 0, size, x,
+                                 0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime_->queue, buffers[1], CL_FALSE, 0, size, y,
+                                 0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = runtimeEnqueueSaxpy(runtime_, a, buffers[0], buffers[1], buffers[2],
+                                deviceCount, 0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clEnqueueReadBuffer(runtime_->queue, buffers[2], CL_FALSE, 0, size, z,
+                                0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clFlush(runtime_->queue);
+
+    if (CL_SUCCESS == r)
+        cpu_->saxpy(a, x + deviceCount, y + deviceCount, z + deviceCount,
+                    count - deviceCount);
+
+    // Wait for the device even after a failure, before its buffers go
+    // back to the pool.
+    cl_int const finished = clFinish(runtime_->queue);
+    if (CL_SUCCESS == r)
+        r = finished;
+    for (cl_mem buffer : buffers)
+    {
+        if (buffer)
+            runtimeReleaseBuffer(runtime_, buffer);
+    }
+    return r;
+}
+
+cl_int CoExecutor::measure(double share, float const* x, float const* y, float* z,
+                           size_t count, int repeats, double* seconds)
+{
+    setDeviceShare(share);
+    std::vector<double> times;
+    cl_int r = CL_SUCCESS;
+    // One more run than measured, to warm up the buffer pool.
+    for (int t = -1; t < repeats && CL_SUCCESS == r; ++ t)
+    {
+        double const start = now();
+        r = saxpy(2.0f, x, y, z, count);
+        if (t >= 0)
+            times.push_back(now() - start);
+    }
+    if (CL_SUCCESS != r)
+        return r;
+    std::sort(times.begin(), times.end());
+    *seconds = times[times.size() / 2];
+    return CL_SUCCESS;
+}
+
+cl_int CoExecutor::calibrate(float const* x, float const* y, float* z, size_t count,
+                             int repeats)
+{
+    if (!runtime_)
+        return CL_SUCCESS;
+
+    // The share that would make both sides finish together, if neither
+    // slowed the other down.
+    double device = 0.0;
+    double cpu = 0.0;
+    cl_int r = measure(1.0, x, y, z, count, repeats, &device);
+    if (CL_SUCCESS == r)
+        r = measure(0.0, x, y, z, count, repeats, &cpu);
+    if (CL_SUCCESS != r)
+    {
+        printf("Calibration failed with return code %d\n", r);
+        return r;
+    }
+    double const estimate = cpu / (device + cpu);
+
+    // They do compete, for memory bandwidth and for the host thread that
+    // feeds the device, so try a few shares around the estimate too.
+    // TODO: Search more finely if the best share matters to you.
+    double bestShare = device < cpu ? 1.0 : 0.0;
+    double best = std::min(device, cpu);
+    double const candidates[] = {estimate - 0.1, estimate, estimate + 0.1};
+    for (double share : candidates)
+    {
+        if (share <= 0.0 || share >= 1.0)
+            continue;
+        double seconds = 0.0;
+        r = measure(share, x, y, z, count, repeats, &seconds);
+        if (CL_SUCCESS != r)
+        {
+            printf("Calibration failed with return code %d\n", r);
+            return r;
+        }
+        if (seconds < best)
+        {
+            bestShare = share;
+            best = seconds;
+        }
+    }
+    setDeviceShare(bestShare);
+    return CL_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#ifndef COEXECUTION_H
+#define COEXECUTION_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Runtime.h"
+
+// A native CPU executor for the same saxpy contract as the Runtime
+// library (see ../Runtime), z = a*x + y over 'count' elements of host
+// arrays, and a co-executor that splits each job between an OpenCL
+// device and the CPU.
+//
+// CpuExecutor keeps a pool of std::threads.  A job is split into equal
+// ranges, one per thread, and the calling thread runs the first range
+// itself.  Each range is computed with SIMD intrinsics: AVX if the
+// compiler targets it, else SSE2 or NEON, else plain C++.
+//
+// CoExecutor gives the first part of a job to the device, with pooled
+// buffers from the runtime, and the rest to the CPU executor, and waits
+// for both.  The device's share is measured by calibrate.  Without a
+// runtime everything runs on the CPU, so it also serves as a fallback
+// on hosts without a suitable OpenCL device.
+
+class CpuExecutor
+{
+public:
+    // 0 threads means one per hardware thread.
+    explicit CpuExecutor(unsigned threadCount = 0);
+    ~CpuExecutor();
+
+    unsigned threadCount() const { return (unsigned) workers_.size() + 1; }
+
+    // z = a*x + y, and wait for it.  Jobs from several threads at once
+    // are run one after another.
+    void saxpy(float a, float const* x, float const* y, float* z, size_t count);
+
+    // The instruction set the ranges are computed with.
+    static char const* instructionSet();
+
+    CpuExecutor(CpuExecutor const&) = delete;
+    CpuExecutor& operator=(CpuExecutor const&) = delete;
+
+private:
+    void work(unsigned index);
+    // Compute range 'index' of the current job.
+    void run(unsigned index);
+
+    std::vector<std::thread> workers_;
+    // Serializes jobs.
+    std::mutex job_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    // Bumped for every job; the workers still busy with it.
+    unsigned long generation_;
+    unsigned busy_;
+    bool stop_;
+    // The current job.
+    float a_;
+    float const* x_;
+    float const* y_;
+    float* z_;
+    size_t count_;
+};
+
+class CoExecutor
+{
+public:
+    // 'runtime' may be null, to run everything on the CPU.  Both must
+    // outlive the CoExecutor, and the runtime must not be used by other
+    // threads meanwhile.
+    CoExecutor(Runtime* runtime, CpuExecutor* cpu);
+
+    bool hasDevice() const { return NULL != runtime_; }
+    // The fraction of each job that goes to the device, from 0 to 1.
+    double deviceShare() const { return deviceShare_; }
+    void setDeviceShare(double share);
+
+    // Time the device and the CPU alone on 'count' elements, estimate
+    // the share from their throughputs, and then keep whichever share
+    // around the estimate runs fastest together.  z is overwritten.
+    cl_int calibrate(float const* x, float const* y, float* z, size_t count,
+                     int repeats);
+
+    // z = a*x + y, and wait for it.
+    cl_int saxpy(float a, float const* x, float const* y, float* z, size_t count);
+
+    CoExecutor(CoExecutor const&) = delete;
+    CoExecutor& operator=(CoExecutor const&) = delete;
+
+private:
+    // The median time of 'repeats' jobs with the given share.
+    cl_int measure(double share, float const* x, float const* y, float* z,
+                   size_t count, int repeats, double* seconds);
+
+    Runtime* runtime_;
+    CpuExecutor* cpu_;
+    double deviceShare_;
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "CoExecution.h"
+
+// This sample runs a saxpy (z=a*x+y) on host arrays with a native CPU
+// executor, on an OpenCL GPU, and on both at once (see CoExecution.h).
+//
+// First it measures how the CPU executor scales from 1 thread up to one
+// per hardware thread.  Then it looks for a GPU; unlike the Minimal
+// sample, it carries on with the CPU alone if there is none.  If there is
+// one, it calibrates the GPU's share of each job, and compares the GPU
+// alone, the CPU alone and both together.
+
+static double now()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Check that results are correct.  Like the Minimal sample, this depends
+// on the computation being exact.
+static bool check(float a, std::vector<float> const& x, std::vector<float> const& y,
+                  std::vector<float> const& z)
+{
+    for (size_t i = 0; i < x.size(); ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                   x[i], a, y[i], z[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// The median time of 'repeats' jobs, after one to warm up, with z
+// cleared first so that a job that does nothing can't pass the check.
+template <typename Job>
+static double median(Job job, std::vector<float>& z, int repeats, cl_int* error)
+{
+    std::fill(z.begin(), z.end(), 0.0f);
+    std::vector<double> times;
+    *error = CL_SUCCESS;
+    for (int t = -1; t < repeats && CL_SUCCESS == *error; ++ t)
+    {
+        double const start = now();
+        *error = job();
+        if (t >= 0)
+            times.push_back(now() - start);
+    }
+    if (times.empty())
+        return 0.0;
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLCoExecution [elements [repeats [threads]]]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : 1 << 24;
+    int const repeats = argc > 2 ? atoi(argv[2]) : 10;
+    unsigned const maxThreads = argc > 3 ? (unsigned) atoi(argv[3])
+                                         : std::max(1u, std::thread::hardware_concurrency());
+    if (0 == dimension || repeats < 1 || 0 == maxThreads)
+    {
+        printf("Usage: %s [elements [repeats [threads]]]\n", argv[0]);
+        return 1;
+    }
+
+    // Set values to something easy to verify.
+    float const a = 2.0f;
+    std::vector<float> x(dimension);
+    std::vector<float> y(dimension);
+    std::vector<float> z(dimension);
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+    double const bytes = 3.0 * dimension * sizeof(float);
+    cl_int r = CL_SUCCESS;
+
+    // CPU scaling: 1, 2, 4, ... threads, and the maximum.
+    printf("CPU executor (%s), %zu elements\n", CpuExecutor::instructionSet(), dimension);
+    printf("%8s %11s %9s %8s\n", "threads", "median", "GB/s", "speedup");
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+    double single = 0.0;
+    for (unsigned threads : threadCounts)
+    {
+        CpuExecutor cpu(threads);
+        double const seconds = median([&]
+        {
+            cpu.saxpy(a, x.data(), y.data(), z.data(), dimension);
+            return CL_SUCCESS;
+        }, z, repeats, &r);
+        if (!check(a, x, y, z))
+            return 100;
+        if (1 == threads)
+            single = seconds;
+        printf("%8u %8.3f ms %9.2f %7.2fx\n", threads, seconds * 1e3,
+               bytes / seconds * 1e-9, single / seconds);
+    }
+
+    // TODO: Pick the platform and device that suit your needs; a CPU
+    // OpenCL device would compete with the executor for the same cores.
+    RuntimeOptions options;
+    runtimeDefaultOptions(&options);
+    options.kernelPath = "../Runtime/kernel.cl";
+    options.deviceType = CL_DEVICE_TYPE_GPU;
+    Runtime runtime;
+    bool const hasGpu = CL_SUCCESS == runtimeCreate(&runtime, &options);
+    if (!hasGpu)
+        printf("No OpenCL GPU is available; running on the CPU alone.\n");
+
+    {
+        CpuExecutor cpu(maxThreads);
+        CoExecutor co(hasGpu ? &runtime : NULL, &cpu);
+        r = co.calibrate(x.data(), y.data(), z.data(), dimension, repeats);
+        if (CL_SUCCESS != r)
+            return r;
+        double const share = co.deviceShare();
+
+        printf("%-26s %11s %9s\n", "", "median", "GB/s");
+        double const shares[] = {1.0, 0.0, share};
+        char const* const names[] = {"GPU alone", "CPU alone", "GPU and CPU"};
+        for (int s = 0; s < 3; ++ s)
+        {
+            if (!hasGpu && 1 != s)
+                continue;
+            co.setDeviceShare(shares[s]);
+            double const seconds = median([&]
+            {
+                return co.saxpy(a, x.data(), y.data(), z.data(), dimension);
+            }, z, repeats, &r);
+            if (CL_SUCCESS != r)
+            {
+                printf("%s failed with return code %d\n", names[s], r);
+                return r;
+            }
+            if (!check(a, x, y, z))
+                return 100;
+            char name[64];
+            snprintf(name, sizeof(name), 2 == s ? "%s (%.0f%% on GPU)" : "%s",
+                     names[s], 100.0 * shares[s]);
+            printf("%-26s %8.3f ms %9.2f\n", name, seconds * 1e3,
+                   bytes / seconds * 1e-9);
+        }
+    }
+    printf("Computation appears to have completed successfully.\n");
+
+    if (hasGpu)
+        runtimeRelease(&runtime);
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <stdio.h>
+
+// A build tool that writes a file's bytes as a C array, so that the file
+// can be built into an executable:
+//
+//   embed name input output.h
+//
+// The header defines 'static unsigned char const name[]' with the bytes
+// and a terminating zero (so that text can be used as a string), and
+// 'static size_t const nameSize' with the number of bytes without it.
+
+int main(int argc, char** argv)
+{
+    if (4 != argc)
+    {
+        printf("Usage: %s name input output.h\n", argv[0]);
+        return 1;
+    }
+    char const* name = argv[1];
+    FILE* input = fopen(argv[2], "rb");
+    if (NULL == input)
+    {
+        printf("Unable to open %s\n", argv[2]);
+        return 2;
+    }
+    FILE* output = fopen(argv[3], "w");
+    if (NULL == output)
+    {
+        printf("Unable to create %s\n", argv[3]);
+        fclose(input);
+        return 3;
+    }
+
+    fprintf(output, "// Generated from %s by embed; do not edit.\n", argv[2]);
+    fprintf(output, "#include <stddef.h>\n\n");
+    fprintf(output, "static unsigned char const %s[] =\n{", name);
+    unsigned long size = 0;
+    for (int c = fgetc(input); EOF != c; c = fgetc(input))
+    {
+        fprintf(output, "%s0x%02x,", 0 == size % 12 ? "\n    " : " ", c);
+        ++ size;
+    }
+    fprintf(output, "%s0x00\n};\n", 0 == size % 12 ? "\n    " : " ");
+    fprintf(output, "static size_t const %sSize = %lu;\n", name, size);
+
+    int const failed = ferror(input) || ferror(output);
+    fclose(input);
+    if (0 != fclose(output) || failed)
+    {
+        printf("Unable to write %s\n", argv[3]);
+        remove(argv[3]);
+        return 4;
+    }
+    return 0;
+}
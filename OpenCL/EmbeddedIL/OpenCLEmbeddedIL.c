@@ -0,0 +1,358 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <CL/opencl.h>
+#include "kernel_cl.h"
+#include "kernel_spv.h"
+
+// This sample is the Minimal sample's saxpy (z=a*x+y) with the kernel
+// built into the executable (see the Makefile), in two forms: SPIR-V
+// compiled ahead of time, and the OpenCL C text.  It compares the cold
+// start, from creating the context to the first result, of three ways to
+// get the program:
+//
+//   file    Read kernel.cl from the working directory and compile it, as
+//           the Minimal sample does.
+//   source  Compile the embedded text.
+//   il      Create the program from the embedded SPIR-V with
+//           clCreateProgramWithIL (or clCreateProgramWithILKHR), which
+//           skips the OpenCL C front end.  Devices without SPIR-V
+//           support use the embedded source instead.
+//
+// Drivers load their compiler on first use, and may cache programs across
+// contexts and processes, so for a true cold start run one way per
+// process, e.g. "OpenCLEmbeddedIL il 1".
+
+enum { FROM_FILE, FROM_SOURCE, FROM_IL, WAYS };
+static char const* const wayNames[WAYS] = {"file", "source", "il"};
+
+typedef cl_program (CL_API_CALL* CreateProgramWithIL)(cl_context, void const*,
+                                                      size_t, cl_int*);
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int compareDoubles(void const* a, void const* b)
+{
+    double const x = *(double const*) a;
+    double const y = *(double const*) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Read a whole file into a null-terminated string, or return NULL.
+static char* readFile(char const* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (NULL == file)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* contents = size >= 0 ? (char*) malloc(size + 1) : NULL;
+    if (NULL != contents && size != (long) fread(contents, 1, size, file))
+    {
+        free(contents);
+        contents = NULL;
+    }
+    fclose(file);
+    if (NULL != contents)
+        contents[size] = 0;
+    return contents;
+}
+
+// Return the function that creates a program from SPIR-V on the device,
+// or NULL if the device (or the embedded SPIR-V) can't be used.
+static CreateProgramWithIL findCreateProgramWithIL(cl_platform_id platform,
+                                                   cl_device_id device)
+{
+    if (0 == kernelSpirvSize)
+        return NULL;
+
+    // The ILs the device takes, e.g. "SPIR-V_1.0 SPIR-V_1.2".  The query
+    // (CL_DEVICE_IL_VERSION, or CL_DEVICE_IL_VERSION_KHR with
+    // cl_khr_il_program) fails on devices without any.
+    char ils[256] = "";
+    if (CL_SUCCESS != clGetDeviceInfo(device, 0x105B, sizeof(ils), ils, NULL)
+        || NULL == strstr(ils, "SPIR-V"))
+    {
+        return NULL;
+    }
+
+    // The SPIR-V is 64-bit (see the Makefile).
+    // TODO: Build a 32-bit variant too (-target spir) for other devices.
+    cl_uint addressBits = 0;
+    clGetDeviceInfo(device, CL_DEVICE_ADDRESS_BITS, sizeof(addressBits),
+                    &addressBits, NULL);
+    if (64 != addressBits)
+        return NULL;
+
+    CreateProgramWithIL create = (CreateProgramWithIL)
+        clGetExtensionFunctionAddressForPlatform(platform, "clCreateProgramWithILKHR");
+#ifdef CL_VERSION_2_1
+    if (NULL == create)
+        create = clCreateProgramWithIL;
+#endif
+    return create;
+}
+
+// Create and build the program one way.  'used' is set to the way
+// actually used.
+static cl_int buildProgram(int way, cl_context context, cl_device_id device,
+                           CreateProgramWithIL createWithIL, cl_program* program,
+                           int* used)
+{
+    cl_int r = CL_SUCCESS;
+    *program = 0;
+    if (FROM_IL == way && NULL == createWithIL)
+        way = FROM_SOURCE;
+    *used = way;
+    if (FROM_FILE == way)
+    {
+        char* source = readFile("kernel.cl");
+        if (NULL == source)
+        {
+            printf("Unable to read kernel.cl from the working directory\n");
+            return CL_INVALID_VALUE;
+        }
+        char const* sourceLines[1] = {source};
+        *program = clCreateProgramWithSource(context, 1, sourceLines, NULL, &r);
+        free(source);
+    }
+    else if (FROM_SOURCE == way)
+    {
+        char const* sourceLines[1] = {(char const*) kernelSource};
+        size_t const lengths[1] = {kernelSourceSize};
+        *program = clCreateProgramWithSource(context, 1, sourceLines, lengths, &r);
+    }
+    else
+    {
+        *program = createWithIL(context, kernelSpirv, kernelSpirvSize, &r);
+    }
+    if (CL_SUCCESS != r)
+    {
+        printf("Creating the program from %s failed with return code %d\n",
+               wayNames[way], r);
+        return r;
+    }
+
+    // A program from SPIR-V still needs clBuildProgram, which only runs
+    // the back end.
+    r = clBuildProgram(*program, 1, &device, NULL, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clBuildProgram failed with return value %d; error log:\n", r);
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(*program, device, CL_PROGRAM_BUILD_LOG,
+                                            sizeof(buildLog), buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            printf("%s\n", buildLog);
+        }
+    }
+    return r;
+}
+
+// Everything from creating the context to the first result, one way.
+// 'programTime' is the part spent getting a built program.
+static cl_int coldStart(int way, cl_device_id device, CreateProgramWithIL createWithIL,
+                        float a, float const* x, float const* y, float* z,
+                        size_t dimension, double* totalTime, double* programTime,
+                        int* used)
+{
+    double const start = now();
+    cl_int r = CL_SUCCESS;
+    cl_context context = clCreateContext(0, 1, &device, NULL, NULL, &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return code %d\n", r);
+        return r;
+    }
+    cl_command_queue queue = clCreateCommandQueue(context, device, 0, &r);
+    cl_program program = 0;
+    cl_kernel kernel = 0;
+    cl_mem devX = 0;
+    cl_mem devY = 0;
+    cl_mem devZ = 0;
+    double const programStart = now();
+    if (CL_SUCCESS == r)
+        r = buildProgram(way, context, device, createWithIL, &program, used);
+    if (CL_SUCCESS == r)
+        kernel = clCreateKernel(program, "saxpy", &r);
+    *programTime = now() - programStart;
+
+    size_t const size = dimension * sizeof(cl_float);
+    if (CL_SUCCESS == r)
+        devX = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size,
+                              (void*) x, &r);
+    if (CL_SUCCESS == r)
+        devY = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size,
+                              (void*) y, &r);
+    if (CL_SUCCESS == r)
+        devZ = clCreateBuffer(context, CL_MEM_WRITE_ONLY, size, NULL, &r);
+    cl_ulong const count = dimension;
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 0, sizeof(cl_mem), &devX);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 1, sizeof(cl_mem), &devY);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 2, sizeof(cl_mem), &devZ);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 4, sizeof(cl_ulong), &count);
+    if (CL_SUCCESS == r)
+        r = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &dimension, NULL,
+                                   0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clEnqueueReadBuffer(queue, devZ, CL_TRUE, 0, size, z, 0, NULL, NULL);
+    *totalTime = now() - start;
+    if (CL_SUCCESS != r)
+        printf("Running the kernel from %s failed with return code %d\n",
+               wayNames[way], r);
+
+    if (devX)
+        clReleaseMemObject(devX);
+    if (devY)
+        clReleaseMemObject(devY);
+    if (devZ)
+        clReleaseMemObject(devZ);
+    if (kernel)
+        clReleaseKernel(kernel);
+    if (program)
+        clReleaseProgram(program);
+    if (queue)
+        clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+    return r;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLEmbeddedIL [file|source|il|all [runs]]
+    int first = 0;
+    int last = WAYS - 1;
+    if (argc > 1 && 0 != strcmp(argv[1], "all"))
+    {
+        for (first = 0; first < WAYS && 0 != strcmp(argv[1], wayNames[first]); ++ first)
+        {
+        }
+        last = first;
+    }
+    int const runs = argc > 2 ? atoi(argv[2]) : 5;
+    if (first >= WAYS || runs < 1)
+    {
+        printf("Usage: %s [file|source|il|all [runs]]\n", argv[0]);
+        return 1;
+    }
+
+    // TODO: Choose the platform and device that suit your needs.
+    cl_platform_id platform = 0;
+    cl_int r = clGetPlatformIDs(1, &platform, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+    cl_device_id device = 0;
+    r = clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 1, &device, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+    CreateProgramWithIL const createWithIL = findCreateProgramWithIL(platform, device);
+    printf("Embedded: %zu bytes of source, %zu bytes of SPIR-V (%s on this device)\n",
+           kernelSourceSize, kernelSpirvSize,
+           createWithIL ? "usable" : "not usable; il uses the source");
+
+    // Set values to something easy to verify.
+    size_t const dimension = 1 << 16;
+    float const a = 2.0f;
+    float* x = (float*) malloc(sizeof(float) * dimension);
+    float* y = (float*) malloc(sizeof(float) * dimension);
+    float* z = (float*) malloc(sizeof(float) * dimension);
+    double* totals = (double*) malloc(sizeof(double) * runs);
+    double* programs = (double*) malloc(sizeof(double) * runs);
+    if (NULL == x || NULL == y || NULL == z || NULL == totals || NULL == programs)
+    {
+        printf("Unable to allocate host memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+
+    printf("%-7s %-7s %12s %12s %12s\n", "way", "used", "first", "median",
+           "program");
+    int failed = 0;
+    for (int way = first; way <= last; ++ way)
+    {
+        // When measuring every way, the file way is skipped if kernel.cl
+        // isn't in the working directory; the embedded ways don't need it.
+        // Any other failure fails the sample.
+        if (FROM_FILE == way && first != last)
+        {
+            FILE* file = fopen("kernel.cl", "rb");
+            if (NULL == file)
+            {
+                printf("%-7s skipped: no kernel.cl in the working directory\n",
+                       wayNames[way]);
+                continue;
+            }
+            fclose(file);
+        }
+        int used = way;
+        for (int run = 0; run < runs && CL_SUCCESS == r; ++ run)
+        {
+            memset(z, 0, sizeof(float) * dimension);
+            r = coldStart(way, device, createWithIL, a, x, y, z, dimension,
+                          &totals[run], &programs[run], &used);
+            // Check that results are correct.  Note that the code below
+            // depends on the computation being exact.
+            for (size_t i = 0; i < dimension && CL_SUCCESS == r; ++ i)
+            {
+                if (x[i]*a + y[i] != z[i])
+                {
+                    printf("Unexpected result at element %zu:\n", i);
+                    printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                           x[i], a, y[i], z[i]);
+                    return 100;
+                }
+            }
+        }
+        if (CL_SUCCESS != r)
+        {
+            // Keep measuring the other ways, but report the failure.
+            printf("%-7s failed\n", wayNames[way]);
+            failed = 1;
+            r = CL_SUCCESS;
+            continue;
+        }
+        double const firstTime = totals[0];
+        qsort(totals, runs, sizeof(double), compareDoubles);
+        qsort(programs, runs, sizeof(double), compareDoubles);
+        printf("%-7s %-7s %9.3f ms %9.3f ms %9.3f ms\n", wayNames[way], wayNames[used],
+               firstTime * 1e3, totals[runs / 2] * 1e3, programs[runs / 2] * 1e3);
+    }
+    if (!failed)
+        printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(x);
+    free(y);
+    free(z);
+    free(totals);
+    free(programs);
+
+    return failed;
+}
@@ -0,0 +1,17 @@
+// This kernel computes z = a*x + y over 'count' elements.
+//
+// The Makefile compiles it to SPIR-V ahead of time, and also embeds the
+// text itself, so the executable needs neither this file nor (on
+// devices that take SPIR-V) the OpenCL C front end at run time.
+
+__kernel void saxpy(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong count)
+{
+    // Get element index n.
+    size_t n = get_global_id(0);
+
+    if (n < count)
+    {
+        z[n] = a*x[n] + y[n];
+    }
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include "Fusion.h"
+
+void KernelBuilder::vector(cl_mem buffer, size_t count)
+{
+    if (vectors_.empty())
+        count_ = count;
+    else if (count != count_)
+        mismatch_ = true;
+
+    // A vector that appears twice, as in x*x, is one argument.
+    size_t index = 0;
+    while (index < vectors_.size() && vectors_[index] != buffer)
+    {
+        ++ index;
+    }
+    if (index == vectors_.size())
+        vectors_.push_back(buffer);
+    expression_ += "v" + std::to_string(index) + "[n]";
+}
+
+void KernelBuilder::scalar(float value)
+{
+    expression_ += "s" + std::to_string(scalars_.size());
+    scalars_.push_back(value);
+}
+
+std::string KernelBuilder::source() const
+{
+    // Contraction into fma is off, so that the results match the same
+    // expression computed on the host operation by operation.
+    // TODO: Remove the pragma if you'd rather have the speed of fma.
+    std::string source = "#pragma OPENCL FP_CONTRACT OFF\n"
+                         "__kernel void fused(__global float* out";
+    for (size_t v = 0; v < vectors_.size(); ++ v)
+    {
+        source += ", __global float const* v" + std::to_string(v);
+    }
+    for (size_t s = 0; s < scalars_.size(); ++ s)
+    {
+        source += ", float s" + std::to_string(s);
+    }
+    source += ", ulong count)\n"
+              "{\n"
+              "    size_t n = get_global_id(0);\n"
+              "    if (n < count)\n"
+              "    {\n"
+              "        out[n] = " + expression_ + ";\n"
+              "    }\n"
+              "}\n";
+    return source;
+}
+
+Vector::Vector(Fusion& fusion, size_t count, cl_int* error)
+    : fusion_(&fusion), buffer_(0), count_(count)
+{
+    buffer_ = runtimeAcquireBuffer(fusion.runtime(), count * sizeof(cl_float), error);
+    if (CL_SUCCESS != *error)
+        printf("Unable to create a vector of %zu elements, return code %d\n",
+               count, *error);
+}
+
+Vector::~Vector()
+{
+    if (buffer_)
+        runtimeReleaseBuffer(fusion_->runtime(), buffer_);
+}
+
+cl_int Vector::write(float const* source)
+{
+    return clEnqueueWriteBuffer(fusion_->runtime()->queue, buffer_, CL_FALSE, 0,
+                                count_ * sizeof(cl_float), source, 0, NULL, NULL);
+}
+
+cl_int Vector::read(float* destination)
+{
+    return clEnqueueReadBuffer(fusion_->runtime()->queue, buffer_, CL_TRUE, 0,
+                               count_ * sizeof(cl_float), destination, 0, NULL, NULL);
+}
+
+Vector& Vector::operator=(Vector const& other)
+{
+    if (this != &other)
+        fusion_->record(fusion_->assign(*this, other));
+    return *this;
+}
+
+Fusion::Fusion(Runtime* runtime)
+    : runtime_(runtime), status_(CL_SUCCESS), hits_(0), builds_(0)
+{
+}
+
+Fusion::~Fusion()
+{
+    for (auto& entry : cache_)
+    {
+        clReleaseKernel(entry.second.kernel);
+        clReleaseProgram(entry.second.program);
+    }
+}
+
+cl_kernel Fusion::kernel(KernelBuilder const& builder, cl_int* error)
+{
+    auto const found = cache_.find(builder.expression());
+    if (cache_.end() != found)
+    {
+        ++ hits_;
+        *error = CL_SUCCESS;
+        return found->second.kernel;
+    }
+
+    // Not built yet.
+    // TODO: Evict kernels if your program generates an unbounded number
+    // of shapes; see the Specialize sample for a least recently used cache.
+    std::string const source = builder.source();
+    char const* sourceLines[1] = {source.c_str()};
+    Entry entry = {0, 0};
+    entry.program = clCreateProgramWithSource(runtime_->context, 1, sourceLines, NULL,
+                                              error);
+    if (CL_SUCCESS != *error)
+    {
+        printf("clCreateProgramWithSource failed with return code %d\n", *error);
+        return 0;
+    }
+    *error = clBuildProgram(entry.program, 1, &runtime_->device, NULL, NULL, NULL);
+    if (CL_SUCCESS != *error)
+    {
+        printf("clBuildProgram failed with return value %d; source:\n%s\nerror log:\n",
+               *error, source.c_str());
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(entry.program, runtime_->device,
+                                            CL_PROGRAM_BUILD_LOG, sizeof(buildLog),
+                                            buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            printf("%s\n", buildLog);
+        }
+        clReleaseProgram(entry.program);
+        return 0;
+    }
+    entry.kernel = clCreateKernel(entry.program, "fused", error);
+    if (CL_SUCCESS != *error)
+    {
+        printf("clCreateKernel failed with return code %d\n", *error);
+        clReleaseProgram(entry.program);
+        return 0;
+    }
+    ++ builds_;
+    cache_[builder.expression()] = entry;
+    return entry.kernel;
+}
+
+cl_int Fusion::launch(Vector& out, KernelBuilder const& builder)
+{
+    if (builder.mismatch()
+        || (!builder.vectors().empty() && builder.count() != out.count()))
+    {
+        printf("The vectors of an expression must all have the same length\n");
+        return CL_INVALID_VALUE;
+    }
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = this->kernel(builder, &r);
+    if (CL_SUCCESS != r)
+        return r;
+
+    // The output, the vectors, the scalars, and the length, in the order
+    // KernelBuilder::source declares them.
+    cl_uint arg = 0;
+    cl_mem const buffer = out.buffer();
+    r = clSetKernelArg(kernel, arg++, sizeof(cl_mem), &buffer);
+    for (size_t v = 0; v < builder.vectors().size() && CL_SUCCESS == r; ++ v)
+    {
+        r = clSetKernelArg(kernel, arg++, sizeof(cl_mem), &builder.vectors()[v]);
+    }
+    for (size_t s = 0; s < builder.scalars().size() && CL_SUCCESS == r; ++ s)
+    {
+        r = clSetKernelArg(kernel, arg++, sizeof(cl_float), &builder.scalars()[s]);
+    }
+    cl_ulong const count = out.count();
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, arg++, sizeof(cl_ulong), &count);
+
+    // Launches of at most maxLaunchSize work-items, as runtimeEnqueueSaxpy
+    // makes; the kernel's index includes the global offset.
+    for (size_t offset = 0; offset < out.count() && CL_SUCCESS == r;
+         offset += runtime_->maxLaunchSize)
+    {
+        size_t const remaining = out.count() - offset;
+        size_t const global = remaining < runtime_->maxLaunchSize
+                              ? remaining : runtime_->maxLaunchSize;
+        r = clEnqueueNDRangeKernel(runtime_->queue, kernel, 1, &offset, &global,
+                                   NULL, 0, NULL, NULL);
+    }
+    if (CL_SUCCESS != r)
+        printf("Running the kernel for %s failed with return code %d\n",
+               builder.expression().c_str(), r);
+    return r;
+}
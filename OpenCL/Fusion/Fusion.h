@@ -0,0 +1,274 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Runtime.h"
+
+// Elementwise expressions on device vectors, with each assignment run as
+// one generated kernel, on top of the Runtime library (see ../Runtime).
+//
+//     Fusion fusion(&runtime);
+//     Vector x(fusion, n, &r), y(fusion, n, &r), w(fusion, n, &r), z(fusion, n, &r);
+//     ...
+//     z = a*x + b*y*w - c;
+//
+// The operators don't compute anything: they build a tree of expression
+// templates, and the assignment walks it to write the OpenCL C text of
+// the expression and to gather its arguments.  Each distinct vector
+// becomes a buffer argument and each float a scalar argument, so the text
+// depends only on the shape of the expression, not on the values.  The
+// kernel for a shape is built with clCreateProgramWithSource and
+// clBuildProgram the first time it is assigned, and kept in a cache keyed
+// by that text; later assignments of the same shape only set the
+// arguments and enqueue.  The whole expression reads each vector once and
+// writes the result once, where a chain of separate saxpy-like kernels
+// would go through memory for every intermediate result.
+//
+// Kernels are enqueued on the runtime's in-order queue without waiting;
+// Vector::read waits for the result.  Like the Runtime, a Fusion and its
+// vectors are not thread-safe.
+
+class Fusion;
+
+// The text and arguments of a kernel, gathered from an expression.
+class KernelBuilder
+{
+public:
+    KernelBuilder() : count_(0), mismatch_(false) {}
+
+    // Append an operand, numbering each distinct buffer once.
+    void vector(cl_mem buffer, size_t count);
+    void scalar(float value);
+    void text(char const* text) { expression_ += text; }
+
+    // The expression, e.g. "((s0*v0[n])+v1[n])", which is also the key
+    // of the kernel in the cache.
+    std::string const& expression() const { return expression_; }
+    std::vector<cl_mem> const& vectors() const { return vectors_; }
+    std::vector<float> const& scalars() const { return scalars_; }
+    // The length of the vectors, and whether they all had it.
+    size_t count() const { return count_; }
+    bool mismatch() const { return mismatch_; }
+
+    // The whole kernel.
+    std::string source() const;
+
+private:
+    std::string expression_;
+    std::vector<cl_mem> vectors_;
+    std::vector<float> scalars_;
+    size_t count_;
+    bool mismatch_;
+};
+
+template <typename E>
+struct Expression
+{
+    E const& self() const { return static_cast<E const&>(*this); }
+};
+
+// A vector of floats in a device buffer from the runtime's pool.
+class Vector : public Expression<Vector>
+{
+public:
+    // Check *error before using the vector: on failure it has no buffer.
+    Vector(Fusion& fusion, size_t count, cl_int* error);
+    // Gives the buffer back to the pool.
+    ~Vector();
+
+    size_t count() const { return count_; }
+    cl_mem buffer() const { return buffer_; }
+
+    // Copy 'count' floats from host memory, without waiting.  'source'
+    // must stay valid until the queue reaches the copy.
+    cl_int write(float const* source);
+    // Copy 'count' floats into host memory, and wait for them.
+    cl_int read(float* destination);
+
+    // Evaluate an expression into this vector.  Errors are printed and
+    // kept in Fusion::status.
+    template <typename E>
+    Vector& operator=(Expression<E> const& expression);
+    Vector& operator=(Vector const& other);
+
+    void build(KernelBuilder& builder) const { builder.vector(buffer_, count_); }
+
+    Vector(Vector const&) = delete;
+
+private:
+    Fusion* fusion_;
+    cl_mem buffer_;
+    size_t count_;
+};
+
+class Scalar : public Expression<Scalar>
+{
+public:
+    explicit Scalar(float value) : value_(value) {}
+
+    void build(KernelBuilder& builder) const { builder.scalar(value_); }
+
+private:
+    float value_;
+};
+
+// Vectors are held by reference, and everything else, the temporaries
+// of the expression, by value.
+template <typename E>
+struct Operand
+{
+    typedef E type;
+};
+
+template <>
+struct Operand<Vector>
+{
+    typedef Vector const& type;
+};
+
+template <char Op, typename L, typename R>
+class Binary : public Expression<Binary<Op, L, R> >
+{
+public:
+    Binary(L const& left, R const& right) : left_(left), right_(right) {}
+
+    void build(KernelBuilder& builder) const
+    {
+        char const op[] = {' ', Op, ' ', 0};
+        builder.text("(");
+        left_.build(builder);
+        builder.text(op);
+        right_.build(builder);
+        builder.text(")");
+    }
+
+private:
+    typename Operand<L>::type left_;
+    typename Operand<R>::type right_;
+};
+
+template <typename E>
+class Negate : public Expression<Negate<E> >
+{
+public:
+    explicit Negate(E const& operand) : operand_(operand) {}
+
+    void build(KernelBuilder& builder) const
+    {
+        builder.text("(-");
+        operand_.build(builder);
+        builder.text(")");
+    }
+
+private:
+    typename Operand<E>::type operand_;
+};
+
+// TODO: Add the functions your formulas need, e.g. sqrt or fmax, the same
+// way as Negate.
+template <typename E>
+Negate<E> operator-(Expression<E> const& operand)
+{
+    return Negate<E>(operand.self());
+}
+
+// Each operator takes two expressions, or an expression and a float.
+#define FUSION_OPERATOR(op, symbol) \
+    template <typename L, typename R> \
+    Binary<symbol, L, R> operator op(Expression<L> const& left, \
+                                     Expression<R> const& right) \
+    { \
+        return Binary<symbol, L, R>(left.self(), right.self()); \
+    } \
+    template <typename L> \
+    Binary<symbol, L, Scalar> operator op(Expression<L> const& left, float right) \
+    { \
+        return Binary<symbol, L, Scalar>(left.self(), Scalar(right)); \
+    } \
+    template <typename R> \
+    Binary<symbol, Scalar, R> operator op(float left, Expression<R> const& right) \
+    { \
+        return Binary<symbol, Scalar, R>(Scalar(left), right.self()); \
+    }
+
+FUSION_OPERATOR(+, '+')
+FUSION_OPERATOR(-, '-')
+FUSION_OPERATOR(*, '*')
+FUSION_OPERATOR(/, '/')
+
+#undef FUSION_OPERATOR
+
+class Fusion
+{
+public:
+    // The runtime must outlive the Fusion and its vectors.
+    explicit Fusion(Runtime* runtime);
+    // Releases the cached kernels.
+    ~Fusion();
+
+    Runtime* runtime() const { return runtime_; }
+
+    // Enqueue the kernel for 'out = expression'.
+    template <typename E>
+    cl_int assign(Vector& out, Expression<E> const& expression)
+    {
+        KernelBuilder builder;
+        expression.self().build(builder);
+        return launch(out, builder);
+    }
+
+    // The kernel source that 'out = expression' runs.
+    template <typename E>
+    static std::string source(Expression<E> const& expression)
+    {
+        KernelBuilder builder;
+        expression.self().build(builder);
+        return builder.source();
+    }
+
+    // The first error of an assignment through Vector::operator=, or
+    // CL_SUCCESS.
+    cl_int status() const { return status_; }
+
+    // Statistics: assignments that found their kernel in the cache, and
+    // kernels built.
+    size_t hits() const { return hits_; }
+    size_t builds() const { return builds_; }
+
+    Fusion(Fusion const&) = delete;
+    Fusion& operator=(Fusion const&) = delete;
+
+private:
+    friend class Vector;
+
+    struct Entry
+    {
+        cl_program program;
+        cl_kernel kernel;
+    };
+
+    cl_int launch(Vector& out, KernelBuilder const& builder);
+    cl_kernel kernel(KernelBuilder const& builder, cl_int* error);
+    void record(cl_int r)
+    {
+        if (CL_SUCCESS == status_)
+            status_ = r;
+    }
+
+    Runtime* runtime_;
+    std::map<std::string, Entry> cache_;
+    cl_int status_;
+    size_t hits_;
+    size_t builds_;
+};
+
+template <typename E>
+Vector& Vector::operator=(Expression<E> const& expression)
+{
+    fusion_->record(fusion_->assign(*this, expression));
+    return *this;
+}
+
+#endif
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "Fusion.h"
+
+// This sample evaluates z = a*x + b*y*w - c on device vectors with
+// expression templates (see Fusion.h): once as a single statement, which
+// runs as one fused kernel, and once as a chain of single-operation
+// statements with temporaries, as a series of hand-written kernels would
+// compute it.  It prints the kernel generated for the expression, times
+// both ways, and then evaluates the expression with other values of a, b
+// and c, which reuse the cached kernel.
+
+static double now()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// The median time of 'repeats' evaluations, each waited for.
+static double median(Fusion& fusion, std::function<void()> const& evaluate,
+                     int repeats, cl_int* error)
+{
+    std::vector<double> times;
+    *error = CL_SUCCESS;
+    for (int t = 0; t < repeats && CL_SUCCESS == *error; ++ t)
+    {
+        double const start = now();
+        evaluate();
+        *error = fusion.status();
+        if (CL_SUCCESS == *error)
+            *error = clFinish(fusion.runtime()->queue);
+        times.push_back(now() - start);
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Check the results against the same operations on the host.  The values
+// are small integers and halves, and the kernel doesn't contract into
+// fma, so the results are exact.
+static bool check(float a, float b, float c, std::vector<float> const& x,
+                  std::vector<float> const& y, std::vector<float> const& w,
+                  std::vector<float> const& z)
+{
+    for (size_t i = 0; i < z.size(); ++ i)
+    {
+        float const ax = a*x[i];
+        float const byw = b*y[i]*w[i];
+        float const expected = ax + byw - c;
+        if (expected != z[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" %f*%f + %f*%f*%f - %f = %f != z[i] = %f\n",
+                   a, x[i], b, y[i], w[i], c, expected, z[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLFusion [elements [repeats]]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) 1 << 22;
+    int const repeats = argc > 2 ? atoi(argv[2]) : 20;
+    if (0 == dimension || repeats < 1)
+    {
+        printf("Usage: %s [elements [repeats]]\n", argv[0]);
+        return 1;
+    }
+
+    // The runtime's own program isn't used here.
+    RuntimeOptions options;
+    runtimeDefaultOptions(&options);
+    options.kernelPath = "../Runtime/kernel.cl";
+    Runtime runtime;
+    cl_int r = runtimeCreate(&runtime, &options);
+    if (CL_SUCCESS != r)
+        return r;
+
+    // The vectors go back to the runtime's pool before it is released.
+    {
+        Fusion fusion(&runtime);
+        // Each construction overwrites r, so check it every time.
+        Vector x(fusion, dimension, &r);
+        if (CL_SUCCESS != r)
+            return r;
+        Vector y(fusion, dimension, &r);
+        if (CL_SUCCESS != r)
+            return r;
+        Vector w(fusion, dimension, &r);
+        if (CL_SUCCESS != r)
+            return r;
+        Vector z(fusion, dimension, &r);
+        if (CL_SUCCESS != r)
+            return r;
+        Vector t(fusion, dimension, &r);
+        if (CL_SUCCESS != r)
+            return r;
+        Vector u(fusion, dimension, &r);
+        if (CL_SUCCESS != r)
+            return r;
+
+        // Set values to something easy to verify.
+        std::vector<float> hostX(dimension);
+        std::vector<float> hostY(dimension);
+        std::vector<float> hostW(dimension);
+        std::vector<float> hostZ(dimension);
+        for (size_t i = 0; i < dimension; ++ i)
+        {
+            hostX[i] = (float) (i % 1000);
+            hostY[i] = 100 - (float) (i % 1000);
+            hostW[i] = (float) (i % 7);
+        }
+        r = x.write(hostX.data());
+        if (CL_SUCCESS == r)
+            r = y.write(hostY.data());
+        if (CL_SUCCESS == r)
+            r = w.write(hostW.data());
+        if (CL_SUCCESS != r)
+        {
+            printf("Unable to write the vectors, return code %d\n", r);
+            return r;
+        }
+
+        float a = 2.0f;
+        float b = 0.5f;
+        float c = 3.0f;
+        printf("z = a*x + b*y*w - c runs:\n\n%s\n",
+               Fusion::source(a*x + b*y*w - c).c_str());
+
+        // The first evaluation builds the kernel.
+        double const start = now();
+        z = a*x + b*y*w - c;
+        r = fusion.status();
+        if (CL_SUCCESS == r)
+            r = clFinish(runtime.queue);
+        double const first = now() - start;
+        if (CL_SUCCESS != r)
+            return r;
+
+        std::function<void()> const fused = [&]()
+        {
+            z = a*x + b*y*w - c;
+        };
+        std::function<void()> const unfused = [&]()
+        {
+            t = a*x;
+            u = b*y;
+            u = u*w;
+            t = t + u;
+            z = t - c;
+        };
+        // Vectors read and written by each way.
+        struct Way
+        {
+            char const* name;
+            std::function<void()> const* evaluate;
+            int kernels;
+            int transfers;
+        };
+        Way const ways[] =
+        {
+            {"fused", &fused, 1, 4},
+            {"unfused", &unfused, 5, 12}
+        };
+        size_t const size = dimension * sizeof(cl_float);
+        printf("%zu elements; the first evaluation, with the build, took %.3f ms\n",
+               dimension, first * 1e3);
+        printf("%-8s %8s %10s %13s %10s\n", "way", "kernels", "median", "vectors moved",
+               "GB/s");
+        for (Way const& way : ways)
+        {
+            std::fill(hostZ.begin(), hostZ.end(), 0.0f);
+            r = z.write(hostZ.data());
+            double const time = CL_SUCCESS == r ? median(fusion, *way.evaluate, repeats, &r)
+                                                : 0.0;
+            if (CL_SUCCESS == r)
+                r = z.read(hostZ.data());
+            if (CL_SUCCESS != r)
+            {
+                printf("The %s evaluation failed with return code %d\n", way.name, r);
+                return r;
+            }
+            printf("%-8s %8d %7.3f ms %13d %10.2f\n", way.name, way.kernels, time * 1e3,
+                   way.transfers, way.transfers * size / time * 1e-9);
+            if (!check(a, b, c, hostX, hostY, hostW, hostZ))
+                return 100;
+        }
+
+        // Other values, same shape: no more builds.
+        size_t const builds = fusion.builds();
+        for (int k = 1; k <= 3 && CL_SUCCESS == r; ++ k)
+        {
+            a = (float) k;
+            b = 0.25f * k;
+            c = -0.5f * k;
+            z = a*x + b*y*w - c;
+            r = fusion.status();
+            if (CL_SUCCESS == r)
+                r = z.read(hostZ.data());
+            if (CL_SUCCESS == r && !check(a, b, c, hostX, hostY, hostW, hostZ))
+                return 100;
+        }
+        if (CL_SUCCESS != r)
+            return r;
+        printf("3 more evaluations with other values: %zu more builds\n",
+               fusion.builds() - builds);
+        printf("Cache: %zu hits, %zu builds\n", fusion.hits(), fusion.builds());
+        printf("Computation appears to have completed successfully.\n");
+    }
+
+    runtimeRelease(&runtime);
+
+    return 0;
+}
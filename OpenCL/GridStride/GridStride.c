@@ -0,0 +1,191 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "GridStride.h"
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int compareDoubles(void const* a, void const* b)
+{
+    double const x = *(double const*) a;
+    double const y = *(double const*) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+cl_int gridStrideCreate(GridStride* gridStride, Runtime* runtime)
+{
+    memset(gridStride, 0, sizeof(*gridStride));
+    gridStride->runtime = runtime;
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(runtime, "saxpy_strided", &r);
+    if (CL_SUCCESS == r)
+        runtimeKernel(runtime, "saxpy", &r);
+    if (CL_SUCCESS != r)
+        return r;
+
+    size_t workGroupSize = 0;
+    r = clGetKernelWorkGroupInfo(kernel, runtime->device, CL_KERNEL_WORK_GROUP_SIZE,
+                                 sizeof(workGroupSize), &workGroupSize, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clGetKernelWorkGroupInfo failed with return code %d\n", r);
+        return r;
+    }
+    // TODO: Try other work-group sizes for your device.
+    gridStride->localSize = workGroupSize < 256 ? workGroupSize : 256;
+
+    gridStride->computeUnits = 1;
+    clGetDeviceInfo(runtime->device, CL_DEVICE_MAX_COMPUTE_UNITS,
+                    sizeof(gridStride->computeUnits), &gridStride->computeUnits, NULL);
+    if (0 == gridStride->computeUnits)
+        gridStride->computeUnits = 1;
+    gridStride->groupsPerUnit = 8;
+    gridStride->groupCount = gridStride->groupsPerUnit * gridStride->computeUnits;
+    return CL_SUCCESS;
+}
+
+GridStrideKernel gridStrideChoose(GridStride const* gridStride, size_t count)
+{
+    if (0 == gridStride->sizeCount)
+        return GRIDSTRIDE_GRID;
+    int s = 0;
+    while (s + 1 < gridStride->sizeCount && gridStride->sizes[s + 1] <= count)
+        ++ s;
+    return gridStride->gridSeconds[s] <= gridStride->perElementSeconds[s]
+        ? GRIDSTRIDE_GRID : GRIDSTRIDE_PER_ELEMENT;
+}
+
+cl_int gridStrideEnqueueSaxpy(GridStride* gridStride, GridStrideKernel kernel,
+                              float a, cl_mem x, cl_mem y, cl_mem z, size_t count,
+                              cl_uint waitCount, cl_event const* waitList,
+                              cl_event* event)
+{
+    Runtime* runtime = gridStride->runtime;
+    if (0 == count)
+        return clEnqueueMarkerWithWaitList(runtime->queue, waitCount, waitList, event);
+    if (GRIDSTRIDE_AUTO == kernel)
+        kernel = gridStrideChoose(gridStride, count);
+
+    cl_int r = CL_SUCCESS;
+    cl_kernel k = runtimeKernel(runtime, GRIDSTRIDE_GRID == kernel
+                                         ? "saxpy_strided" : "saxpy", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    cl_ulong const elements = count;
+    r = clSetKernelArg(k, 0, sizeof(cl_mem), &x);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(k, 1, sizeof(cl_mem), &y);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(k, 2, sizeof(cl_mem), &z);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(k, 3, sizeof(cl_float), &a);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(k, 4, sizeof(cl_ulong), &elements);
+    if (CL_SUCCESS != r)
+        return r;
+    if (GRIDSTRIDE_PER_ELEMENT == kernel)
+        return clEnqueueNDRangeKernel(runtime->queue, k, 1, NULL, &count, NULL,
+                                      waitCount, waitList, event);
+
+    // No more work-groups than there are groups of elements, so a small
+    // problem doesn't launch idle work-items.
+    size_t const local = gridStride->localSize;
+    size_t groups = (count + local - 1) / local;
+    if (groups > gridStride->groupCount)
+        groups = gridStride->groupCount;
+    size_t const global = groups * local;
+    return clEnqueueNDRangeKernel(runtime->queue, k, 1, NULL, &global, &local,
+                                  waitCount, waitList, event);
+}
+
+// The median time of 'repeats' runs of a kernel, after one to warm up.
+static cl_int measureKernel(GridStride* gridStride, GridStrideKernel kernel,
+                            cl_mem x, cl_mem y, cl_mem z, size_t count,
+                            int repeats, double* times, double* median)
+{
+    cl_int r = CL_SUCCESS;
+    for (int t = -1; t < repeats && CL_SUCCESS == r; ++ t)
+    {
+        double const start = now();
+        r = gridStrideEnqueueSaxpy(gridStride, kernel, 2.0f, x, y, z, count,
+                                   0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clFinish(gridStride->runtime->queue);
+        if (t >= 0)
+            times[t] = now() - start;
+    }
+    if (CL_SUCCESS != r)
+    {
+        printf("Measuring %zu elements failed with return code %d\n", count, r);
+        return r;
+    }
+    qsort(times, repeats, sizeof(double), compareDoubles);
+    *median = times[repeats / 2];
+    return CL_SUCCESS;
+}
+
+cl_int gridStrideMeasure(GridStride* gridStride, cl_mem x, cl_mem y, cl_mem z,
+                         size_t maxCount, int repeats)
+{
+    if (0 == maxCount || repeats < 1)
+        return CL_INVALID_VALUE;
+    double* times = (double*) malloc(sizeof(double) * repeats);
+    if (NULL == times)
+        return CL_OUT_OF_HOST_MEMORY;
+
+    // Sizes from 4096 elements up, by factors of 4, and 'maxCount'.
+    gridStride->sizeCount = 0;
+    for (size_t count = 4096; count < maxCount
+                              && gridStride->sizeCount < GRIDSTRIDE_MAX_SIZES - 1;
+         count *= 4)
+    {
+        gridStride->sizes[gridStride->sizeCount++] = count;
+    }
+    gridStride->sizes[gridStride->sizeCount++] = maxCount;
+
+    // The number of work-groups per compute unit, at the largest size.
+    // TODO: Larger counts may help devices that hide memory latency with
+    // many work-groups in flight.
+    size_t const candidates[] = {1, 2, 4, 8, 16, 32};
+    size_t bestGroups = gridStride->groupsPerUnit;
+    double bestSeconds = 0;
+    cl_int r = CL_SUCCESS;
+    for (size_t c = 0; c < sizeof(candidates) / sizeof(candidates[0]) && CL_SUCCESS == r;
+         ++ c)
+    {
+        gridStride->groupsPerUnit = candidates[c];
+        gridStride->groupCount = candidates[c] * gridStride->computeUnits;
+        double seconds = 0;
+        r = measureKernel(gridStride, GRIDSTRIDE_GRID, x, y, z, maxCount, repeats,
+                          times, &seconds);
+        if (CL_SUCCESS == r && (0 == c || seconds < bestSeconds))
+        {
+            bestGroups = candidates[c];
+            bestSeconds = seconds;
+        }
+    }
+    gridStride->groupsPerUnit = bestGroups;
+    gridStride->groupCount = bestGroups * gridStride->computeUnits;
+
+    for (int s = 0; s < gridStride->sizeCount && CL_SUCCESS == r; ++ s)
+    {
+        r = measureKernel(gridStride, GRIDSTRIDE_PER_ELEMENT, x, y, z,
+                          gridStride->sizes[s], repeats, times,
+                          &gridStride->perElementSeconds[s]);
+        if (CL_SUCCESS == r)
+            r = measureKernel(gridStride, GRIDSTRIDE_GRID, x, y, z,
+                              gridStride->sizes[s], repeats, times,
+                              &gridStride->gridSeconds[s]);
+    }
+    if (CL_SUCCESS != r)
+        gridStride->sizeCount = 0;
+    free(times);
+    return r;
+}
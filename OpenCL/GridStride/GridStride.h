@@ -0,0 +1,71 @@
+#ifndef GRIDSTRIDE_H
+#define GRIDSTRIDE_H
+
+#include "Runtime.h"
+
+// A saxpy (z = a*x + y) that is launched either with one work-item per
+// element, or as a grid of a fixed number of work-groups, a few per
+// compute unit, that stride over the elements.  Uses a Runtime (see
+// ../Runtime) created with this directory's kernel.cl.
+//
+// Which is faster depends on the device and the size: a launch of
+// millions of work-groups costs little on a GPU, but on a CPU device
+// every work-group has a scheduling cost of its own.  gridStrideMeasure
+// times both kernels over a range of sizes, and picks the number of
+// work-groups per compute unit for the grid; gridStrideEnqueueSaxpy
+// then uses whichever kernel measured faster at the nearest size.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GRIDSTRIDE_MAX_SIZES 16
+
+typedef enum
+{
+    GRIDSTRIDE_AUTO,
+    GRIDSTRIDE_PER_ELEMENT,
+    GRIDSTRIDE_GRID
+} GridStrideKernel;
+
+typedef struct
+{
+    Runtime* runtime;
+    cl_uint computeUnits;
+    // The grid: groupCount work-groups of localSize work-items.
+    size_t localSize;
+    size_t groupsPerUnit;
+    size_t groupCount;
+    // The sizes measured, in increasing order, with the median time of
+    // each kernel at that size.
+    int sizeCount;
+    size_t sizes[GRIDSTRIDE_MAX_SIZES];
+    double perElementSeconds[GRIDSTRIDE_MAX_SIZES];
+    double gridSeconds[GRIDSTRIDE_MAX_SIZES];
+} GridStride;
+
+// Set up the grid with 8 work-groups per compute unit.  Until
+// gridStrideMeasure is called, GRIDSTRIDE_AUTO uses the grid.
+cl_int gridStrideCreate(GridStride* gridStride, Runtime* runtime);
+
+// Time both kernels on sizes from 4096 elements up to 'maxCount', on
+// buffers that hold at least that many, keeping the median of 'repeats'
+// runs.  The largest size also picks the work-groups per compute unit.
+cl_int gridStrideMeasure(GridStride* gridStride, cl_mem x, cl_mem y, cl_mem z,
+                         size_t maxCount, int repeats);
+
+// The kernel GRIDSTRIDE_AUTO uses for 'count' elements.
+GridStrideKernel gridStrideChoose(GridStride const* gridStride, size_t count);
+
+// Enqueue z = a*x + y over 'count' elements of device buffers with the
+// given kernel, without waiting for it.
+cl_int gridStrideEnqueueSaxpy(GridStride* gridStride, GridStrideKernel kernel,
+                              float a, cl_mem x, cl_mem y, cl_mem z, size_t count,
+                              cl_uint waitCount, cl_event const* waitList,
+                              cl_event* event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GridStride.h"
+
+// This sample runs a saxpy (z=a*x+y) with one work-item per element, and
+// with a grid of a few work-groups per compute unit that stride over the
+// elements (see GridStride.h).  It measures both over a range of sizes,
+// prints which is faster where, and then checks the results of both
+// kernels, and of the one chosen, at the full size and at a few sizes
+// that don't divide evenly.
+
+// Run z = a*x + y over 'count' elements with a kernel, and check the result.
+static cl_int check(GridStride* gridStride, GridStrideKernel kernel, float a,
+                    float const* x, float const* y, float* z,
+                    cl_mem devX, cl_mem devY, cl_mem devZ, size_t count)
+{
+    cl_command_queue queue = gridStride->runtime->queue;
+    size_t const size = count * sizeof(cl_float);
+    memset(z, 0, size);
+    cl_int r = clEnqueueWriteBuffer(queue, devZ, CL_FALSE, 0, size, z, 0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = gridStrideEnqueueSaxpy(gridStride, kernel, a, devX, devY, devZ, count,
+                                   0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clEnqueueReadBuffer(queue, devZ, CL_TRUE, 0, size, z, 0, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("Running %zu elements failed with return code %d\n", count, r);
+        return r;
+    }
+
+    // Check that results are correct.  Note that the code below
+    // depends on the computation being exact.
+    for (size_t i = 0; i < count; ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+        {
+            printf("Unexpected result at element %zu of %zu:\n", i, count);
+            printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                   x[i], a, y[i], z[i]);
+            return 100;
+        }
+    }
+    return CL_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLGridStride [elements [repeats]]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) 1 << 24;
+    int const repeats = argc > 2 ? atoi(argv[2]) : 10;
+    if (0 == dimension || repeats < 1)
+    {
+        printf("Usage: %s [elements [repeats]]\n", argv[0]);
+        return 1;
+    }
+
+    Runtime runtime;
+    cl_int r = runtimeCreate(&runtime, NULL);
+    if (CL_SUCCESS != r)
+        return r;
+    GridStride gridStride;
+    r = gridStrideCreate(&gridStride, &runtime);
+    if (CL_SUCCESS != r)
+        return r;
+
+    float const a = 2.0f;
+    size_t const size = dimension * sizeof(cl_float);
+    float* x = (float*) malloc(size);
+    float* y = (float*) malloc(size);
+    float* z = (float*) malloc(size);
+    if (NULL == x || NULL == y || NULL == z)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+    cl_mem devX = runtimeAcquireBuffer(&runtime, size, &r);
+    cl_mem devY = 0;
+    cl_mem devZ = 0;
+    if (CL_SUCCESS == r)
+        devY = runtimeAcquireBuffer(&runtime, size, &r);
+    if (CL_SUCCESS == r)
+        devZ = runtimeAcquireBuffer(&runtime, size, &r);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime.queue, devX, CL_TRUE, 0, size, x, 0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime.queue, devY, CL_TRUE, 0, size, y, 0, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("Unable to set up device buffers, return code %d\n", r);
+        return r;
+    }
+
+    r = gridStrideMeasure(&gridStride, devX, devY, devZ, dimension, repeats);
+    if (CL_SUCCESS != r)
+        return r;
+    printf("%u compute units; grid of %zu work-groups (%zu per unit) of %zu\n",
+           gridStride.computeUnits, gridStride.groupCount, gridStride.groupsPerUnit,
+           gridStride.localSize);
+    printf("%12s %14s %14s  %s\n", "elements", "per element", "grid", "chosen");
+    for (int s = 0; s < gridStride.sizeCount; ++ s)
+    {
+        printf("%12zu %11.3f ms %11.3f ms  %s\n", gridStride.sizes[s],
+               gridStride.perElementSeconds[s] * 1e3, gridStride.gridSeconds[s] * 1e3,
+               GRIDSTRIDE_GRID == gridStrideChoose(&gridStride, gridStride.sizes[s])
+               ? "grid" : "per element");
+    }
+
+    // Sizes that leave partial work-groups and partial passes of the grid.
+    size_t const counts[] = {dimension, dimension - dimension / 3, 1000, 1};
+    GridStrideKernel const kernels[] =
+    {
+        GRIDSTRIDE_PER_ELEMENT, GRIDSTRIDE_GRID, GRIDSTRIDE_AUTO
+    };
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]) && CL_SUCCESS == r; ++ c)
+    {
+        for (size_t k = 0; k < 3 && CL_SUCCESS == r; ++ k)
+        {
+            if (counts[c] <= dimension)
+                r = check(&gridStride, kernels[k], a, x, y, z, devX, devY, devZ,
+                          counts[c]);
+        }
+    }
+    if (CL_SUCCESS != r)
+        return r;
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(x);
+    free(y);
+    free(z);
+
+    // Give the buffers back and release everything.
+    runtimeReleaseBuffer(&runtime, devX);
+    runtimeReleaseBuffer(&runtime, devY);
+    runtimeReleaseBuffer(&runtime, devZ);
+    runtimeRelease(&runtime);
+
+    return 0;
+}
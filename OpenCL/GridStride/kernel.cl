@@ -0,0 +1,31 @@
+// Two kernels that compute z = a*x + y over 'count' elements.
+//
+// saxpy uses one work-item per element, so it is launched with at least
+// 'count' work-items.  saxpy_strided is launched with a fixed number of
+// work-groups, whatever 'count' is, and each work-item loops over the
+// elements a whole grid apart.  The index is a ulong in both, so neither
+// overflows on devices where size_t is 32 bits.
+
+__kernel void saxpy(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong count)
+{
+    // Get element index n.
+    ulong n = get_global_id(0);
+
+    if (n < count)
+    {
+        z[n] = a*x[n] + y[n];
+    }
+}
+
+__kernel void saxpy_strided(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong count)
+{
+    // Neighbouring work-items handle neighbouring elements on every pass,
+    // so accesses stay coalesced on GPUs.
+    ulong const stride = get_global_size(0);
+    for (ulong n = get_global_id(0); n < count; n += stride)
+    {
+        z[n] = a*x[n] + y[n];
+    }
+}
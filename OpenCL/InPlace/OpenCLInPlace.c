@@ -0,0 +1,397 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <CL/opencl.h>
+
+// This sample runs the Minimal sample's saxpy in three ways, and reports
+// how much host and device memory each needs at its peak:
+//
+//   separate  z = a*x + y, as the Minimal sample does: three device
+//             buffers and three host arrays, six vectors in all.
+//   inplace   y = a*x + y: the result overwrites y, so there is neither a
+//             device buffer nor a host array for z, four vectors in all.
+//   stream    z = a*x + y with streaming (non-temporal) stores into a
+//             buffer the host never accesses, for results that only later
+//             kernels consume.  z is checked on the device, so there is no
+//             host array for it, five vectors in all.
+//
+// All three give the buffers host access flags (CL_MEM_HOST_NO_ACCESS
+// and CL_MEM_HOST_READ_ONLY), which tell the driver the host never maps
+// or writes them after creation, so it may place them in memory the host
+// can't reach.  The host x array is freed as soon as it is on the device.
+// When memory, not compute, limits the batch size, dropping a vector lets
+// a batch grow by half.
+
+enum { SEPARATE, IN_PLACE, STREAM, MODES };
+static char const* const modeNames[MODES] = {"separate", "inplace", "stream"};
+static char const* const kernelNames[MODES] = {"saxpy", "saxpy_inplace", "saxpy_stream"};
+
+// The memory a mode allocated, now and at its peak.
+typedef struct
+{
+    size_t host;
+    size_t hostPeak;
+    size_t device;
+    size_t devicePeak;
+} Footprint;
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Read a whole file into a null-terminated string, or return NULL.
+static char* readFile(char const* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (NULL == file)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* contents = size >= 0 ? (char*) malloc(size + 1) : NULL;
+    if (NULL != contents && size != (long) fread(contents, 1, size, file))
+    {
+        free(contents);
+        contents = NULL;
+    }
+    fclose(file);
+    if (NULL != contents)
+        contents[size] = 0;
+    return contents;
+}
+
+static float* hostAlloc(Footprint* footprint, size_t size)
+{
+    float* p = (float*) malloc(size);
+    if (NULL != p)
+    {
+        footprint->host += size;
+        if (footprint->hostPeak < footprint->host)
+            footprint->hostPeak = footprint->host;
+    }
+    return p;
+}
+
+static void hostFree(Footprint* footprint, float* p, size_t size)
+{
+    if (NULL != p)
+    {
+        free(p);
+        footprint->host -= size;
+    }
+}
+
+// This counts what was asked for; a driver may allocate more, or later.
+static cl_mem deviceAlloc(Footprint* footprint, cl_context context, cl_mem_flags flags,
+                          size_t size, void* host, cl_int* error)
+{
+    cl_mem buffer = clCreateBuffer(context, flags, size, host, error);
+    if (CL_SUCCESS == *error)
+    {
+        footprint->device += size;
+        if (footprint->devicePeak < footprint->device)
+            footprint->devicePeak = footprint->device;
+    }
+    return buffer;
+}
+
+static void deviceFree(Footprint* footprint, cl_mem buffer)
+{
+    if (buffer)
+    {
+        size_t size = 0;
+        clGetMemObjectInfo(buffer, CL_MEM_SIZE, sizeof(size), &size, NULL);
+        clReleaseMemObject(buffer);
+        footprint->device -= size;
+    }
+}
+
+// Run one mode from filling the host arrays to checking the results.
+static cl_int run(int mode, cl_context context, cl_command_queue queue,
+                  cl_program program, float a, size_t dimension,
+                  Footprint* footprint, double* time)
+{
+    memset(footprint, 0, sizeof(*footprint));
+    size_t const size = dimension * sizeof(cl_float);
+    float* x = hostAlloc(footprint, size);
+    float* y = hostAlloc(footprint, size);
+    float* z = SEPARATE == mode ? hostAlloc(footprint, size) : NULL;
+    if (NULL == x || NULL == y || (SEPARATE == mode && NULL == z))
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        hostFree(footprint, x, size);
+        hostFree(footprint, y, size);
+        hostFree(footprint, z, size);
+        return CL_OUT_OF_HOST_MEMORY;
+    }
+
+    // Set values to something easy to verify.
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+
+    double const start = now();
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = clCreateKernel(program, kernelNames[mode], &r);
+    cl_kernel check = 0;
+    if (CL_SUCCESS == r && STREAM == mode)
+        check = clCreateKernel(program, "check_saxpy", &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateKernel failed with return code %d\n", r);
+        if (kernel)
+            clReleaseKernel(kernel);
+        hostFree(footprint, x, size);
+        hostFree(footprint, y, size);
+        hostFree(footprint, z, size);
+        return r;
+    }
+
+    // x and the separate y are filled on creation and only ever read by
+    // the kernels.  The host reads the result back, from z, or from y in
+    // place; a streamed z stays on the device, and only the count of
+    // wrong elements comes back.
+    // TODO: Buffers that you refill with clEnqueueWriteBuffer instead
+    // should be CL_MEM_HOST_WRITE_ONLY.
+    cl_mem devXmem = deviceAlloc(footprint, context,
+                                 CL_MEM_READ_ONLY | CL_MEM_HOST_NO_ACCESS
+                                 | CL_MEM_COPY_HOST_PTR, size, x, &r);
+    cl_mem devYmem = 0;
+    cl_mem devZmem = 0;
+    cl_mem devMismatches = 0;
+    if (CL_SUCCESS == r && IN_PLACE != mode)
+        devYmem = deviceAlloc(footprint, context,
+                              CL_MEM_READ_ONLY | CL_MEM_HOST_NO_ACCESS
+                              | CL_MEM_COPY_HOST_PTR, size, y, &r);
+    else if (CL_SUCCESS == r)
+        devYmem = deviceAlloc(footprint, context,
+                              CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY
+                              | CL_MEM_COPY_HOST_PTR, size, y, &r);
+    if (CL_SUCCESS == r && SEPARATE == mode)
+        devZmem = deviceAlloc(footprint, context,
+                              CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, size,
+                              NULL, &r);
+    else if (CL_SUCCESS == r && STREAM == mode)
+        devZmem = deviceAlloc(footprint, context,
+                              CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS, size,
+                              NULL, &r);
+    cl_uint mismatches = 0;
+    if (CL_SUCCESS == r && STREAM == mode)
+        devMismatches = deviceAlloc(footprint, context,
+                                    CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY
+                                    | CL_MEM_COPY_HOST_PTR, sizeof(mismatches),
+                                    &mismatches, &r);
+    if (CL_SUCCESS != r)
+        printf("clCreateBuffer failed with return code %d\n", r);
+
+    // The device has its own copy of x now.
+    hostFree(footprint, x, size);
+    x = NULL;
+
+    cl_ulong const count = dimension;
+    cl_uint arg = 0;
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, arg++, sizeof(cl_mem), &devXmem);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, arg++, sizeof(cl_mem), &devYmem);
+    if (CL_SUCCESS == r && IN_PLACE != mode)
+        r = clSetKernelArg(kernel, arg++, sizeof(cl_mem), &devZmem);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, arg++, sizeof(cl_float), &a);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, arg++, sizeof(cl_ulong), &count);
+    if (CL_SUCCESS == r)
+        r = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &dimension, NULL,
+                                   0, NULL, NULL);
+    float* result = SEPARATE == mode ? z : y;
+    if (CL_SUCCESS == r && STREAM != mode)
+        r = clEnqueueReadBuffer(queue, SEPARATE == mode ? devZmem : devYmem, CL_TRUE,
+                                0, size, result, 0, NULL, NULL);
+
+    // The streamed z is consumed on the device, here by counting the
+    // elements that differ from a*x + y.
+    if (CL_SUCCESS == r && STREAM == mode)
+    {
+        r = clSetKernelArg(check, 0, sizeof(cl_mem), &devXmem);
+        if (CL_SUCCESS == r)
+            r = clSetKernelArg(check, 1, sizeof(cl_mem), &devYmem);
+        if (CL_SUCCESS == r)
+            r = clSetKernelArg(check, 2, sizeof(cl_mem), &devZmem);
+        if (CL_SUCCESS == r)
+            r = clSetKernelArg(check, 3, sizeof(cl_float), &a);
+        if (CL_SUCCESS == r)
+            r = clSetKernelArg(check, 4, sizeof(cl_ulong), &count);
+        if (CL_SUCCESS == r)
+            r = clSetKernelArg(check, 5, sizeof(cl_mem), &devMismatches);
+        if (CL_SUCCESS == r)
+            r = clEnqueueNDRangeKernel(queue, check, 1, NULL, &dimension, NULL,
+                                       0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clEnqueueReadBuffer(queue, devMismatches, CL_TRUE, 0,
+                                    sizeof(mismatches), &mismatches, 0, NULL, NULL);
+    }
+    *time = now() - start;
+    if (CL_SUCCESS != r)
+        printf("Running %s failed with return code %d\n", modeNames[mode], r);
+    if (CL_SUCCESS == r && 0 != mismatches)
+    {
+        printf("%u elements of the streamed z differ from x*a + y\n", mismatches);
+        r = 100;
+    }
+
+    // Check that results are correct.  x was freed and y may have been
+    // overwritten, so the inputs are computed again.  Note that the code
+    // below depends on the computation being exact.
+    for (size_t i = 0; i < dimension && CL_SUCCESS == r && STREAM != mode; ++ i)
+    {
+        float const xi = (float) i;
+        float const yi = 100 - (float) i;
+        if (xi*a + yi != result[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" x[i]*a + y[i] = %f * %f + %f != %f\n", xi, a, yi, result[i]);
+            r = 100;
+        }
+    }
+
+    deviceFree(footprint, devXmem);
+    deviceFree(footprint, devYmem);
+    deviceFree(footprint, devZmem);
+    deviceFree(footprint, devMismatches);
+    if (check)
+        clReleaseKernel(check);
+    clReleaseKernel(kernel);
+    hostFree(footprint, y, size);
+    hostFree(footprint, z, size);
+    return r;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLInPlace [separate|inplace|stream|all [elements]]
+    int first = 0;
+    int last = MODES - 1;
+    if (argc > 1 && 0 != strcmp(argv[1], "all"))
+    {
+        for (first = 0; first < MODES && 0 != strcmp(argv[1], modeNames[first]); ++ first)
+        {
+        }
+        last = first;
+    }
+    size_t const dimension = argc > 2 ? (size_t) strtoull(argv[2], NULL, 10)
+                                      : (size_t) 1 << 24;
+    if (first >= MODES || 0 == dimension)
+    {
+        printf("Usage: %s [separate|inplace|stream|all [elements]]\n", argv[0]);
+        return 1;
+    }
+
+    // TODO: Choose the platform and device that suit your needs.
+    cl_platform_id platform = 0;
+    cl_int r = clGetPlatformIDs(1, &platform, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+    cl_device_id device = 0;
+    r = clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 1, &device, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+    cl_context context = clCreateContext(0, 1, &device, NULL, NULL, &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return code %d\n", r);
+        return r;
+    }
+    cl_command_queue queue = clCreateCommandQueue(context, device, 0, &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateCommandQueue failed with return code %d\n", r);
+        return r;
+    }
+
+    char* source = readFile("kernel.cl");
+    if (NULL == source)
+    {
+        printf("Unable to read kernel source file kernel.cl\n");
+        return 1;
+    }
+    char const* sourceLines[1] = {source};
+    cl_program program = clCreateProgramWithSource(context, 1, sourceLines, NULL, &r);
+    free(source);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateProgramWithSource failed with return code %d\n", r);
+        return r;
+    }
+    r = clBuildProgram(program, 1, &device, NULL, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clBuildProgram failed with return value %d; error log:\n", r);
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG,
+                                            sizeof(buildLog), buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            printf("%s\n", buildLog);
+        }
+        return r;
+    }
+
+    // The largest problem each mode fits in, going by the device's limits.
+    cl_ulong maxAlloc = 0;
+    cl_ulong globalMem = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(maxAlloc),
+                    &maxAlloc, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMem),
+                    &globalMem, NULL);
+
+    float const a = 2.0f;
+    double const megabyte = 1024.0 * 1024.0;
+    printf("%zu elements, %.1f MB per vector\n", dimension,
+           dimension * sizeof(cl_float) / megabyte);
+    printf("%-9s %10s %12s %12s %14s\n", "mode", "time", "host peak", "device peak",
+           "max elements");
+    for (int mode = first; mode <= last; ++ mode)
+    {
+        Footprint footprint;
+        double time = 0;
+        r = run(mode, context, queue, program, a, dimension, &footprint, &time);
+        if (CL_SUCCESS != r)
+            return r;
+        cl_ulong const buffers = IN_PLACE == mode ? 2 : 3;
+        cl_ulong largest = maxAlloc;
+        if (0 != globalMem && largest > globalMem / buffers)
+            largest = globalMem / buffers;
+        printf("%-9s %7.2f ms %9.1f MB %9.1f MB %14llu\n", modeNames[mode], time * 1e3,
+               footprint.hostPeak / megabyte, footprint.devicePeak / megabyte,
+               (unsigned long long) (largest / sizeof(cl_float)));
+    }
+
+    // What the process as a whole used, drivers included.  Run one mode
+    // per process to see it for that mode alone.
+    struct rusage usage;
+    if (0 == getrusage(RUSAGE_SELF, &usage))
+        printf("Peak resident set of the process: %.1f MB\n", usage.ru_maxrss / 1024.0);
+    printf("Computation appears to have completed successfully.\n");
+
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+// These kernels compute a*x + y over 'count' elements, either into a
+// separate vector z, or back into y, which saves the memory of z.
+
+// A store that bypasses the caches where the compiler offers one (clang
+// based compilers do), and a plain store elsewhere.
+#ifdef __has_builtin
+#if __has_builtin(__builtin_nontemporal_store)
+#define STREAM_STORE(value, p) __builtin_nontemporal_store(value, p)
+#endif
+#endif
+#ifndef STREAM_STORE
+#define STREAM_STORE(value, p) (*(p) = (value))
+#endif
+
+__kernel void saxpy(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong count)
+{
+    // Get element index n.
+    size_t n = get_global_id(0);
+
+    if (n < count)
+    {
+        z[n] = a*x[n] + y[n];
+    }
+}
+
+__kernel void saxpy_inplace(__global float const* x, __global float* y,
+    float a, ulong count)
+{
+    // Get element index n.
+    size_t n = get_global_id(0);
+
+    if (n < count)
+    {
+        y[n] = a*x[n] + y[n];
+    }
+}
+
+// As saxpy, but z is only consumed by later kernels, so it isn't worth
+// keeping in cache.
+__kernel void saxpy_stream(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong count)
+{
+    // Get element index n.
+    size_t n = get_global_id(0);
+
+    if (n < count)
+    {
+        STREAM_STORE(a*x[n] + y[n], &z[n]);
+    }
+}
+
+// Count the elements of z that differ from a*x + y, on the device, so
+// that z never has to be read back.
+__kernel void check_saxpy(__global float const* x, __global float const* y,
+    __global float const* z, float a, ulong count, __global uint* mismatches)
+{
+    // Get element index n.
+    size_t n = get_global_id(0);
+
+    if (n < count && a*x[n] + y[n] != z[n])
+    {
+        atomic_inc(mismatches);
+    }
+}
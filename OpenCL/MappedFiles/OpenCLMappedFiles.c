@@ -0,0 +1,480 @@
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <CL/opencl.h>
+
+// This sample runs a saxpy (z=a*x+y) from files to a file: x and y are
+// read from binary files of floats, and z is written to one.
+//
+// The files are memory-mapped, and the chunks of x and y are copied to
+// the device straight from the mapping, and the chunks of z straight
+// into the mapped output file, so there is no intermediate malloc'ed
+// copy of the data.  The mappings get sequential-access hints, chunks
+// start on page boundaries, and the pages of input chunks that are done
+// are dropped, so that a file larger than memory can be streamed.
+//
+// For comparison, the same pipeline can run from arrays filled with
+// fread, with z written out with fwrite.
+//
+// This sample uses POSIX mmap and so only builds on Linux and other
+// POSIX systems.
+
+#define BUFFER_SETS 2
+
+// Device buffers for one chunk, and the chunk they last held.
+typedef struct
+{
+    cl_mem devXmem;
+    cl_mem devYmem;
+    cl_mem devZmem;
+    cl_event done;
+    size_t start;
+    size_t count;
+} ChunkBuffers;
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Called once a chunk's result is on the host: if the data is mapped,
+// drop the input pages (they can be read again from the file) and start
+// writing the output pages back.
+static void chunkDone(ChunkBuffers const* set, float const* x, float const* y,
+                      float* z, int mapped)
+{
+    if (!mapped || 0 == set->count)
+        return;
+    size_t const offset = set->start * sizeof(float);
+    size_t const size = set->count * sizeof(float);
+    madvise((char*) x + offset, size, MADV_DONTNEED);
+    madvise((char*) y + offset, size, MADV_DONTNEED);
+    msync((char*) z + offset, size, MS_ASYNC);
+}
+
+// Stream z = a*x + y through the device in chunks of 'chunkElements',
+// alternating between the buffer sets so that one chunk can be enqueued
+// while the previous one runs.
+static cl_int runChunks(cl_command_queue queue, cl_kernel kernel,
+                        ChunkBuffers* sets, float a, float const* x,
+                        float const* y, float* z, size_t count,
+                        size_t chunkElements, int mapped)
+{
+    cl_int r = CL_SUCCESS;
+    int s = 0;
+    for (size_t start = 0; start < count && CL_SUCCESS == r; start += chunkElements)
+    {
+        ChunkBuffers* set = &sets[s];
+        s = (s + 1) % BUFFER_SETS;
+
+        // Wait until the set's previous chunk has been read back.
+        if (set->done)
+        {
+            r = clWaitForEvents(1, &set->done);
+            clReleaseEvent(set->done);
+            set->done = 0;
+            chunkDone(set, x, y, z, mapped);
+            if (CL_SUCCESS != r)
+                break;
+        }
+
+        size_t const n = count - start < chunkElements ? count - start : chunkElements;
+        size_t const size = n * sizeof(float);
+        cl_ulong const elements = n;
+        set->start = start;
+        set->count = n;
+        r = clEnqueueWriteBuffer(queue, set->devXmem, CL_FALSE, 0, size, x + start,
+                                 0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clEnqueueWriteBuffer(queue, set->devYmem, CL_FALSE, 0, size, y + start,
+                                     0, NULL, NULL);
+        clSetKernelArg(kernel, 0, sizeof(cl_mem), &set->devXmem);
+        clSetKernelArg(kernel, 1, sizeof(cl_mem), &set->devYmem);
+        clSetKernelArg(kernel, 2, sizeof(cl_mem), &set->devZmem);
+        clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+        clSetKernelArg(kernel, 4, sizeof(cl_ulong), &elements);
+        if (CL_SUCCESS == r)
+            r = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &n, NULL, 0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clEnqueueReadBuffer(queue, set->devZmem, CL_FALSE, 0, size, z + start,
+                                    0, NULL, &set->done);
+        clFlush(queue);
+    }
+
+    // Wait for the last chunks.
+    for (int b = 0; b < BUFFER_SETS; ++ b)
+    {
+        if (sets[b].done)
+        {
+            cl_int const rwait = clWaitForEvents(1, &sets[b].done);
+            if (CL_SUCCESS == r)
+                r = rwait;
+            clReleaseEvent(sets[b].done);
+            sets[b].done = 0;
+            chunkDone(&sets[b], x, y, z, mapped);
+        }
+    }
+    if (CL_SUCCESS != r)
+        printf("Streaming the chunks failed with return code %d\n", r);
+    return r;
+}
+
+// Write the Minimal sample's inputs, x[i] = i and y[i] = 100 - i, to
+// two files.
+static int generate(char const* xPath, char const* yPath, size_t count)
+{
+    FILE* xFile = fopen(xPath, "wb");
+    FILE* yFile = fopen(yPath, "wb");
+    size_t const block = 1 << 16;
+    float* xBlock = (float*) malloc(block * sizeof(float));
+    float* yBlock = (float*) malloc(block * sizeof(float));
+    int ok = NULL != xFile && NULL != yFile && NULL != xBlock && NULL != yBlock;
+    for (size_t start = 0; start < count && ok; start += block)
+    {
+        size_t const n = count - start < block ? count - start : block;
+        for (size_t i = 0; i < n; ++ i)
+        {
+            xBlock[i] = (float) (start + i);
+            yBlock[i] = 100 - (float) (start + i);
+        }
+        ok = n == fwrite(xBlock, sizeof(float), n, xFile)
+          && n == fwrite(yBlock, sizeof(float), n, yFile);
+    }
+    if (NULL != xFile && 0 != fclose(xFile))
+        ok = 0;
+    if (NULL != yFile && 0 != fclose(yFile))
+        ok = 0;
+    free(xBlock);
+    free(yBlock);
+    if (!ok)
+        printf("Unable to write %s and %s\n", xPath, yPath);
+    return ok;
+}
+
+// Map a whole file for reading, or return NULL.
+static void* mapInput(char const* path, size_t* size)
+{
+    int const fd = open(path, O_RDONLY);
+    struct stat status;
+    if (fd < 0 || 0 != fstat(fd, &status) || 0 == status.st_size)
+    {
+        printf("Unable to open %s, or it is empty\n", path);
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    *size = (size_t) status.st_size;
+    void* data = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+    if (MAP_FAILED == data)
+    {
+        printf("Unable to map %s\n", path);
+        return NULL;
+    }
+    madvise(data, *size, MADV_SEQUENTIAL);
+    return data;
+}
+
+// Create (or truncate) a file of 'size' bytes and map it for writing.
+static void* mapOutput(char const* path, size_t size)
+{
+    int const fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || 0 != ftruncate(fd, (off_t) size))
+    {
+        printf("Unable to create %s\n", path);
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == data)
+    {
+        printf("Unable to map %s\n", path);
+        return NULL;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    return data;
+}
+
+// Read a whole file into a malloc'ed array with fread.
+static void* readInput(char const* path, size_t size)
+{
+    FILE* file = fopen(path, "rb");
+    void* data = malloc(size);
+    if (NULL == file || NULL == data || size != fread(data, 1, size, file))
+    {
+        printf("Unable to read %s\n", path);
+        free(data);
+        data = NULL;
+    }
+    if (NULL != file)
+        fclose(file);
+    return data;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLMappedFiles [x-file y-file z-file [chunk-MB [mmap|fread]]]
+    // OpenCLMappedFiles generate elements x-file y-file
+    if (argc > 1 && 0 == strcmp(argv[1], "generate"))
+    {
+        if (argc != 5)
+        {
+            printf("Usage: %s generate elements x-file y-file\n", argv[0]);
+            return 1;
+        }
+        return generate(argv[3], argv[4], (size_t) strtoull(argv[2], NULL, 10)) ? 0 : 1;
+    }
+    char const* xPath = argc > 3 ? argv[1] : "x.bin";
+    char const* yPath = argc > 3 ? argv[2] : "y.bin";
+    char const* zPath = argc > 3 ? argv[3] : "z.bin";
+    size_t const chunkMB = argc > 4 ? (size_t) strtoull(argv[4], NULL, 10) : 16;
+    int const mapped = argc > 5 ? 0 != strcmp(argv[5], "fread") : 1;
+
+    // With no arguments, make some input first.
+    if (argc <= 3 && !generate(xPath, yPath, (size_t) 1 << 26))
+        return 1;
+
+    // Chunks are a whole number of pages, so that every chunk starts on a
+    // page boundary of the mappings.
+    size_t const pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    size_t chunkBytes = chunkMB << 20;
+    chunkBytes = chunkBytes < pageSize ? pageSize : chunkBytes / pageSize * pageSize;
+    size_t const chunkElements = chunkBytes / sizeof(float);
+
+    // Get the list of platforms.
+    int const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint numPlatforms = 0;
+    cl_int r = clGetPlatformIDs(maxPlatformCount, &platforms[0], &numPlatforms);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: You may want to look at the list of platforms that are
+    // returned, and choose the most appropriate one for your needs.
+    int const platformToUse = 0;
+
+    // Get the devices available for the chosen platform.
+    cl_uint deviceCount = 0;
+    size_t const maxDeviceCount = 8;
+    cl_device_id devices[maxDeviceCount];
+    r = clGetDeviceIDs(platforms[platformToUse], CL_DEVICE_TYPE_ALL,
+                       maxDeviceCount, &devices[0], &deviceCount);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: If you have multiple devices, you may specify which one
+    // you'd like to use by changing this variable.
+    int const deviceToUse = 0;
+    cl_device_id device = devices[deviceToUse];
+
+    cl_context context = clCreateContext(0, 1, &device, NULL, NULL, &r);
+    if (0 == context || CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return value %p and code %d\n",
+               context, r);
+        return r;
+    }
+
+    cl_command_queue commandQueue = clCreateCommandQueue(context, device, 0, &r);
+    if (0 == commandQueue || CL_SUCCESS != r)
+    {
+        printf("clCreateCommandQueue failed with return value %p and code %d\n",
+               commandQueue, r);
+        return r;
+    }
+
+    // Read the kernel source and build it.
+    FILE* kernelFile = fopen("kernel.cl", "rb");
+    if (NULL == kernelFile)
+    {
+        printf("Unable to open kernel source file\n");
+        return 1;
+    }
+    fseek(kernelFile, 0, SEEK_END);
+    long kernelSize = ftell(kernelFile);
+    fseek(kernelFile, 0, SEEK_SET);
+    char* kernelSource = (char*) malloc(kernelSize+1);
+    if (kernelSize != (long) fread(kernelSource, 1, kernelSize, kernelFile))
+    {
+        printf("Unable to read kernel source\n");
+        return 4;
+    }
+    fclose(kernelFile);
+    kernelSource[kernelSize] = 0;
+
+    const char* sourceLines[1] = {kernelSource};
+    cl_program program = clCreateProgramWithSource(context, 1,
+                         &sourceLines[0], NULL, &r);
+    free(kernelSource);
+    kernelSource = NULL;
+    if (0 == program || CL_SUCCESS != r)
+    {
+        printf("clCreateProgramWithSource failed with return value %p and code %d\n",
+               program, r);
+        return r;
+    }
+
+    r = clBuildProgram(program, 0, 0, 0, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("clBuildProgram failed with return value %d; error log:\n", r);
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG,
+                                            sizeof(buildLog), buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            printf("%s\n", buildLog);
+        }
+        return r;
+    }
+
+    cl_kernel kernel = clCreateKernel(program, "saxpy", &r);
+    if (0 == kernel || CL_SUCCESS != r)
+    {
+        printf("clCreateKernel failed with return value %p and code %d\n",
+               kernel, r);
+        return r;
+    }
+
+    ChunkBuffers sets[BUFFER_SETS];
+    memset(sets, 0, sizeof(sets));
+    for (int b = 0; b < BUFFER_SETS && CL_SUCCESS == r; ++ b)
+    {
+        sets[b].devXmem = clCreateBuffer(context, CL_MEM_READ_ONLY, chunkBytes, NULL, &r);
+        if (CL_SUCCESS == r)
+            sets[b].devYmem = clCreateBuffer(context, CL_MEM_READ_ONLY, chunkBytes, NULL, &r);
+        if (CL_SUCCESS == r)
+            sets[b].devZmem = clCreateBuffer(context, CL_MEM_WRITE_ONLY, chunkBytes, NULL, &r);
+    }
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    // Everything from opening the input files to the output file being
+    // complete is timed.
+    float const a = 2.0f;
+    double const start = now();
+    size_t size = 0;
+    size_t ySize = 0;
+    float* x = NULL;
+    float* y = NULL;
+    float* z = NULL;
+    if (mapped)
+    {
+        x = (float*) mapInput(xPath, &size);
+        y = (float*) mapInput(yPath, &ySize);
+    }
+    else
+    {
+        struct stat xStatus;
+        struct stat yStatus;
+        if (0 == stat(xPath, &xStatus) && 0 == stat(yPath, &yStatus))
+        {
+            size = (size_t) xStatus.st_size;
+            ySize = (size_t) yStatus.st_size;
+            x = (float*) readInput(xPath, size);
+            y = (float*) readInput(yPath, ySize);
+        }
+    }
+    if (NULL == x || NULL == y)
+        return 1;
+    if (size != ySize || 0 != size % sizeof(float))
+    {
+        printf("%s and %s must have the same size, a multiple of %zu bytes\n",
+               xPath, yPath, sizeof(float));
+        return 1;
+    }
+    size_t const dimension = size / sizeof(float);
+    z = mapped ? (float*) mapOutput(zPath, size) : (float*) malloc(size);
+    if (NULL == z)
+        return 1;
+
+    r = runChunks(commandQueue, kernel, sets, a, x, y, z, dimension,
+                  chunkElements, mapped);
+    if (CL_SUCCESS != r)
+        return r;
+    double const computed = now() - start;
+
+    // Make sure z is in the file: msync for the mapping, fwrite and
+    // fflush otherwise.
+    if (mapped)
+    {
+        msync(z, size, MS_SYNC);
+    }
+    else
+    {
+        FILE* zFile = fopen(zPath, "wb");
+        if (NULL == zFile || size != fwrite(z, 1, size, zFile) || 0 != fclose(zFile))
+        {
+            printf("Unable to write %s\n", zPath);
+            return 1;
+        }
+    }
+    double const total = now() - start;
+    printf("%s: %zu elements in chunks of %zu, %.3f s (%.2f GB/s) until z was "
+           "complete, %.3f s (%.2f GB/s) until it was written to the file\n",
+           mapped ? "mmap" : "fread", dimension, chunkElements,
+           computed, 3.0 * size / computed * 1e-9, total, 3.0 * size / total * 1e-9);
+
+    // Check that results are correct.  Multiplying by 2 is exact, so the
+    // result is exact whether or not the device fuses the multiply and
+    // add.  (This reads the dropped pages of x and y back in.)
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                   x[i], a, y[i], z[i]);
+            return 100;
+        }
+    }
+    printf("Computation appears to have completed successfully.\n");
+
+    // Unmap or free memory
+    if (mapped)
+    {
+        munmap(x, size);
+        munmap(y, size);
+        munmap(z, size);
+    }
+    else
+    {
+        free(x);
+        free(y);
+        free(z);
+    }
+
+    // Release device memory, kernel, program, command queue, and context.
+    for (int b = 0; b < BUFFER_SETS; ++ b)
+    {
+        clReleaseMemObject(sets[b].devXmem);
+        clReleaseMemObject(sets[b].devYmem);
+        clReleaseMemObject(sets[b].devZmem);
+    }
+    clReleaseKernel(kernel);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(commandQueue);
+    clReleaseContext(context);
+
+    return 0;
+}
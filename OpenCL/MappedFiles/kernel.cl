@@ -0,0 +1,16 @@
+// This kernel computes z = a*x + y over 'count' elements.
+//
+// The bound check lets the last chunk, which is usually shorter than the
+// others, run on the full-sized chunk buffers.
+
+__kernel void saxpy(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong count)
+{
+    // Get element index n.
+    size_t n = get_global_id(0);
+
+    if (n < count)
+    {
+        z[n] = a*x[n] + y[n];
+    }
+}
@@ -157,7 +157,7 @@ int main()
     float* z = (float*) malloc(sizeof(float) * dimension);
 
     // Set values to something easy to verify
-    for (unsigned int i = 0; i < dimension; ++ i)
+    for (size_t i = 0; i < dimension; ++ i)
     {
         x[i] = (float) i;
         y[i] = 100 - (float) i;
@@ -250,12 +250,13 @@ int main()
 
     // Check that results are correct.  Note that the code below
     // depends on the computation being exact, which may not be the
-    // case for more complicated computations.
-    for (unsigned int i = 0; i < dimension; ++ i)
+    // case for more complicated computations.  The Verification sample
+    // shows a faster check that tolerates small rounding differences.
+    for (size_t i = 0; i < dimension; ++ i)
     {
         if (x[i]*a + y[i] != z[i])
         {
-            printf("Unexpected result at element %d:\n", (int)i);
+            printf("Unexpected result at element %llu:\n", (unsigned long long) i);
             printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
                    x[i], a, y[i], z[i]);
             return 100;
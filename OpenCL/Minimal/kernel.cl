@@ -5,7 +5,7 @@ __kernel void saxpy(__global float const* x, __global float const* y,
     __global float* z, float a)
 {
     // Get element index n.
-    int n = get_global_id(0);
+    size_t n = get_global_id(0);
 
     z[n] = a*x[n] + y[n];
 }
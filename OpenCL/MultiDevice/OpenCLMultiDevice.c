@@ -0,0 +1,429 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <CL/opencl.h>
+
+// This sample splits one saxpy (z=a*x+y) across every device in the
+// context.  Each device gets its own command queue, kernel object and
+// chunk-sized buffers, and a host thread per device repeatedly takes the
+// next chunk of the x/y/z range, uploads it, runs the kernel on it and
+// reads the result back.  Fast devices therefore take more chunks than
+// slow ones; on top of that the chunk size each device takes is derived
+// from its measured throughput, and shrinks as the remaining work runs
+// out, so that all devices finish at about the same time.
+
+#define MAX_DEVICES 8
+
+// The shared range of work.  'next' is the first element not yet handed
+// out; 'throughput' is each device's measured rate in elements per second
+// (0 until its first chunk completes).
+typedef struct
+{
+    pthread_mutex_t lock;
+    size_t dimension;
+    size_t next;
+    size_t probeChunk;
+    size_t granularity;
+    int deviceCount;
+    double throughput[MAX_DEVICES];
+} WorkQueue;
+
+// Per-device state, owned by one host thread.
+typedef struct
+{
+    WorkQueue* work;
+    int index;
+    char name[256];
+    cl_command_queue queue;
+    cl_kernel kernel;
+    cl_mem devXmem;
+    cl_mem devYmem;
+    cl_mem devZmem;
+    size_t capacity;
+    float const* x;
+    float const* y;
+    float* z;
+    float a;
+
+    // Results
+    size_t elements;
+    int chunks;
+    double busySeconds;
+    cl_int result;
+} DeviceWorker;
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Hand out the next chunk for a device.  Until a device has completed a
+// chunk it gets a small probe chunk.  After that it gets half of its
+// throughput-weighted share of whatever remains (so chunks shrink towards
+// the end of the range, as in guided scheduling), rounded to the
+// granularity and limited to the size of its buffers.  Returns 0 when the
+// range is exhausted.
+static int takeChunk(WorkQueue* work, int index, size_t capacity,
+                     size_t* offset, size_t* count)
+{
+    pthread_mutex_lock(&work->lock);
+    size_t const remaining = work->dimension - work->next;
+    size_t chunk = work->probeChunk;
+    if (work->throughput[index] > 0)
+    {
+        // Devices still running their probe chunk are assumed to be as
+        // fast as this one, so that the first device to finish doesn't
+        // grab the bulk of the range.
+        double total = 0;
+        for (int d = 0; d < work->deviceCount; ++ d)
+            total += work->throughput[d] > 0 ? work->throughput[d]
+                                             : work->throughput[index];
+        double const share = work->throughput[index] / total;
+        chunk = (size_t) (remaining * share / 2);
+        chunk = (chunk + work->granularity - 1)
+                / work->granularity * work->granularity;
+    }
+    if (chunk < work->granularity)
+        chunk = work->granularity;
+    if (chunk > capacity)
+        chunk = capacity;
+    if (chunk > remaining)
+        chunk = remaining;
+    *offset = work->next;
+    *count = chunk;
+    work->next += chunk;
+    pthread_mutex_unlock(&work->lock);
+    return chunk > 0;
+}
+
+// Record the throughput a device achieved on its last chunk, smoothing it
+// with the previous measurement.
+static void reportThroughput(WorkQueue* work, int index, double elementsPerSecond)
+{
+    pthread_mutex_lock(&work->lock);
+    double const previous = work->throughput[index];
+    work->throughput[index] = previous > 0
+        ? 0.5 * (previous + elementsPerSecond) : elementsPerSecond;
+    pthread_mutex_unlock(&work->lock);
+}
+
+static void* deviceThread(void* argument)
+{
+    DeviceWorker* worker = (DeviceWorker*) argument;
+    size_t offset = 0;
+    size_t count = 0;
+    while (takeChunk(worker->work, worker->index, worker->capacity,
+                     &offset, &count))
+    {
+        double const start = now();
+        size_t const bytes = count * sizeof(cl_float);
+
+        // The uploads are non-blocking; the in-order queue makes the
+        // kernel wait for them, and the blocking read waits for the
+        // kernel.
+        cl_int r = clEnqueueWriteBuffer(worker->queue, worker->devXmem,
+                   CL_FALSE, 0, bytes, worker->x + offset, 0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clEnqueueWriteBuffer(worker->queue, worker->devYmem,
+                CL_FALSE, 0, bytes, worker->y + offset, 0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clEnqueueNDRangeKernel(worker->queue, worker->kernel, 1,
+                NULL, &count, NULL, 0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clEnqueueReadBuffer(worker->queue, worker->devZmem,
+                CL_TRUE, 0, bytes, worker->z + offset, 0, NULL, NULL);
+        if (CL_SUCCESS != r)
+        {
+            // Leave the rest of the range to the other devices; main()
+            // notices the failure and the gap it leaves behind.
+            printf("Device %d failed with code %d on elements %zu..%zu\n",
+                   worker->index, r, offset, offset + count);
+            worker->result = r;
+            break;
+        }
+
+        double const seconds = now() - start;
+        reportThroughput(worker->work, worker->index,
+                         seconds > 0 ? count / seconds : (double) count);
+        worker->elements += count;
+        worker->chunks += 1;
+        worker->busySeconds += seconds;
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv)
+{
+    // The problem size and the number of devices to use can be given on
+    // the command line: OpenCLMultiDevice [elements [maxDevices]].
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) 16 << 20;
+    int const maxDevicesToUse = argc > 2 ? atoi(argv[2]) : MAX_DEVICES;
+
+    // TODO: The probe chunk is what every device runs before its
+    // throughput is known, and the granularity is the smallest chunk
+    // handed out.  Both should be large enough to hide the per-chunk
+    // launch and transfer overhead, and small enough that the slowest
+    // device doesn't hold up the end of the run.
+    size_t const probeChunk = 256 << 10;
+    size_t const granularity = 16 << 10;
+    size_t const maxChunk = 8 << 20;
+
+    // Get the list of platforms.
+    int const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint numPlatforms = 0;
+    cl_int r = clGetPlatformIDs(maxPlatformCount, &platforms[0], &numPlatforms);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: A context can only hold devices of one platform, so this
+    // sample uses the devices of a single platform.
+    int const platformToUse = 0;
+
+    // Get all devices available for the chosen platform, of any type.
+    cl_uint deviceCount = 0;
+    cl_device_id devices[MAX_DEVICES];
+    r = clGetDeviceIDs(platforms[platformToUse], CL_DEVICE_TYPE_ALL,
+                       MAX_DEVICES, &devices[0], &deviceCount);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+    if (deviceCount > MAX_DEVICES)
+        deviceCount = MAX_DEVICES;
+    if (maxDevicesToUse > 0 && deviceCount > (cl_uint) maxDevicesToUse)
+        deviceCount = maxDevicesToUse;
+
+    // Create the context, using all devices.
+    cl_context context = clCreateContext(0, deviceCount, &devices[0], NULL,
+                                         NULL, &r);
+    if (0 == context || CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return value %p and code %d\n",
+               context, r);
+        return r;
+    }
+
+    // Read the kernel source and build it for every device.
+    FILE* kernelFile = fopen("kernel.cl", "rb");
+    if (NULL == kernelFile)
+    {
+        printf("Unable to open kernel source file\n");
+        return 1;
+    }
+    fseek(kernelFile, 0, SEEK_END);
+    long kernelSize = ftell(kernelFile);
+    fseek(kernelFile, 0, SEEK_SET);
+    char* kernelSource = (char*) malloc(kernelSize+1);
+    if (kernelSize != (long) fread(kernelSource, 1, kernelSize, kernelFile))
+    {
+        printf("Unable to read kernel source\n");
+        return 4;
+    }
+    fclose(kernelFile);
+    kernelSource[kernelSize] = 0;
+
+    const char* sourceLines[1] = {kernelSource};
+    cl_program program = clCreateProgramWithSource(context, 1,
+                         &sourceLines[0], NULL, &r);
+    free(kernelSource);
+    kernelSource = NULL;
+    if (0 == program || CL_SUCCESS != r)
+    {
+        printf("clCreateProgramWithSource failed with return value %p and code %d\n",
+               program, r);
+        return r;
+    }
+
+    r = clBuildProgram(program, 0, 0, 0, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("clBuildProgram failed with return value %d; error logs:\n", r);
+        for (cl_uint d = 0; d < deviceCount; ++ d)
+        {
+            char buildLog[1024*16];
+            if (CL_SUCCESS == clGetProgramBuildInfo(program, devices[d],
+                CL_PROGRAM_BUILD_LOG, sizeof(buildLog), buildLog, NULL))
+            {
+                printf("Device %u:\n%s\n", d, buildLog);
+            }
+        }
+        return r;
+    }
+
+    // Allocate host memory for input and output vectors, and set values
+    // to something easy to verify.
+    float const a = 2.0f;
+    float* x = (float*) malloc(sizeof(float) * dimension);
+    float* y = (float*) malloc(sizeof(float) * dimension);
+    float* z = (float*) malloc(sizeof(float) * dimension);
+    if (NULL == x || NULL == y || NULL == z)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+        z[i] = - (float) i;
+    }
+
+    WorkQueue work;
+    memset(&work, 0, sizeof(work));
+    pthread_mutex_init(&work.lock, NULL);
+    work.dimension = dimension;
+    work.probeChunk = probeChunk;
+    work.granularity = granularity;
+    work.deviceCount = deviceCount;
+
+    // Create a queue, a kernel and a set of chunk-sized buffers for each
+    // device.  Per-device buffers (rather than sub-buffers of one
+    // context-wide buffer) keep every device's data resident on that
+    // device, instead of leaving the runtime to migrate a shared buffer
+    // between devices.
+    DeviceWorker workers[MAX_DEVICES];
+    memset(workers, 0, sizeof(workers));
+    for (cl_uint d = 0; d < deviceCount; ++ d)
+    {
+        DeviceWorker* worker = &workers[d];
+        worker->work = &work;
+        worker->index = d;
+        worker->x = x;
+        worker->y = y;
+        worker->z = z;
+        worker->a = a;
+        clGetDeviceInfo(devices[d], CL_DEVICE_NAME, sizeof(worker->name),
+                        worker->name, NULL);
+
+        cl_ulong maxAllocSize = 0;
+        clGetDeviceInfo(devices[d], CL_DEVICE_MAX_MEM_ALLOC_SIZE,
+                        sizeof(maxAllocSize), &maxAllocSize, NULL);
+        worker->capacity = maxChunk;
+        if (maxAllocSize / sizeof(cl_float) < worker->capacity)
+            worker->capacity = (size_t) (maxAllocSize / sizeof(cl_float))
+                               / granularity * granularity;
+
+        worker->queue = clCreateCommandQueue(context, devices[d], 0, &r);
+        if (0 == worker->queue || CL_SUCCESS != r)
+        {
+            printf("clCreateCommandQueue failed for device %u with code %d\n",
+                   d, r);
+            return r;
+        }
+
+        worker->kernel = clCreateKernel(program, "saxpy", &r);
+        if (0 == worker->kernel || CL_SUCCESS != r)
+        {
+            printf("clCreateKernel failed for device %u with code %d\n", d, r);
+            return r;
+        }
+
+        size_t const bytes = worker->capacity * sizeof(cl_float);
+        worker->devXmem = clCreateBuffer(context, CL_MEM_READ_ONLY, bytes, NULL, &r);
+        if (CL_SUCCESS == r)
+            worker->devYmem = clCreateBuffer(context, CL_MEM_READ_ONLY, bytes, NULL, &r);
+        if (CL_SUCCESS == r)
+            worker->devZmem = clCreateBuffer(context, CL_MEM_WRITE_ONLY, bytes, NULL, &r);
+        if (CL_SUCCESS != r)
+        {
+            printf("clCreateBuffer failed for device %u with code %d\n", d, r);
+            return r;
+        }
+
+        // The buffers never change, so the kernel arguments can be set
+        // once for each device's kernel object.
+        clSetKernelArg(worker->kernel, 0, sizeof(cl_mem), &worker->devXmem);
+        clSetKernelArg(worker->kernel, 1, sizeof(cl_mem), &worker->devYmem);
+        clSetKernelArg(worker->kernel, 2, sizeof(cl_mem), &worker->devZmem);
+        r = clSetKernelArg(worker->kernel, 3, sizeof(cl_float), &worker->a);
+        if (CL_SUCCESS != r)
+        {
+            printf("clSetKernelArg failed for device %u with code %d\n", d, r);
+            return r;
+        }
+    }
+
+    // Run one host thread per device until the range is exhausted.
+    double const start = now();
+    pthread_t threads[MAX_DEVICES];
+    for (cl_uint d = 0; d < deviceCount; ++ d)
+    {
+        if (0 != pthread_create(&threads[d], NULL, deviceThread, &workers[d]))
+        {
+            printf("Unable to start the thread for device %u\n", d);
+            return 1;
+        }
+    }
+    for (cl_uint d = 0; d < deviceCount; ++ d)
+    {
+        pthread_join(threads[d], NULL);
+    }
+    double const seconds = now() - start;
+
+    // Report how the work was shared out.  With good balancing the busy
+    // times of all devices are close to the total time.
+    printf("%zu elements on %u device(s) in %.3f ms (%.2f GB/s)\n",
+           dimension, deviceCount, seconds * 1e3,
+           3.0 * dimension * sizeof(cl_float) / seconds * 1e-9);
+    size_t processed = 0;
+    for (cl_uint d = 0; d < deviceCount; ++ d)
+    {
+        DeviceWorker const* worker = &workers[d];
+        printf("  device %u (%s): %zu elements (%.1f%%) in %d chunks, "
+               "busy %.3f ms\n", d, worker->name, worker->elements,
+               100.0 * worker->elements / dimension, worker->chunks,
+               worker->busySeconds * 1e3);
+        processed += worker->elements;
+    }
+    if (processed != dimension)
+    {
+        printf("Only %zu of %zu elements were processed\n", processed, dimension);
+        return 1;
+    }
+
+    // Check that results are correct.  Note that the code below
+    // depends on the computation being exact, which may not be the
+    // case for more complicated computations.
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                   x[i], a, y[i], z[i]);
+            return 100;
+        }
+    }
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(x);
+    free(y);
+    free(z);
+    pthread_mutex_destroy(&work.lock);
+
+    // Release per-device objects, then the program and context.
+    for (cl_uint d = 0; d < deviceCount; ++ d)
+    {
+        clReleaseMemObject(workers[d].devXmem);
+        clReleaseMemObject(workers[d].devYmem);
+        clReleaseMemObject(workers[d].devZmem);
+        clReleaseKernel(workers[d].kernel);
+        clReleaseCommandQueue(workers[d].queue);
+    }
+    clReleaseProgram(program);
+    clReleaseContext(context);
+
+    return 0;
+}
@@ -0,0 +1,464 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CL/opencl.h>
+
+// This sample runs a saxpy (z=a*x+y) in several precisions, all built
+// from the one kernel in kernel.cl with different -D options:
+//
+//   half         half in memory, float arithmetic (vload_half and
+//                vstore_half, available on every device)
+//   half-native  half in memory and half arithmetic (needs cl_khr_fp16)
+//   float        float, as in the Minimal sample
+//   double       double in memory and arithmetic (needs cl_khr_fp64)
+//
+// The device's extension string decides which variants are offered.
+// Half storage halves the memory traffic of a bandwidth-bound kernel
+// compared to float, at the cost of precision, so each variant is
+// verified against a tolerance that suits it.
+
+typedef enum
+{
+    PRECISION_HALF,
+    PRECISION_HALF_NATIVE,
+    PRECISION_FLOAT,
+    PRECISION_DOUBLE,
+    PRECISION_COUNT
+} Precision;
+
+typedef struct
+{
+    char const* name;
+    char const* buildOptions;
+    // The extension the variant needs, or NULL.
+    char const* extension;
+    size_t elementSize;
+    // The size of the argument a: double for double, float otherwise.
+    size_t scalarSize;
+    // The largest relative error accepted: a little more than one
+    // rounding to the storage type (or, for half-native, two roundings
+    // in half).
+    double tolerance;
+} PrecisionInfo;
+
+static PrecisionInfo const precisions[PRECISION_COUNT] =
+{
+    {"half", "-DSTORAGE=half -DREAL=float -DHALF_STORAGE", NULL,
+     sizeof(cl_half), sizeof(cl_float), 1e-3},
+    {"half-native", "-DSTORAGE=half -DREAL=half -DSCALAR=float -DUSE_FP16", "cl_khr_fp16",
+     sizeof(cl_half), sizeof(cl_float), 2e-3},
+    {"float", "-DSTORAGE=float", NULL,
+     sizeof(cl_float), sizeof(cl_float), 1e-6},
+    {"double", "-DSTORAGE=double -DUSE_FP64", "cl_khr_fp64",
+     sizeof(cl_double), sizeof(cl_double), 1e-14}
+};
+
+// Convert a float to IEEE half precision, rounding to nearest even.
+static cl_half floatToHalf(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint32_t const sign = (bits >> 16) & 0x8000;
+    uint32_t const magnitude = bits & 0x7fffffff;
+
+    if (magnitude >= 0x7f800000)
+    {
+        // Infinity, or NaN (kept quiet).
+        return (cl_half) (sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0));
+    }
+    if (magnitude >= 0x477ff000)
+    {
+        // Rounds to more than the largest half, 65504.
+        return (cl_half) (sign | 0x7c00);
+    }
+    if (magnitude < 0x38800000)
+    {
+        // A subnormal half (or zero): shift the mantissa, with its
+        // implicit bit, into place and round.
+        if (magnitude < 0x33000000)
+            return (cl_half) sign;
+        uint32_t const mantissa = (magnitude & 0x7fffff) | 0x800000;
+        int const shift = 126 - (int) (magnitude >> 23);
+        uint32_t half = mantissa >> shift;
+        uint32_t const rest = mantissa & ((1u << shift) - 1);
+        uint32_t const halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            ++ half;
+        return (cl_half) (sign | half);
+    }
+    // A normal half: rebias the exponent and round the mantissa; a carry
+    // out of the mantissa correctly bumps the exponent.
+    uint32_t half = (magnitude - 0x38000000) >> 13;
+    uint32_t const rest = magnitude & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        ++ half;
+    return (cl_half) (sign | half);
+}
+
+static float halfToFloat(cl_half h)
+{
+    uint32_t const sign = (uint32_t) (h & 0x8000) << 16;
+    uint32_t const exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits;
+    if (0x1f == exponent)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (0 != exponent)
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (0 == mantissa)
+    {
+        bits = sign;
+    }
+    else
+    {
+        // Subnormal: normalize it.
+        int e = 113;
+        while (0 == (mantissa & 0x400))
+        {
+            mantissa <<= 1;
+            -- e;
+        }
+        bits = sign | ((uint32_t) e << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Store values in the given precision, and read them back.
+static void toStorage(Precision precision, double const* values, void* storage,
+                      size_t count)
+{
+    for (size_t i = 0; i < count; ++ i)
+    {
+        switch (precisions[precision].elementSize)
+        {
+        case sizeof(cl_half):
+            ((cl_half*) storage)[i] = floatToHalf((float) values[i]);
+            break;
+        case sizeof(cl_float):
+            ((cl_float*) storage)[i] = (cl_float) values[i];
+            break;
+        default:
+            ((cl_double*) storage)[i] = values[i];
+            break;
+        }
+    }
+}
+
+static double fromStorage(Precision precision, void const* storage, size_t i)
+{
+    switch (precisions[precision].elementSize)
+    {
+    case sizeof(cl_half):
+        return halfToFloat(((cl_half const*) storage)[i]);
+    case sizeof(cl_float):
+        return ((cl_float const*) storage)[i];
+    default:
+        return ((cl_double const*) storage)[i];
+    }
+}
+
+// Whether a space-separated extension string contains 'extension'.
+static int hasExtension(char const* extensions, char const* extension)
+{
+    size_t const length = strlen(extension);
+    for (char const* p = strstr(extensions, extension); NULL != p;
+         p = strstr(p + 1, extension))
+    {
+        if ((p == extensions || ' ' == p[-1]) && (0 == p[length] || ' ' == p[length]))
+            return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLPrecision [elements [all|half|half-native|float|double]]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) 1 << 24;
+    char const* selection = argc > 2 ? argv[2] : "all";
+
+    // Get the list of platforms.
+    int const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint numPlatforms = 0;
+    cl_int r = clGetPlatformIDs(maxPlatformCount, &platforms[0], &numPlatforms);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: You may want to look at the list of platforms that are
+    // returned, and choose the most appropriate one for your needs.
+    int const platformToUse = 0;
+
+    // Get the devices available for the chosen platform.
+    cl_uint deviceCount = 0;
+    size_t const maxDeviceCount = 8;
+    cl_device_id devices[maxDeviceCount];
+    r = clGetDeviceIDs(platforms[platformToUse], CL_DEVICE_TYPE_ALL,
+                       maxDeviceCount, &devices[0], &deviceCount);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: If you have multiple devices, you may specify which one
+    // you'd like to use by changing this variable.
+    int const deviceToUse = 0;
+    cl_device_id device = devices[deviceToUse];
+
+    // The extension string decides which variants can run.
+    size_t extensionsSize = 0;
+    clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, 0, NULL, &extensionsSize);
+    char* extensions = (char*) calloc(extensionsSize + 1, 1);
+    if (NULL == extensions)
+    {
+        printf("Unable to allocate host memory\n");
+        return 1;
+    }
+    clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, extensionsSize, extensions, NULL);
+    int offered[PRECISION_COUNT];
+    int selected = 0;
+    for (int p = 0; p < PRECISION_COUNT; ++ p)
+    {
+        offered[p] = NULL == precisions[p].extension
+                  || hasExtension(extensions, precisions[p].extension);
+        if (0 == strcmp(selection, "all") || 0 == strcmp(selection, precisions[p].name))
+        {
+            ++ selected;
+            if (!offered[p])
+                printf("Skipping %s: the device doesn't support %s\n",
+                       precisions[p].name, precisions[p].extension);
+        }
+        else
+        {
+            offered[p] = 0;
+        }
+    }
+    free(extensions);
+    if (0 == selected)
+    {
+        printf("Usage: %s [elements [all|half|half-native|float|double]]\n", argv[0]);
+        return 1;
+    }
+
+    cl_context context = clCreateContext(0, 1, &device, NULL, NULL, &r);
+    if (0 == context || CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return value %p and code %d\n",
+               context, r);
+        return r;
+    }
+
+    // Profiling is enabled so that the kernels can be timed.
+    cl_command_queue commandQueue = clCreateCommandQueue(context, device,
+                                    CL_QUEUE_PROFILING_ENABLE, &r);
+    if (0 == commandQueue || CL_SUCCESS != r)
+    {
+        printf("clCreateCommandQueue failed with return value %p and code %d\n",
+               commandQueue, r);
+        return r;
+    }
+
+    // Read the kernel source.  It is built once per variant.
+    FILE* kernelFile = fopen("kernel.cl", "rb");
+    if (NULL == kernelFile)
+    {
+        printf("Unable to open kernel source file\n");
+        return 1;
+    }
+    fseek(kernelFile, 0, SEEK_END);
+    long kernelSize = ftell(kernelFile);
+    fseek(kernelFile, 0, SEEK_SET);
+    char* kernelSource = (char*) malloc(kernelSize+1);
+    if (kernelSize != (long) fread(kernelSource, 1, kernelSize, kernelFile))
+    {
+        printf("Unable to read kernel source\n");
+        return 4;
+    }
+    fclose(kernelFile);
+    kernelSource[kernelSize] = 0;
+
+    // The inputs, in double; each variant stores them in its own
+    // precision.  z doesn't get small compared to x and y, so that the
+    // relative error stays meaningful.
+    double const a = 1.5;
+    double* x = (double*) malloc(sizeof(double) * dimension);
+    double* y = (double*) malloc(sizeof(double) * dimension);
+    void* hostX = malloc(sizeof(cl_double) * dimension);
+    void* hostY = malloc(sizeof(cl_double) * dimension);
+    void* hostZ = malloc(sizeof(cl_double) * dimension);
+    if (NULL == x || NULL == y || NULL == hostX || NULL == hostY || NULL == hostZ)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (double) (i % 1000) / 1000.0;
+        y[i] = 0.5 + (double) (i % 777) / 777.0;
+    }
+
+    int failed = 0;
+    for (int p = 0; p < PRECISION_COUNT; ++ p)
+    {
+        if (!offered[p])
+            continue;
+        Precision const precision = (Precision) p;
+        PrecisionInfo const* info = &precisions[p];
+
+        const char* sourceLines[1] = {kernelSource};
+        cl_program program = clCreateProgramWithSource(context, 1,
+                             &sourceLines[0], NULL, &r);
+        if (0 == program || CL_SUCCESS != r)
+        {
+            printf("clCreateProgramWithSource failed with return value %p and code %d\n",
+                   program, r);
+            return r;
+        }
+        r = clBuildProgram(program, 1, &device, info->buildOptions, 0, 0);
+        if (CL_SUCCESS != r)
+        {
+            printf("clBuildProgram failed for %s with return value %d; error log:\n",
+                   info->name, r);
+            char buildLog[1024*16];
+            cl_int rlog = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG,
+                                                sizeof(buildLog), buildLog, NULL);
+            if (CL_SUCCESS == rlog)
+            {
+                printf("%s\n", buildLog);
+            }
+            return r;
+        }
+        cl_kernel kernel = clCreateKernel(program, "axpy", &r);
+        if (0 == kernel || CL_SUCCESS != r)
+        {
+            printf("clCreateKernel failed with return value %p and code %d\n",
+                   kernel, r);
+            return r;
+        }
+
+        // Store the inputs in this precision and copy them to the device.
+        size_t const size = info->elementSize * dimension;
+        toStorage(precision, x, hostX, dimension);
+        toStorage(precision, y, hostY, dimension);
+        cl_mem devXmem = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                        size, hostX, &r);
+        cl_mem devYmem = 0;
+        cl_mem devZmem = 0;
+        if (CL_SUCCESS == r)
+            devYmem = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                     size, hostY, &r);
+        if (CL_SUCCESS == r)
+            devZmem = clCreateBuffer(context, CL_MEM_WRITE_ONLY, size, NULL, &r);
+        if (CL_SUCCESS != r)
+        {
+            printf("clCreateBuffer failed with return code %d\n", r);
+            return r;
+        }
+
+        // The argument a is a double for double, and a float otherwise.
+        cl_float const aFloat = (cl_float) a;
+        cl_double const aDouble = a;
+        cl_ulong const count = dimension;
+        clSetKernelArg(kernel, 0, sizeof(cl_mem), &devXmem);
+        clSetKernelArg(kernel, 1, sizeof(cl_mem), &devYmem);
+        clSetKernelArg(kernel, 2, sizeof(cl_mem), &devZmem);
+        clSetKernelArg(kernel, 3, info->scalarSize,
+                       sizeof(cl_double) == info->scalarSize
+                       ? (void const*) &aDouble : (void const*) &aFloat);
+        clSetKernelArg(kernel, 4, sizeof(cl_ulong), &count);
+
+        // Run a few times and keep the best time.
+        cl_ulong best = 0;
+        for (int t = 0; t < 5; ++ t)
+        {
+            cl_event event = 0;
+            r = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, &dimension, NULL,
+                                       0, NULL, &event);
+            if (CL_SUCCESS == r)
+                r = clWaitForEvents(1, &event);
+            if (CL_SUCCESS != r)
+            {
+                printf("Running the %s kernel failed with code %d\n", info->name, r);
+                return r;
+            }
+            cl_ulong start = 0;
+            cl_ulong end = 0;
+            clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START,
+                                    sizeof(start), &start, NULL);
+            clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END,
+                                    sizeof(end), &end, NULL);
+            clReleaseEvent(event);
+            if (0 == t || end - start < best)
+                best = end - start;
+        }
+        r = clEnqueueReadBuffer(commandQueue, devZmem, CL_TRUE, 0, size, hostZ,
+                                0, NULL, NULL);
+        if (CL_SUCCESS != r)
+        {
+            printf("clEnqueueReadBuffer failed with return code %d\n", r);
+            return r;
+        }
+
+        // Compare with the result computed in double from the stored
+        // inputs, so that only the kernel's own rounding counts.
+        double maxError = 0.0;
+        size_t worst = 0;
+        for (size_t i = 0; i < dimension; ++ i)
+        {
+            double const expected = a * fromStorage(precision, hostX, i)
+                                  + fromStorage(precision, hostY, i);
+            double const error = fabs(fromStorage(precision, hostZ, i) - expected)
+                               / fabs(expected);
+            if (error > maxError)
+            {
+                maxError = error;
+                worst = i;
+            }
+        }
+        printf("%-12s %9.3f ms %8.2f GB/s  max relative error %.3g (tolerance %.3g)\n",
+               info->name, best * 1e-6,
+               best ? 3.0 * size / best : 0.0, maxError, info->tolerance);
+        if (maxError > info->tolerance)
+        {
+            printf("Unexpected result at element %zu: %.17g instead of %.17g\n",
+                   worst, fromStorage(precision, hostZ, worst),
+                   a * fromStorage(precision, hostX, worst)
+                   + fromStorage(precision, hostY, worst));
+            failed = 1;
+        }
+
+        clReleaseMemObject(devXmem);
+        clReleaseMemObject(devYmem);
+        clReleaseMemObject(devZmem);
+        clReleaseKernel(kernel);
+        clReleaseProgram(program);
+    }
+    if (failed)
+        return 100;
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(kernelSource);
+    free(x);
+    free(y);
+    free(hostX);
+    free(hostY);
+    free(hostZ);
+
+    // Release the command queue and context.
+    clReleaseCommandQueue(commandQueue);
+    clReleaseContext(context);
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+// This kernel computes z = a*x + y over 'count' elements, in a precision
+// chosen with -D options when the program is built:
+//
+//   STORAGE   The type of x, y and z in memory (half, float or double).
+//   REAL      The type the arithmetic is done in.
+//   SCALAR    The type of the argument a.
+//   HALF_STORAGE  Load and store with vload_half and vstore_half, which
+//             convert between half in memory and float, and don't need
+//             the cl_khr_fp16 extension.
+//   USE_FP16, USE_FP64  Enable cl_khr_fp16 or cl_khr_fp64.
+//
+// With no options, everything is float.
+
+#ifdef USE_FP16
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+#endif
+#ifdef USE_FP64
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+
+#ifndef STORAGE
+#define STORAGE float
+#endif
+#ifndef REAL
+#define REAL STORAGE
+#endif
+#ifndef SCALAR
+#define SCALAR REAL
+#endif
+
+#ifdef HALF_STORAGE
+#define LOAD(p, n) vload_half(n, p)
+#define STORE(v, p, n) vstore_half(v, n, p)
+#else
+#define LOAD(p, n) ((REAL) (p)[n])
+#define STORE(v, p, n) ((p)[n] = (STORAGE) (v))
+#endif
+
+__kernel void axpy(__global STORAGE const* x, __global STORAGE const* y,
+    __global STORAGE* z, SCALAR a, ulong count)
+{
+    // Get element index n.
+    size_t n = get_global_id(0);
+
+    if (n < count)
+    {
+        REAL const v = (REAL) a*LOAD(x, n) + LOAD(y, n);
+        STORE(v, z, n);
+    }
+}
@@ -0,0 +1,279 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Replay.h"
+
+// This sample repeats the same upload, saxpy (z=a*x+y) and readback many
+// times, cycling through several sets of buffers and host arrays, in
+// three ways:
+//
+//  - explicitly, setting the kernel arguments and enqueueing every
+//    command each time, as the Minimal sample does once,
+//  - replaying a recording (see Replay.h) with pre-bound kernels,
+//  - replaying the same recording from command buffers, if the device
+//    supports cl_khr_command_buffer.
+//
+// For each it reports the host time spent submitting an iteration (the
+// calls up to, but not including, the wait for the results) and the
+// process CPU time per iteration.  The problems are small on purpose, so
+// that the host side is what is measured.
+
+#define MAX_BINDINGS 4
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static double cpuNow(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// The buffers and host arrays of one binding.
+typedef struct
+{
+    cl_mem buffers[REPLAY_MAX_SLOTS];
+    void* hosts[REPLAY_MAX_SLOTS];
+} Binding;
+
+enum { SLOT_X, SLOT_Y, SLOT_Z };
+
+// One iteration the explicit way.
+static cl_int enqueueExplicit(Runtime* runtime, cl_kernel kernel, Binding const* b,
+                              float a, size_t dimension)
+{
+    size_t const size = dimension * sizeof(cl_float);
+    cl_ulong const count = dimension;
+    cl_int r = clEnqueueWriteBuffer(runtime->queue, b->buffers[SLOT_X], CL_FALSE, 0,
+                                    size, b->hosts[SLOT_X], 0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime->queue, b->buffers[SLOT_Y], CL_FALSE, 0,
+                                 size, b->hosts[SLOT_Y], 0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 0, sizeof(cl_mem), &b->buffers[SLOT_X]);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 1, sizeof(cl_mem), &b->buffers[SLOT_Y]);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 2, sizeof(cl_mem), &b->buffers[SLOT_Z]);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 4, sizeof(cl_ulong), &count);
+    if (CL_SUCCESS == r)
+        r = clEnqueueNDRangeKernel(runtime->queue, kernel, 1, NULL, &dimension, NULL,
+                                   0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clEnqueueReadBuffer(runtime->queue, b->buffers[SLOT_Z], CL_FALSE, 0, size,
+                                b->hosts[SLOT_Z], 0, NULL, NULL);
+    return r;
+}
+
+// Record upload, saxpy and readback, and bind every binding.
+static cl_int record(Recording* recording, cl_kernel kernel, Binding const* bindings,
+                     int bindingCount, float a, size_t dimension)
+{
+    size_t const size = dimension * sizeof(cl_float);
+    cl_ulong const count = dimension;
+    ReplayArg const args[5] =
+    {
+        {SLOT_X, sizeof(cl_mem), NULL},
+        {SLOT_Y, sizeof(cl_mem), NULL},
+        {SLOT_Z, sizeof(cl_mem), NULL},
+        {REPLAY_VALUE, sizeof(cl_float), &a},
+        {REPLAY_VALUE, sizeof(cl_ulong), &count}
+    };
+    if (replayWrite(recording, SLOT_X, SLOT_X, size) < 0
+        || replayWrite(recording, SLOT_Y, SLOT_Y, size) < 0
+        || replayKernel(recording, kernel, dimension, 5, args) < 0
+        || replayRead(recording, SLOT_Z, SLOT_Z, size) < 0)
+    {
+        return CL_INVALID_VALUE;
+    }
+    cl_int r = CL_SUCCESS;
+    for (int b = 0; b < bindingCount && CL_SUCCESS == r; ++ b)
+    {
+        replayBind(recording, bindings[b].buffers, &r);
+    }
+    return r;
+}
+
+// Run the iterations with a recording, or explicitly if it's NULL, and
+// check the results.
+static cl_int measure(char const* name, Runtime* runtime, cl_kernel kernel,
+                      Recording* recording, Binding const* bindings,
+                      int bindingCount, float a, size_t dimension, int iterations)
+{
+    // Clear the results on the host, and fill the device's with NaN, so
+    // that a replay that computes nothing, or into the wrong binding,
+    // can't pass the check with the results of an earlier run.
+    float const sentinel = NAN;
+    cl_int r = CL_SUCCESS;
+    for (int b = 0; b < bindingCount && CL_SUCCESS == r; ++ b)
+    {
+        memset(bindings[b].hosts[SLOT_Z], 0, dimension * sizeof(cl_float));
+        r = clEnqueueFillBuffer(runtime->queue, bindings[b].buffers[SLOT_Z], &sentinel,
+                                sizeof(sentinel), 0, dimension * sizeof(cl_float),
+                                0, NULL, NULL);
+    }
+    if (CL_SUCCESS == r)
+        r = clFinish(runtime->queue);
+    double submit = 0;
+    double const wallStart = now();
+    double const cpuStart = cpuNow();
+    for (int i = 0; i < iterations && CL_SUCCESS == r; ++ i)
+    {
+        int const b = i % bindingCount;
+        double const start = now();
+        if (NULL == recording)
+            r = enqueueExplicit(runtime, kernel, &bindings[b], a, dimension);
+        else
+            r = replayEnqueue(recording, b, bindings[b].hosts);
+        submit += now() - start;
+        if (CL_SUCCESS == r)
+            r = clFinish(runtime->queue);
+    }
+    double const cpu = cpuNow() - cpuStart;
+    double const wall = now() - wallStart;
+    if (CL_SUCCESS != r)
+    {
+        printf("%s failed with return code %d\n", name, r);
+        return r;
+    }
+    printf("%-28s %10.2f %10.2f %10.2f\n", name, submit / iterations * 1e6,
+           cpu / iterations * 1e6, wall / iterations * 1e6);
+
+    // Check that results are correct.  Iteration i runs binding
+    // i % bindingCount, so with fewer iterations than bindings the last
+    // ones never run.  Note that the code below depends on the computation
+    // being exact.
+    for (int b = 0; b < bindingCount && b < iterations; ++ b)
+    {
+        float const* x = (float const*) bindings[b].hosts[SLOT_X];
+        float const* y = (float const*) bindings[b].hosts[SLOT_Y];
+        float const* z = (float const*) bindings[b].hosts[SLOT_Z];
+        for (size_t i = 0; i < dimension; ++ i)
+        {
+            if (x[i]*a + y[i] != z[i])
+            {
+                printf("Unexpected result at element %zu of binding %d:\n", i, b);
+                printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                       x[i], a, y[i], z[i]);
+                return 100;
+            }
+        }
+    }
+    return CL_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLReplay [elements [iterations [bindings]]]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : 4096;
+    int const iterations = argc > 2 ? atoi(argv[2]) : 10000;
+    int const bindingCount = argc > 3 ? atoi(argv[3]) : MAX_BINDINGS;
+    if (0 == dimension || iterations < 1 || bindingCount < 1
+        || bindingCount > MAX_BINDINGS)
+    {
+        printf("Usage: %s [elements [iterations [bindings]]]\n", argv[0]);
+        printf("There are 1 to %d bindings.\n", MAX_BINDINGS);
+        return 1;
+    }
+
+    RuntimeOptions options;
+    runtimeDefaultOptions(&options);
+    options.kernelPath = "../Runtime/kernel.cl";
+    Runtime runtime;
+    cl_int r = runtimeCreate(&runtime, &options);
+    if (CL_SUCCESS != r)
+        return r;
+    cl_kernel kernel = runtimeKernel(&runtime, "saxpy", &r);
+    if (CL_SUCCESS != r)
+        return r;
+
+    // Each binding has its own buffers and its own data, so that a replay
+    // with the wrong binding shows up in the results.
+    float const a = 2.0f;
+    size_t const size = dimension * sizeof(cl_float);
+    Binding bindings[MAX_BINDINGS];
+    memset(bindings, 0, sizeof(bindings));
+    for (int b = 0; b < bindingCount && CL_SUCCESS == r; ++ b)
+    {
+        for (int s = SLOT_X; s <= SLOT_Z && CL_SUCCESS == r; ++ s)
+        {
+            bindings[b].hosts[s] = malloc(size);
+            if (NULL == bindings[b].hosts[s])
+            {
+                printf("Unable to allocate host memory for %zu elements\n", dimension);
+                return 1;
+            }
+            bindings[b].buffers[s] = runtimeAcquireBuffer(&runtime, size, &r);
+        }
+        float* x = (float*) bindings[b].hosts[SLOT_X];
+        float* y = (float*) bindings[b].hosts[SLOT_Y];
+        for (size_t i = 0; i < dimension; ++ i)
+        {
+            x[i] = (float) (i + b);
+            y[i] = 100 - (float) i;
+        }
+    }
+    if (CL_SUCCESS != r)
+    {
+        printf("Unable to create device buffers, return code %d\n", r);
+        return r;
+    }
+
+    Recording emulated;
+    Recording commandBuffers;
+    replayCreate(&emulated, &runtime, 0);
+    replayCreate(&commandBuffers, &runtime, 1);
+    r = record(&emulated, kernel, bindings, bindingCount, a, dimension);
+    if (CL_SUCCESS == r && commandBuffers.useCommandBuffers)
+        r = record(&commandBuffers, kernel, bindings, bindingCount, a, dimension);
+    if (CL_SUCCESS != r)
+    {
+        printf("Recording failed with return code %d\n", r);
+        return r;
+    }
+
+    printf("%zu elements, %d iterations over %d bindings\n",
+           dimension, iterations, bindingCount);
+    printf("%-28s %10s %10s %10s\n", "us per iteration", "submit", "CPU", "wall");
+    // TODO: The CPU time includes the wait in clFinish, which some
+    // drivers spend spinning; compare the submit times for those.
+    r = measure("explicit", &runtime, kernel, NULL, bindings, bindingCount, a,
+                dimension, iterations);
+    if (CL_SUCCESS == r)
+        r = measure("replay (pre-bound kernels)", &runtime, kernel, &emulated,
+                    bindings, bindingCount, a, dimension, iterations);
+    if (CL_SUCCESS == r && commandBuffers.useCommandBuffers)
+        r = measure("replay (command buffers)", &runtime, kernel, &commandBuffers,
+                    bindings, bindingCount, a, dimension, iterations);
+    else if (CL_SUCCESS == r)
+        printf("%-28s not supported by the device\n", "replay (command buffers)");
+    if (CL_SUCCESS != r)
+        return r;
+    printf("Computation appears to have completed successfully.\n");
+
+    // Release the recordings, then give the buffers back and free memory.
+    replayRelease(&emulated);
+    replayRelease(&commandBuffers);
+    for (int b = 0; b < bindingCount; ++ b)
+    {
+        for (int s = SLOT_X; s <= SLOT_Z; ++ s)
+        {
+            runtimeReleaseBuffer(&runtime, bindings[b].buffers[s]);
+            free(bindings[b].hosts[s]);
+        }
+    }
+    runtimeRelease(&runtime);
+
+    return 0;
+}
@@ -0,0 +1,313 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Replay.h"
+
+// Return whether a space-separated extension list contains an extension.
+static int hasExtension(char const* extensions, char const* extension)
+{
+    size_t const length = strlen(extension);
+    for (char const* p = strstr(extensions, extension); NULL != p;
+         p = strstr(p + 1, extension))
+    {
+        if ((p == extensions || ' ' == p[-1]) && (0 == p[length] || ' ' == p[length]))
+            return 1;
+    }
+    return 0;
+}
+
+// Look up the cl_khr_command_buffer entry points, if the device supports
+// the extension and the runtime's queue has the properties it requires.
+static int loadCommandBuffers(Recording* recording)
+{
+    Runtime* runtime = recording->runtime;
+    size_t extensionsSize = 0;
+    if (CL_SUCCESS != clGetDeviceInfo(runtime->device, CL_DEVICE_EXTENSIONS, 0, NULL,
+                                      &extensionsSize))
+        return 0;
+    char* extensions = (char*) malloc(extensionsSize + 1);
+    if (NULL == extensions)
+        return 0;
+    extensions[0] = 0;
+    clGetDeviceInfo(runtime->device, CL_DEVICE_EXTENSIONS, extensionsSize,
+                    extensions, NULL);
+    extensions[extensionsSize] = 0;
+    int const supported = hasExtension(extensions, "cl_khr_command_buffer");
+    free(extensions);
+    if (!supported)
+        return 0;
+
+    // CL_DEVICE_COMMAND_BUFFER_REQUIRED_QUEUE_PROPERTIES_KHR
+    cl_command_queue_properties required = 0;
+    cl_command_queue_properties properties = 0;
+    clGetDeviceInfo(runtime->device, 0x12AA, sizeof(required), &required, NULL);
+    clGetCommandQueueInfo(runtime->queue, CL_QUEUE_PROPERTIES, sizeof(properties),
+                          &properties, NULL);
+    if (required & ~properties)
+        return 0;
+
+    cl_platform_id const platform = runtime->platform;
+    recording->createCommandBuffer = (ReplayCreateCommandBuffer)
+        clGetExtensionFunctionAddressForPlatform(platform, "clCreateCommandBufferKHR");
+    recording->commandNDRangeKernel = (ReplayCommandNDRangeKernel)
+        clGetExtensionFunctionAddressForPlatform(platform, "clCommandNDRangeKernelKHR");
+    recording->finalizeCommandBuffer = (ReplayFinalizeCommandBuffer)
+        clGetExtensionFunctionAddressForPlatform(platform, "clFinalizeCommandBufferKHR");
+    recording->enqueueCommandBuffer = (ReplayEnqueueCommandBuffer)
+        clGetExtensionFunctionAddressForPlatform(platform, "clEnqueueCommandBufferKHR");
+    recording->releaseCommandBuffer = (ReplayReleaseCommandBuffer)
+        clGetExtensionFunctionAddressForPlatform(platform, "clReleaseCommandBufferKHR");
+    return NULL != recording->createCommandBuffer
+        && NULL != recording->commandNDRangeKernel
+        && NULL != recording->finalizeCommandBuffer
+        && NULL != recording->enqueueCommandBuffer
+        && NULL != recording->releaseCommandBuffer;
+}
+
+cl_int replayCreate(Recording* recording, Runtime* runtime, int allowCommandBuffers)
+{
+    memset(recording, 0, sizeof(*recording));
+    recording->runtime = runtime;
+    recording->useCommandBuffers = allowCommandBuffers && loadCommandBuffers(recording);
+    return CL_SUCCESS;
+}
+
+void replayRelease(Recording* recording)
+{
+    for (int c = 0; c < recording->commandCount; ++ c)
+    {
+        ReplayCommand* command = &recording->commands[c];
+        for (int b = 0; b < recording->bindingCount; ++ b)
+        {
+            if (command->bound[b])
+                clReleaseKernel(command->bound[b]);
+            if (command->commandBuffers[b])
+                recording->releaseCommandBuffer(command->commandBuffers[b]);
+        }
+    }
+    memset(recording, 0, sizeof(*recording));
+}
+
+// Append a command, or return NULL.
+static ReplayCommand* addCommand(Recording* recording, ReplayCommandType type)
+{
+    if (recording->bindingCount > 0)
+    {
+        printf("Commands can't be recorded after replayBind\n");
+        return NULL;
+    }
+    if (REPLAY_MAX_COMMANDS == recording->commandCount)
+    {
+        printf("A recording holds at most %d commands\n", REPLAY_MAX_COMMANDS);
+        return NULL;
+    }
+    ReplayCommand* command = &recording->commands[recording->commandCount];
+    memset(command, 0, sizeof(*command));
+    command->type = type;
+    return command;
+}
+
+static int validSlots(int bufferSlot, int hostSlot)
+{
+    if (bufferSlot < 0 || bufferSlot >= REPLAY_MAX_SLOTS
+        || hostSlot < 0 || hostSlot >= REPLAY_MAX_SLOTS)
+    {
+        printf("Slots must be from 0 to %d\n", REPLAY_MAX_SLOTS - 1);
+        return 0;
+    }
+    return 1;
+}
+
+int replayWrite(Recording* recording, int bufferSlot, int hostSlot, size_t size)
+{
+    ReplayCommand* command = addCommand(recording, REPLAY_WRITE);
+    if (NULL == command || !validSlots(bufferSlot, hostSlot))
+        return -1;
+    command->bufferSlot = bufferSlot;
+    command->hostSlot = hostSlot;
+    command->size = size;
+    return recording->commandCount++;
+}
+
+int replayRead(Recording* recording, int bufferSlot, int hostSlot, size_t size)
+{
+    ReplayCommand* command = addCommand(recording, REPLAY_READ);
+    if (NULL == command || !validSlots(bufferSlot, hostSlot))
+        return -1;
+    command->bufferSlot = bufferSlot;
+    command->hostSlot = hostSlot;
+    command->size = size;
+    return recording->commandCount++;
+}
+
+int replayKernel(Recording* recording, cl_kernel kernel, size_t globalSize,
+                 cl_uint argCount, ReplayArg const* args)
+{
+    ReplayCommand* command = addCommand(recording, REPLAY_KERNEL);
+    if (NULL == command)
+        return -1;
+    if (argCount > REPLAY_MAX_ARGS)
+    {
+        printf("A kernel command has more than %d arguments\n", REPLAY_MAX_ARGS);
+        return -1;
+    }
+    for (cl_uint a = 0; a < argCount; ++ a)
+    {
+        if (REPLAY_VALUE == args[a].slot)
+        {
+            if (args[a].size > REPLAY_MAX_ARG_SIZE)
+            {
+                printf("Kernel argument %u is larger than %d bytes\n", a,
+                       REPLAY_MAX_ARG_SIZE);
+                return -1;
+            }
+            memcpy(command->argValues[a], args[a].value, args[a].size);
+        }
+        else if (!validSlots(args[a].slot, 0))
+        {
+            return -1;
+        }
+        command->argSlots[a] = args[a].slot;
+        command->argSizes[a] = args[a].size;
+    }
+    command->kernel = kernel;
+    command->globalSize = globalSize;
+    command->argCount = argCount;
+    return recording->commandCount++;
+}
+
+// Create a kernel object of its own for a kernel command, and set its
+// arguments for a binding.
+static cl_int bindKernel(Recording* recording, ReplayCommand* command, int binding)
+{
+    cl_program program = 0;
+    char name[256] = "";
+    cl_int r = clGetKernelInfo(command->kernel, CL_KERNEL_PROGRAM, sizeof(program),
+                               &program, NULL);
+    if (CL_SUCCESS == r)
+        r = clGetKernelInfo(command->kernel, CL_KERNEL_FUNCTION_NAME, sizeof(name),
+                            name, NULL);
+    if (CL_SUCCESS == r)
+        command->bound[binding] = clCreateKernel(program, name, &r);
+    for (cl_uint a = 0; a < command->argCount && CL_SUCCESS == r; ++ a)
+    {
+        if (REPLAY_VALUE == command->argSlots[a])
+            r = clSetKernelArg(command->bound[binding], a, command->argSizes[a],
+                               command->argValues[a]);
+        else
+            r = clSetKernelArg(command->bound[binding], a, sizeof(cl_mem),
+                               &recording->buffers[binding][command->argSlots[a]]);
+    }
+    return r;
+}
+
+// Record the run of kernel commands starting at 'first' into a command
+// buffer for a binding.
+static cl_int recordRun(Recording* recording, int first, int binding)
+{
+    ReplayCommand* command = &recording->commands[first];
+    cl_command_queue queue = recording->runtime->queue;
+    cl_int r = CL_SUCCESS;
+    cl_command_buffer_khr commandBuffer =
+        recording->createCommandBuffer(1, &queue, NULL, &r);
+    if (CL_SUCCESS != r)
+        return r;
+    command->commandBuffers[binding] = commandBuffer;
+    int length = 0;
+    for (int c = first; c < recording->commandCount && CL_SUCCESS == r; ++ c)
+    {
+        ReplayCommand const* kernelCommand = &recording->commands[c];
+        if (REPLAY_KERNEL != kernelCommand->type)
+            break;
+        // The commands of a command buffer may run in any order unless
+        // they are chained with sync points, but one recorded on an
+        // in-order queue keeps that order.
+        r = recording->commandNDRangeKernel(commandBuffer, NULL, NULL,
+                                            kernelCommand->bound[binding], 1, NULL,
+                                            &kernelCommand->globalSize, NULL,
+                                            0, NULL, NULL, NULL);
+        ++ length;
+    }
+    if (CL_SUCCESS == r)
+        r = recording->finalizeCommandBuffer(commandBuffer);
+    command->runLength = length;
+    return r;
+}
+
+int replayBind(Recording* recording, cl_mem const* buffers, cl_int* error)
+{
+    if (REPLAY_MAX_BINDINGS == recording->bindingCount)
+    {
+        printf("A recording holds at most %d bindings\n", REPLAY_MAX_BINDINGS);
+        *error = CL_INVALID_VALUE;
+        return -1;
+    }
+    int const binding = recording->bindingCount++;
+    memcpy(recording->buffers[binding], buffers, sizeof(recording->buffers[binding]));
+
+    cl_int r = CL_SUCCESS;
+    for (int c = 0; c < recording->commandCount && CL_SUCCESS == r; ++ c)
+    {
+        if (REPLAY_KERNEL == recording->commands[c].type)
+            r = bindKernel(recording, &recording->commands[c], binding);
+    }
+    for (int c = 0; c < recording->commandCount && recording->useCommandBuffers
+                    && CL_SUCCESS == r; ++ c)
+    {
+        if (REPLAY_KERNEL == recording->commands[c].type
+            && (0 == c || REPLAY_KERNEL != recording->commands[c - 1].type))
+        {
+            r = recordRun(recording, c, binding);
+        }
+    }
+    if (CL_SUCCESS != r)
+    {
+        printf("Preparing binding %d failed with return code %d\n", binding, r);
+        *error = r;
+        return -1;
+    }
+    *error = CL_SUCCESS;
+    return binding;
+}
+
+cl_int replayEnqueue(Recording* recording, int binding, void* const* hosts)
+{
+    if (binding < 0 || binding >= recording->bindingCount)
+        return CL_INVALID_VALUE;
+    cl_command_queue queue = recording->runtime->queue;
+    cl_mem const* buffers = recording->buffers[binding];
+    cl_int r = CL_SUCCESS;
+    for (int c = 0; c < recording->commandCount && CL_SUCCESS == r; ++ c)
+    {
+        ReplayCommand const* command = &recording->commands[c];
+        switch (command->type)
+        {
+        case REPLAY_WRITE:
+            r = clEnqueueWriteBuffer(queue, buffers[command->bufferSlot], CL_FALSE, 0,
+                                     command->size, hosts[command->hostSlot],
+                                     0, NULL, NULL);
+            break;
+        case REPLAY_READ:
+            r = clEnqueueReadBuffer(queue, buffers[command->bufferSlot], CL_FALSE, 0,
+                                    command->size, hosts[command->hostSlot],
+                                    0, NULL, NULL);
+            break;
+        case REPLAY_KERNEL:
+            if (command->commandBuffers[binding])
+            {
+                // Enqueued on the queue it was recorded for.
+                r = recording->enqueueCommandBuffer(0, NULL,
+                                                    command->commandBuffers[binding],
+                                                    0, NULL, NULL);
+                c += command->runLength - 1;
+            }
+            else
+            {
+                r = clEnqueueNDRangeKernel(queue, command->bound[binding], 1, NULL,
+                                           &command->globalSize, NULL, 0, NULL, NULL);
+            }
+            break;
+        }
+    }
+    return r;
+}
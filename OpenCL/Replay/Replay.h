@@ -0,0 +1,139 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "Runtime.h"
+
+// Record a sequence of buffer writes, kernels and buffer reads once, and
+// replay it many times with different buffers and host data, without
+// setting kernel arguments again.
+//
+// Commands refer to buffers and host memory by slot, not directly.
+// replayBind binds a set of buffers to the buffer slots, and prepares
+// everything a replay with those buffers needs: a kernel object per
+// kernel command with its arguments already set and, if the device
+// supports cl_khr_command_buffer, a command buffer for each run of
+// consecutive kernels.  (Command buffers can't hold transfers to and from
+// host memory, so those are always enqueued one by one.)  replayEnqueue
+// then takes a binding and a host pointer per host slot, and only
+// enqueues.
+//
+// The buffers of a binding must stay alive as long as the recording.  A
+// replay must complete before the same binding is replayed again, and
+// the host memory must stay valid until then.  Like the Runtime, a
+// recording is not thread-safe.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The types of cl_khr_command_buffer, for headers that predate it.
+#ifndef cl_khr_command_buffer
+typedef struct _cl_command_buffer_khr* cl_command_buffer_khr;
+typedef struct _cl_mutable_command_khr* cl_mutable_command_khr;
+typedef cl_uint cl_sync_point_khr;
+typedef cl_bitfield cl_command_buffer_properties_khr;
+#endif
+
+// The extension's entry points that are used.  The properties of a
+// command changed type between revisions of the extension; only NULL is
+// passed.
+typedef cl_command_buffer_khr (CL_API_CALL* ReplayCreateCommandBuffer)(
+    cl_uint, cl_command_queue const*, cl_command_buffer_properties_khr const*,
+    cl_int*);
+typedef cl_int (CL_API_CALL* ReplayCommandNDRangeKernel)(
+    cl_command_buffer_khr, cl_command_queue, void const*, cl_kernel, cl_uint,
+    size_t const*, size_t const*, size_t const*, cl_uint,
+    cl_sync_point_khr const*, cl_sync_point_khr*, cl_mutable_command_khr*);
+typedef cl_int (CL_API_CALL* ReplayFinalizeCommandBuffer)(cl_command_buffer_khr);
+typedef cl_int (CL_API_CALL* ReplayEnqueueCommandBuffer)(
+    cl_uint, cl_command_queue*, cl_command_buffer_khr, cl_uint, cl_event const*,
+    cl_event*);
+typedef cl_int (CL_API_CALL* ReplayReleaseCommandBuffer)(cl_command_buffer_khr);
+
+#define REPLAY_MAX_COMMANDS 16
+#define REPLAY_MAX_SLOTS 8
+#define REPLAY_MAX_BINDINGS 8
+#define REPLAY_MAX_ARGS 8
+#define REPLAY_MAX_ARG_SIZE 16
+
+typedef enum
+{
+    REPLAY_WRITE,
+    REPLAY_KERNEL,
+    REPLAY_READ
+} ReplayCommandType;
+
+// A kernel argument: the buffer bound to 'slot', or, if slot is
+// REPLAY_VALUE, 'size' bytes at 'value' (which are copied).
+#define REPLAY_VALUE (-1)
+typedef struct
+{
+    int slot;
+    size_t size;
+    void const* value;
+} ReplayArg;
+
+typedef struct
+{
+    ReplayCommandType type;
+    // REPLAY_WRITE and REPLAY_READ
+    int bufferSlot;
+    int hostSlot;
+    size_t size;
+    // REPLAY_KERNEL, with copies of the argument values.
+    cl_kernel kernel;
+    size_t globalSize;
+    cl_uint argCount;
+    int argSlots[REPLAY_MAX_ARGS];
+    size_t argSizes[REPLAY_MAX_ARGS];
+    unsigned char argValues[REPLAY_MAX_ARGS][REPLAY_MAX_ARG_SIZE];
+    // Per binding, the kernel with its arguments set, and (in the first
+    // kernel of a run of kernels) the command buffer that holds the run.
+    cl_kernel bound[REPLAY_MAX_BINDINGS];
+    cl_command_buffer_khr commandBuffers[REPLAY_MAX_BINDINGS];
+    // The number of kernel commands the command buffer holds.
+    int runLength;
+} ReplayCommand;
+
+typedef struct
+{
+    Runtime* runtime;
+    // Whether kernels are replayed from command buffers.
+    int useCommandBuffers;
+    int commandCount;
+    ReplayCommand commands[REPLAY_MAX_COMMANDS];
+    int bindingCount;
+    cl_mem buffers[REPLAY_MAX_BINDINGS][REPLAY_MAX_SLOTS];
+    // The cl_khr_command_buffer entry points.
+    ReplayCreateCommandBuffer createCommandBuffer;
+    ReplayCommandNDRangeKernel commandNDRangeKernel;
+    ReplayFinalizeCommandBuffer finalizeCommandBuffer;
+    ReplayEnqueueCommandBuffer enqueueCommandBuffer;
+    ReplayReleaseCommandBuffer releaseCommandBuffer;
+} Recording;
+
+// Start an empty recording on the runtime's queue.  Command buffers are
+// used if 'allowCommandBuffers' is set and the device supports them.
+cl_int replayCreate(Recording* recording, Runtime* runtime, int allowCommandBuffers);
+void replayRelease(Recording* recording);
+
+// Record commands.  Each returns the command's index, or -1 on failure.
+// Commands can't be recorded once a binding has been made.
+int replayWrite(Recording* recording, int bufferSlot, int hostSlot, size_t size);
+int replayKernel(Recording* recording, cl_kernel kernel, size_t globalSize,
+                 cl_uint argCount, ReplayArg const* args);
+int replayRead(Recording* recording, int bufferSlot, int hostSlot, size_t size);
+
+// Bind a buffer to each buffer slot, and prepare to replay with them.
+// Returns the binding's index, or -1 on failure.
+int replayBind(Recording* recording, cl_mem const* buffers, cl_int* error);
+
+// Enqueue the recorded commands with a binding and a host pointer per
+// host slot, without waiting for them.
+cl_int replayEnqueue(Recording* recording, int binding, void* const* hosts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,221 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Runtime.h"
+
+// This sample measures the per-call overhead of a saxpy (z=a*x+y) done
+// three ways:
+//
+//   one-shot   The Minimal sample's flow for every call: find the
+//              platform and device, create the context and queue, build
+//              the program, allocate buffers, run, and tear it all down.
+//   no pool    A persistent Runtime (context, queue and kernel created
+//              once), but with new buffers allocated for every call.
+//   pooled     A persistent Runtime whose buffers come from its pool, so
+//              that after the first call nothing is allocated and a call
+//              only enqueues work.
+//
+// The problem is small by default, so that the times are dominated by
+// overhead rather than by the computation.
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int compareDoubles(void const* a, void const* b)
+{
+    double const x = *(double const*) a;
+    double const y = *(double const*) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Check that results are correct.  Like the Minimal sample, this depends
+// on the computation being exact.
+static int check(float a, float const* x, float const* y, float const* z,
+                 size_t dimension)
+{
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                   x[i], a, y[i], z[i]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void printTimes(char const* name, double* times, int count)
+{
+    qsort(times, count, sizeof(double), compareDoubles);
+    printf("%-10s %6d calls  median %10.1f us  min %10.1f us  max %10.1f us\n",
+           name, count, times[count / 2] * 1e6, times[0] * 1e6,
+           times[count - 1] * 1e6);
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLRuntime [elements [calls]]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : 1024;
+    int const calls = argc > 2 ? atoi(argv[2]) : 1000;
+    // Creating a context and building a program takes long enough that a
+    // few one-shot calls are plenty.
+    int const oneShotCalls = calls < 10 ? calls : 10;
+    if (0 == dimension || calls < 1)
+    {
+        printf("Usage: %s [elements [calls]]\n", argv[0]);
+        return 1;
+    }
+
+    // Allocate host memory for input and output vectors, and set values
+    // to something easy to verify.
+    float const a = 2.0f;
+    float* x = (float*) malloc(sizeof(float) * dimension);
+    float* y = (float*) malloc(sizeof(float) * dimension);
+    float* z = (float*) malloc(sizeof(float) * dimension);
+    double* times = (double*) malloc(sizeof(double) * calls);
+    if (NULL == x || NULL == y || NULL == z || NULL == times)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+
+    RuntimeOptions options;
+    runtimeDefaultOptions(&options);
+    printf("%zu elements per call\n", dimension);
+
+    // One-shot: everything is created and released on every call.
+    RuntimeOptions oneShotOptions = options;
+    oneShotOptions.maxPooledBytes = 0;
+    for (int c = 0; c < oneShotCalls; ++ c)
+    {
+        memset(z, 0, sizeof(float) * dimension);
+        double const start = now();
+        Runtime runtime;
+        cl_int r = runtimeCreate(&runtime, &oneShotOptions);
+        if (CL_SUCCESS != r)
+            return r;
+        r = runtimeSaxpy(&runtime, a, x, y, z, dimension);
+        runtimeRelease(&runtime);
+        times[c] = now() - start;
+        if (CL_SUCCESS != r)
+        {
+            printf("runtimeSaxpy failed with return code %d\n", r);
+            return r;
+        }
+        if (!check(a, x, y, z, dimension))
+            return 100;
+    }
+    printTimes("one-shot", times, oneShotCalls);
+
+    // A persistent runtime, first without and then with buffer pooling.
+    for (int pooled = 0; pooled < 2; ++ pooled)
+    {
+        RuntimeOptions persistentOptions = options;
+        if (!pooled)
+            persistentOptions.maxPooledBytes = 0;
+        Runtime runtime;
+        double const start = now();
+        cl_int r = runtimeCreate(&runtime, &persistentOptions);
+        if (CL_SUCCESS != r)
+            return r;
+        double const setupTime = now() - start;
+
+        for (int c = 0; c < calls; ++ c)
+        {
+            double const callStart = now();
+            r = runtimeSaxpy(&runtime, a, x, y, z, dimension);
+            times[c] = now() - callStart;
+            if (CL_SUCCESS != r)
+            {
+                printf("runtimeSaxpy failed with return code %d\n", r);
+                return r;
+            }
+        }
+        if (!check(a, x, y, z, dimension))
+            return 100;
+        printTimes(pooled ? "pooled" : "no pool", times, calls);
+        printf("           setup %.1f ms, %zu buffers allocated, %zu reused\n",
+               setupTime * 1e3, runtime.pool.misses, runtime.pool.hits);
+        runtimeRelease(&runtime);
+    }
+
+    // Problems larger than the device allows in one buffer or one launch
+    // are split up; lower the limits to the smallest the runtime takes, so
+    // that a few thousand elements go in 4 chunks of several launches
+    // each, and check that the pieces add up.  A lower limit is rejected.
+    RuntimeOptions chunkedOptions = options;
+    chunkedOptions.maxChunkBytes = ((size_t) 1 << RUNTIME_MIN_SIZE_CLASS) - 1;
+    Runtime rejected;
+    if (CL_INVALID_VALUE != runtimeCreate(&rejected, &chunkedOptions))
+    {
+        printf("A chunk smaller than the smallest buffer was not rejected\n");
+        return 101;
+    }
+    chunkedOptions.maxChunkBytes = (size_t) 1 << RUNTIME_MIN_SIZE_CLASS;
+    chunkedOptions.maxLaunchSize = 100;
+    Runtime runtime;
+    cl_int r = runtimeCreate(&runtime, &chunkedOptions);
+    if (CL_SUCCESS != r)
+        return r;
+    size_t const expectedChunks = 4;
+    size_t const chunkedDimension = (expectedChunks - 1) * runtime.chunkElements + 7;
+    size_t const chunks = (chunkedDimension - 1) / runtime.chunkElements + 1;
+    if (runtime.chunkElements != chunkedOptions.maxChunkBytes / sizeof(cl_float))
+    {
+        printf("Chunks of %zu elements instead of %zu\n", runtime.chunkElements,
+               chunkedOptions.maxChunkBytes / sizeof(cl_float));
+        return 101;
+    }
+    float* chunkedX = (float*) malloc(sizeof(float) * chunkedDimension);
+    float* chunkedY = (float*) malloc(sizeof(float) * chunkedDimension);
+    float* chunkedZ = (float*) malloc(sizeof(float) * chunkedDimension);
+    if (NULL == chunkedX || NULL == chunkedY || NULL == chunkedZ)
+    {
+        printf("Unable to allocate host memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < chunkedDimension; ++ i)
+    {
+        chunkedX[i] = (float) i;
+        chunkedY[i] = 100 - (float) i;
+        chunkedZ[i] = 0;
+    }
+    r = runtimeSaxpy(&runtime, a, chunkedX, chunkedY, chunkedZ, chunkedDimension);
+    if (CL_SUCCESS != r)
+    {
+        printf("Chunked runtimeSaxpy failed with return code %d\n", r);
+        return r;
+    }
+    if (!check(a, chunkedX, chunkedY, chunkedZ, chunkedDimension))
+        return 100;
+    printf("chunked    %zu elements in %zu chunks of up to %zu elements, "
+           "up to %zu launches each\n", chunkedDimension, chunks,
+           runtime.chunkElements,
+           (runtime.chunkElements - 1) / runtime.maxLaunchSize + 1);
+    runtimeRelease(&runtime);
+    free(chunkedX);
+    free(chunkedY);
+    free(chunkedZ);
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(x);
+    free(y);
+    free(z);
+    free(times);
+
+    return 0;
+}
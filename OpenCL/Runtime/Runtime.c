@@ -0,0 +1,422 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Runtime.h"
+
+void runtimeDefaultOptions(RuntimeOptions* options)
+{
+    memset(options, 0, sizeof(*options));
+    options->platformIndex = 0;
+    options->deviceIndex = 0;
+    options->deviceType = CL_DEVICE_TYPE_ALL;
+    options->queueProperties = 0;
+    options->kernelPath = "kernel.cl";
+    options->buildOptions = "";
+    options->maxPooledBytes = (size_t) 1 << 30;
+    options->maxChunkBytes = 0;
+    options->maxLaunchSize = 0;
+}
+
+// Read a whole file into a null-terminated string, or return NULL.
+static char* readFile(char const* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (NULL == file)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* contents = size >= 0 ? (char*) malloc(size + 1) : NULL;
+    if (NULL != contents && size != (long) fread(contents, 1, size, file))
+    {
+        free(contents);
+        contents = NULL;
+    }
+    fclose(file);
+    if (NULL != contents)
+        contents[size] = 0;
+    return contents;
+}
+
+cl_int runtimeCreate(Runtime* runtime, RuntimeOptions const* userOptions)
+{
+    RuntimeOptions options;
+    if (NULL != userOptions)
+        options = *userOptions;
+    else
+        runtimeDefaultOptions(&options);
+
+    memset(runtime, 0, sizeof(*runtime));
+    runtime->pool.maxPooledBytes = options.maxPooledBytes;
+
+    // Buffers are reused, and given back to the pool, without events.
+    if (options.queueProperties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)
+    {
+        printf("The runtime's queue must be in order; create other queues "
+               "for out-of-order execution\n");
+        return CL_INVALID_QUEUE_PROPERTIES;
+    }
+
+    // Get the chosen platform and device.
+    cl_uint const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint platformCount = 0;
+    cl_int r = clGetPlatformIDs(maxPlatformCount, platforms, &platformCount);
+    if (CL_SUCCESS != r)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+    // The count is of all platforms, not just those that fit.
+    if (platformCount > maxPlatformCount)
+        platformCount = maxPlatformCount;
+    if (options.platformIndex >= platformCount)
+    {
+        printf("There is no platform %u\n", options.platformIndex);
+        return CL_INVALID_PLATFORM;
+    }
+    runtime->platform = platforms[options.platformIndex];
+
+    cl_uint const maxDeviceCount = 8;
+    cl_device_id devices[maxDeviceCount];
+    cl_uint deviceCount = 0;
+    r = clGetDeviceIDs(runtime->platform, options.deviceType, maxDeviceCount,
+                       devices, &deviceCount);
+    if (CL_SUCCESS != r)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+    if (deviceCount > maxDeviceCount)
+        deviceCount = maxDeviceCount;
+    if (options.deviceIndex >= deviceCount)
+    {
+        printf("There is no device %u\n", options.deviceIndex);
+        return CL_DEVICE_NOT_FOUND;
+    }
+    runtime->device = devices[options.deviceIndex];
+
+    // Pooled buffers are a power of two in size, so a chunk is the largest
+    // power of two that one allocation allows, and that leaves room for
+    // the three arrays in global memory.  Devices allow at least 128 MB
+    // per allocation, which is assumed if the query fails.
+    if (0 != options.maxChunkBytes
+        && options.maxChunkBytes < (size_t) 1 << RUNTIME_MIN_SIZE_CLASS)
+    {
+        printf("maxChunkBytes must be 0 or at least %zu bytes, not %zu\n",
+               (size_t) 1 << RUNTIME_MIN_SIZE_CLASS, options.maxChunkBytes);
+        return CL_INVALID_VALUE;
+    }
+    cl_ulong maxAlloc = 0;
+    cl_ulong globalMemory = 0;
+    clGetDeviceInfo(runtime->device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(maxAlloc),
+                    &maxAlloc, NULL);
+    clGetDeviceInfo(runtime->device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMemory),
+                    &globalMemory, NULL);
+    if (0 == maxAlloc)
+        maxAlloc = (cl_ulong) 128 << 20;
+    if (0 == globalMemory)
+        globalMemory = 4 * maxAlloc;
+    if (0 != options.maxChunkBytes && options.maxChunkBytes < maxAlloc)
+        maxAlloc = options.maxChunkBytes;
+    size_t chunkBytes = (size_t) 1 << RUNTIME_MIN_SIZE_CLASS;
+    while (chunkBytes <= (((size_t) -1) >> 1)
+           && 2 * (cl_ulong) chunkBytes <= maxAlloc
+           && 3 * 2 * (cl_ulong) chunkBytes <= globalMemory)
+    {
+        chunkBytes *= 2;
+    }
+    runtime->chunkElements = chunkBytes / sizeof(cl_float);
+
+    // Global sizes are size_t on the device too, which may be 32 bits, and
+    // some drivers take no more than 2^32 work-items per launch even when
+    // it isn't.
+    // TODO: Raise the limit if your driver takes larger launches.
+    runtime->maxLaunchSize = (size_t) 1 << 31;
+    if (0 != options.maxLaunchSize && options.maxLaunchSize < runtime->maxLaunchSize)
+        runtime->maxLaunchSize = options.maxLaunchSize;
+
+    runtime->context = clCreateContext(0, 1, &runtime->device, NULL, NULL, &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return code %d\n", r);
+        runtimeRelease(runtime);
+        return r;
+    }
+
+    runtime->queue = clCreateCommandQueue(runtime->context, runtime->device,
+                                          options.queueProperties, &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateCommandQueue failed with return code %d\n", r);
+        runtimeRelease(runtime);
+        return r;
+    }
+
+    // Read the kernel source and build it.
+    char* source = readFile(options.kernelPath);
+    if (NULL == source)
+    {
+        printf("Unable to read kernel source file %s\n", options.kernelPath);
+        runtimeRelease(runtime);
+        return CL_INVALID_VALUE;
+    }
+    char const* sourceLines[1] = {source};
+    runtime->program = clCreateProgramWithSource(runtime->context, 1,
+                                                 sourceLines, NULL, &r);
+    free(source);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateProgramWithSource failed with return code %d\n", r);
+        runtimeRelease(runtime);
+        return r;
+    }
+
+    r = clBuildProgram(runtime->program, 1, &runtime->device,
+                       options.buildOptions, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clBuildProgram failed with return value %d; error log:\n", r);
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(runtime->program, runtime->device,
+                                            CL_PROGRAM_BUILD_LOG,
+                                            sizeof(buildLog), buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            printf("%s\n", buildLog);
+        }
+        runtimeRelease(runtime);
+        return r;
+    }
+    return CL_SUCCESS;
+}
+
+void runtimeRelease(Runtime* runtime)
+{
+    for (int c = 0; c < RUNTIME_SIZE_CLASSES; ++ c)
+    {
+        RuntimeFreeList* list = &runtime->pool.freeLists[c];
+        for (size_t b = 0; b < list->count; ++ b)
+        {
+            clReleaseMemObject(list->buffers[b]);
+        }
+        free(list->buffers);
+    }
+    for (unsigned k = 0; k < runtime->kernelCount; ++ k)
+    {
+        clReleaseKernel(runtime->kernels[k]);
+    }
+    if (runtime->program)
+        clReleaseProgram(runtime->program);
+    if (runtime->queue)
+        clReleaseCommandQueue(runtime->queue);
+    if (runtime->context)
+        clReleaseContext(runtime->context);
+    memset(runtime, 0, sizeof(*runtime));
+}
+
+cl_kernel runtimeKernel(Runtime* runtime, char const* name, cl_int* error)
+{
+    for (unsigned k = 0; k < runtime->kernelCount; ++ k)
+    {
+        if (0 == strcmp(runtime->kernelNames[k], name))
+        {
+            *error = CL_SUCCESS;
+            return runtime->kernels[k];
+        }
+    }
+    if (runtime->kernelCount == RUNTIME_MAX_KERNELS)
+    {
+        printf("Too many kernels; increase RUNTIME_MAX_KERNELS\n");
+        *error = CL_OUT_OF_HOST_MEMORY;
+        return 0;
+    }
+    cl_kernel kernel = clCreateKernel(runtime->program, name, error);
+    if (CL_SUCCESS != *error)
+    {
+        printf("clCreateKernel failed for %s with code %d\n", name, *error);
+        return 0;
+    }
+    runtime->kernelNames[runtime->kernelCount] = name;
+    runtime->kernels[runtime->kernelCount++] = kernel;
+    return kernel;
+}
+
+// The size class of a buffer of 'size' bytes: the smallest c such that
+// size <= 2^c, but at least RUNTIME_MIN_SIZE_CLASS.
+static int sizeClass(size_t size)
+{
+    int c = RUNTIME_MIN_SIZE_CLASS;
+    while (c < RUNTIME_SIZE_CLASSES && ((size_t) 1 << c) < size)
+        ++ c;
+    return c;
+}
+
+cl_mem runtimeAcquireBuffer(Runtime* runtime, size_t size, cl_int* error)
+{
+    int const c = sizeClass(size);
+    if (c >= RUNTIME_SIZE_CLASSES)
+    {
+        *error = CL_INVALID_BUFFER_SIZE;
+        return 0;
+    }
+    RuntimePool* pool = &runtime->pool;
+    RuntimeFreeList* list = &pool->freeLists[c];
+    if (list->count > 0)
+    {
+        ++ pool->hits;
+        pool->pooledBytes -= (size_t) 1 << c;
+        *error = CL_SUCCESS;
+        return list->buffers[--list->count];
+    }
+
+    // All buffers are read-write, so that any buffer can be reused for
+    // any argument.
+    ++ pool->misses;
+    return clCreateBuffer(runtime->context, CL_MEM_READ_WRITE,
+                          (size_t) 1 << c, NULL, error);
+}
+
+void runtimeReleaseBuffer(Runtime* runtime, cl_mem buffer)
+{
+    if (0 == buffer)
+        return;
+    size_t size = 0;
+    clGetMemObjectInfo(buffer, CL_MEM_SIZE, sizeof(size), &size, NULL);
+    int const c = sizeClass(size);
+    RuntimePool* pool = &runtime->pool;
+    RuntimeFreeList* list = &pool->freeLists[c];
+
+    // Keep the buffer if it fits under the limit and is one of ours (its
+    // size is exactly a size class).
+    if (size == ((size_t) 1 << c) && pool->pooledBytes + size <= pool->maxPooledBytes)
+    {
+        if (list->count == list->capacity)
+        {
+            size_t const capacity = list->capacity ? 2 * list->capacity : 4;
+            cl_mem* buffers = (cl_mem*) realloc(list->buffers,
+                                                capacity * sizeof(cl_mem));
+            if (NULL != buffers)
+            {
+                list->buffers = buffers;
+                list->capacity = capacity;
+            }
+        }
+        if (list->count < list->capacity)
+        {
+            list->buffers[list->count++] = buffer;
+            pool->pooledBytes += size;
+            return;
+        }
+    }
+    clReleaseMemObject(buffer);
+}
+
+cl_int runtimeEnqueueSaxpy(Runtime* runtime, float a, cl_mem x, cl_mem y,
+                           cl_mem z, size_t count, cl_uint waitCount,
+                           cl_event const* waitList, cl_event* event)
+{
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = runtimeKernel(runtime, "saxpy", &r);
+    if (CL_SUCCESS != r)
+        return r;
+    cl_ulong const elements = count;
+    r = clSetKernelArg(kernel, 0, sizeof(cl_mem), &x);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 1, sizeof(cl_mem), &y);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 2, sizeof(cl_mem), &z);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+    if (CL_SUCCESS == r)
+        r = clSetKernelArg(kernel, 4, sizeof(cl_ulong), &elements);
+    if (CL_SUCCESS != r)
+        return r;
+    if (count <= runtime->maxLaunchSize)
+        return clEnqueueNDRangeKernel(runtime->queue, kernel, 1, NULL, &count,
+                                      NULL, waitCount, waitList, event);
+
+    // Several launches, with the global offset moving along the buffers;
+    // the kernel's index includes the offset.  The event is a marker that
+    // waits for all of them.
+    size_t const launches = (count - 1) / runtime->maxLaunchSize + 1;
+    cl_event* events = NULL;
+    if (NULL != event)
+    {
+        events = (cl_event*) malloc(launches * sizeof(cl_event));
+        if (NULL == events)
+            return CL_OUT_OF_HOST_MEMORY;
+    }
+    size_t launched = 0;
+    for (size_t offset = 0; offset < count && CL_SUCCESS == r;
+         offset += runtime->maxLaunchSize)
+    {
+        size_t const remaining = count - offset;
+        size_t const global = remaining < runtime->maxLaunchSize
+                              ? remaining : runtime->maxLaunchSize;
+        r = clEnqueueNDRangeKernel(runtime->queue, kernel, 1, &offset, &global,
+                                   NULL, waitCount, waitList,
+                                   events ? &events[launched] : NULL);
+        if (CL_SUCCESS == r)
+            ++ launched;
+    }
+    if (CL_SUCCESS == r && NULL != event)
+        r = clEnqueueMarkerWithWaitList(runtime->queue, (cl_uint) launched, events,
+                                        event);
+    for (size_t e = 0; events && e < launched; ++ e)
+    {
+        clReleaseEvent(events[e]);
+    }
+    free(events);
+    return r;
+}
+
+cl_int runtimeSaxpy(Runtime* runtime, float a, float const* x,
+                    float const* y, float* z, size_t count)
+{
+    if (0 == count)
+        return CL_SUCCESS;
+    size_t const chunk = count < runtime->chunkElements ? count : runtime->chunkElements;
+    size_t const size = chunk * sizeof(cl_float);
+    cl_int r = CL_SUCCESS;
+    cl_mem devX = runtimeAcquireBuffer(runtime, size, &r);
+    cl_mem devY = 0;
+    cl_mem devZ = 0;
+    if (CL_SUCCESS == r)
+        devY = runtimeAcquireBuffer(runtime, size, &r);
+    if (CL_SUCCESS == r)
+        devZ = runtimeAcquireBuffer(runtime, size, &r);
+
+    // Nothing blocks: the queue is in order, so each chunk's writes wait
+    // for the previous chunk's read, and the clFinish at the end means
+    // everything has completed before this returns.
+    // TODO: The Streaming sample shows how to overlap the transfers of
+    // one chunk with the kernel of another.
+    for (size_t offset = 0; offset < count && CL_SUCCESS == r; offset += chunk)
+    {
+        size_t const remaining = count - offset;
+        size_t const elements = remaining < chunk ? remaining : chunk;
+        size_t const bytes = elements * sizeof(cl_float);
+        r = clEnqueueWriteBuffer(runtime->queue, devX, CL_FALSE, 0, bytes, x + offset,
+                                 0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clEnqueueWriteBuffer(runtime->queue, devY, CL_FALSE, 0, bytes,
+                                     y + offset, 0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = runtimeEnqueueSaxpy(runtime, a, devX, devY, devZ, elements,
+                                    0, NULL, NULL);
+        if (CL_SUCCESS == r)
+            r = clEnqueueReadBuffer(runtime->queue, devZ, CL_FALSE, 0, bytes,
+                                    z + offset, 0, NULL, NULL);
+    }
+    cl_int const finished = clFinish(runtime->queue);
+    if (CL_SUCCESS == r)
+        r = finished;
+
+    runtimeReleaseBuffer(runtime, devX);
+    runtimeReleaseBuffer(runtime, devY);
+    runtimeReleaseBuffer(runtime, devZ);
+    return r;
+}
@@ -0,0 +1,133 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include <stddef.h>
+#include <CL/opencl.h>
+
+// A small runtime library with the same flow as the Minimal sample, but
+// split so that the expensive parts happen once.  runtimeCreate picks the
+// platform and device, creates the context and queue, and builds the
+// program; after that, runtimeSaxpy only takes buffers from a pool and
+// enqueues work.  Buffers are pooled in power-of-two size classes, so
+// once the pool has warmed up a call makes no driver allocations.
+//
+// A Runtime is not thread-safe: the kernel arguments and the pool are
+// shared by every call.  Use one Runtime per thread, or lock around
+// calls.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Buffers are at least 2^RUNTIME_MIN_SIZE_CLASS bytes.
+#define RUNTIME_MIN_SIZE_CLASS 12
+#define RUNTIME_SIZE_CLASSES 52
+#define RUNTIME_MAX_KERNELS 16
+
+typedef struct
+{
+    // TODO: Choose the platform and device that suit your needs.
+    unsigned platformIndex;
+    unsigned deviceIndex;
+    cl_device_type deviceType;
+    // The queue must be in order: runtimeSaxpy and the pool reuse buffers
+    // without events, so runtimeCreate rejects
+    // CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE.  Profiling is fine.
+    cl_command_queue_properties queueProperties;
+    // The kernel source file, and the options it is built with.
+    char const* kernelPath;
+    char const* buildOptions;
+    // Buffers given back to the pool beyond this many bytes are released
+    // instead of kept; 0 disables pooling.
+    size_t maxPooledBytes;
+    // Limits for splitting large problems, below those of the device; 0
+    // keeps the device's.  runtimeSaxpy moves at most maxChunkBytes of
+    // each array through the device at a time, and runtimeEnqueueSaxpy
+    // launches at most maxLaunchSize work-items at a time.  Chunks are
+    // whole pooled buffers, so maxChunkBytes is rounded down to a power of
+    // two, and runtimeCreate rejects less than 2^RUNTIME_MIN_SIZE_CLASS.
+    size_t maxChunkBytes;
+    size_t maxLaunchSize;
+} RuntimeOptions;
+
+// The free buffers of one size class.
+typedef struct
+{
+    cl_mem* buffers;
+    size_t count;
+    size_t capacity;
+} RuntimeFreeList;
+
+typedef struct
+{
+    RuntimeFreeList freeLists[RUNTIME_SIZE_CLASSES];
+    size_t maxPooledBytes;
+    size_t pooledBytes;
+    // Statistics: buffers handed out from the pool, and buffers that had
+    // to be created.
+    size_t hits;
+    size_t misses;
+} RuntimePool;
+
+typedef struct
+{
+    cl_platform_id platform;
+    cl_device_id device;
+    cl_context context;
+    cl_command_queue queue;
+    cl_program program;
+    // Kernels created so far, by name.
+    unsigned kernelCount;
+    char const* kernelNames[RUNTIME_MAX_KERNELS];
+    cl_kernel kernels[RUNTIME_MAX_KERNELS];
+    RuntimePool pool;
+    // The elements of each array that runtimeSaxpy moves through the
+    // device at a time, and the work-items per launch.
+    size_t chunkElements;
+    size_t maxLaunchSize;
+} Runtime;
+
+// Fill in the defaults: first platform, first device of any type, an
+// in-order queue, "kernel.cl" with no build options, up to 1 GB of
+// pooled buffers, and the device's limits for splitting large problems.
+void runtimeDefaultOptions(RuntimeOptions* options);
+
+// Set up a runtime.  On failure, everything created so far is released
+// and the OpenCL error code is returned.
+cl_int runtimeCreate(Runtime* runtime, RuntimeOptions const* options);
+
+// Release the pooled buffers and every OpenCL object of the runtime.
+void runtimeRelease(Runtime* runtime);
+
+// Return the kernel with the given name, creating it on first use.  The
+// name must stay valid for the lifetime of the runtime.
+cl_kernel runtimeKernel(Runtime* runtime, char const* name, cl_int* error);
+
+// Take a read-write buffer of at least 'size' bytes from the pool,
+// creating one if the pool has none of that size class.
+cl_mem runtimeAcquireBuffer(Runtime* runtime, size_t size, cl_int* error);
+
+// Give a buffer back to the pool.  Commands already enqueued on the
+// runtime's queue that use it may still be running; that is safe as long
+// as the next user of the buffer enqueues on the same in-order queue.
+void runtimeReleaseBuffer(Runtime* runtime, cl_mem buffer);
+
+// Enqueue z = a*x + y over 'count' elements of device buffers, without
+// waiting for it.  More than maxLaunchSize elements take several
+// launches; the event, if asked for, completes when all of them have.
+cl_int runtimeEnqueueSaxpy(Runtime* runtime, float a, cl_mem x, cl_mem y,
+                           cl_mem z, size_t count, cl_uint waitCount,
+                           cl_event const* waitList, cl_event* event);
+
+// Compute z = a*x + y over 'count' elements of host arrays, using pooled
+// device buffers, and wait for the result.  Arrays larger than a single
+// allocation can hold go through the same buffers in chunks, one after
+// another.
+cl_int runtimeSaxpy(Runtime* runtime, float a, float const* x,
+                    float const* y, float* z, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
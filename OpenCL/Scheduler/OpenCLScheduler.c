@@ -0,0 +1,224 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Runtime.h"
+#include "Scheduler.h"
+
+// This sample runs several independent saxpy (z=a*x+y) pipelines, each
+// of which writes x and y, runs the kernel and reads z, and measures the
+// latency from submission to completion of all of them.
+//
+// On the in-order queue the other samples use (created with properties
+// 0), the writes, kernels and reads of all the pipelines are serialized,
+// even though only the commands within a pipeline depend on each other.
+// The scheduler in Scheduler.c builds the dependency graph from the
+// buffers each command reads and writes, and submits it with explicit
+// event wait lists, either to an out-of-order queue (if the device
+// supports one) or to several in-order queues, so that the device can
+// overlap transfers with each other and with kernels.
+
+#define MAX_QUEUES 4
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int compareDoubles(void const* a, void const* b)
+{
+    double const x = *(double const*) a;
+    double const y = *(double const*) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLScheduler [elements [pipelines [repeats]]]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) 1 << 20;
+    int const pipelines = argc > 2 ? atoi(argv[2]) : 4;
+    int const repeats = argc > 3 ? atoi(argv[3]) : 20;
+    if (0 == dimension || pipelines < 1 || repeats < 1)
+    {
+        printf("Usage: %s [elements [pipelines [repeats]]]\n", argv[0]);
+        return 1;
+    }
+
+    RuntimeOptions options;
+    runtimeDefaultOptions(&options);
+    options.kernelPath = "../Runtime/kernel.cl";
+    Runtime runtime;
+    cl_int r = runtimeCreate(&runtime, &options);
+    if (CL_SUCCESS != r)
+        return r;
+    cl_kernel kernel = runtimeKernel(&runtime, "saxpy", &r);
+    if (CL_SUCCESS != r)
+        return r;
+
+    // The runtime's own queue is in order.  Add an out-of-order queue if
+    // the device supports one, and more in-order queues.
+    cl_command_queue_properties supported = 0;
+    clGetDeviceInfo(runtime.device, CL_DEVICE_QUEUE_PROPERTIES,
+                    sizeof(supported), &supported, NULL);
+    cl_command_queue outOfOrderQueue = 0;
+    if (supported & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)
+    {
+        outOfOrderQueue = clCreateCommandQueue(runtime.context, runtime.device,
+                                               CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE, &r);
+        if (CL_SUCCESS != r)
+            outOfOrderQueue = 0;
+    }
+    if (0 == outOfOrderQueue)
+        printf("The device doesn't support out-of-order queues\n");
+    cl_command_queue inOrderQueues[MAX_QUEUES] = {runtime.queue};
+    for (int q = 1; q < MAX_QUEUES; ++ q)
+    {
+        inOrderQueues[q] = clCreateCommandQueue(runtime.context, runtime.device, 0, &r);
+        if (CL_SUCCESS != r)
+        {
+            printf("clCreateCommandQueue failed with return code %d\n", r);
+            return r;
+        }
+    }
+
+    // Host and device memory for every pipeline.  Every pipeline gets the
+    // same inputs, set to something easy to verify.
+    float const a = 2.0f;
+    size_t const size = dimension * sizeof(cl_float);
+    float* x = (float*) malloc(size);
+    float* y = (float*) malloc(size);
+    float* z = (float*) malloc(size * pipelines);
+    cl_mem* buffers = (cl_mem*) calloc(3 * pipelines, sizeof(cl_mem));
+    double* times = (double*) malloc(sizeof(double) * repeats);
+    if (NULL == x || NULL == y || NULL == z || NULL == buffers || NULL == times)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+    for (int b = 0; b < 3 * pipelines && CL_SUCCESS == r; ++ b)
+    {
+        buffers[b] = runtimeAcquireBuffer(&runtime, size, &r);
+    }
+    if (CL_SUCCESS != r)
+    {
+        printf("Unable to allocate device memory, return code %d\n", r);
+        return r;
+    }
+
+    // Build the graph once; it is submitted once per repeat.
+    TaskGraph graph;
+    graphInit(&graph);
+    cl_ulong const count = dimension;
+    for (int p = 0; p < pipelines; ++ p)
+    {
+        cl_mem* const devXYZ = &buffers[3 * p];
+        TaskArg const args[5] =
+        {
+            {TASK_ARG_IN, sizeof(cl_mem), &devXYZ[0]},
+            {TASK_ARG_IN, sizeof(cl_mem), &devXYZ[1]},
+            {TASK_ARG_OUT, sizeof(cl_mem), &devXYZ[2]},
+            {TASK_ARG_VALUE, sizeof(cl_float), &a},
+            {TASK_ARG_VALUE, sizeof(cl_ulong), &count}
+        };
+        if (graphWrite(&graph, devXYZ[0], x, size) < 0
+            || graphWrite(&graph, devXYZ[1], y, size) < 0
+            || graphKernel(&graph, kernel, dimension, 5, args) < 0
+            || graphRead(&graph, devXYZ[2], z + p * dimension, size) < 0)
+        {
+            printf("Unable to build the task graph\n");
+            return 1;
+        }
+    }
+    printf("%d pipelines of %zu elements, %d tasks\n",
+           pipelines, dimension, graph.taskCount);
+
+    struct
+    {
+        char const* name;
+        cl_command_queue const* queues;
+        unsigned queueCount;
+    } const modes[3] =
+    {
+        {"in-order queue", inOrderQueues, 1},
+        {"out-of-order queue", &outOfOrderQueue, 1},
+        {"in-order queues", inOrderQueues, MAX_QUEUES}
+    };
+    double baseline = 0.0;
+    for (int m = 0; m < 3; ++ m)
+    {
+        if (0 == modes[m].queues[0])
+            continue;
+        for (int t = 0; t < repeats; ++ t)
+        {
+            memset(z, 0, size * pipelines);
+            double const start = now();
+            r = graphSubmit(&graph, modes[m].queues, modes[m].queueCount);
+            if (CL_SUCCESS == r)
+                r = graphWait(&graph);
+            times[t] = now() - start;
+            if (CL_SUCCESS != r)
+            {
+                printf("Running the graph on the %s failed with code %d\n",
+                       modes[m].name, r);
+                return r;
+            }
+        }
+        qsort(times, repeats, sizeof(double), compareDoubles);
+        double const median = times[repeats / 2];
+        if (0 == m)
+            baseline = median;
+        printf("%u %-19s median %9.3f ms  min %9.3f ms  %.2fx\n",
+               modes[m].queueCount, modes[m].name, median * 1e3, times[0] * 1e3,
+               median > 0 ? baseline / median : 0.0);
+
+        // Check that results are correct.  Note that the code below
+        // depends on the computation being exact.
+        for (int p = 0; p < pipelines; ++ p)
+        {
+            float const* zp = z + p * dimension;
+            for (size_t i = 0; i < dimension; ++ i)
+            {
+                if (x[i]*a + y[i] != zp[i])
+                {
+                    printf("Unexpected result in pipeline %d at element %zu:\n", p, i);
+                    printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                           x[i], a, y[i], zp[i]);
+                    return 100;
+                }
+            }
+        }
+    }
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    graphRelease(&graph);
+    for (int b = 0; b < 3 * pipelines; ++ b)
+    {
+        runtimeReleaseBuffer(&runtime, buffers[b]);
+    }
+    free(buffers);
+    free(x);
+    free(y);
+    free(z);
+    free(times);
+
+    // Release the queues created here, and then the runtime.
+    if (outOfOrderQueue)
+        clReleaseCommandQueue(outOfOrderQueue);
+    for (int q = 1; q < MAX_QUEUES; ++ q)
+    {
+        clReleaseCommandQueue(inOrderQueues[q]);
+    }
+    runtimeRelease(&runtime);
+
+    return 0;
+}
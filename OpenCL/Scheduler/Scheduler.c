@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Scheduler.h"
+
+void graphInit(TaskGraph* graph)
+{
+    memset(graph, 0, sizeof(*graph));
+}
+
+static void releaseEvents(TaskGraph* graph)
+{
+    for (int t = 0; t < graph->taskCount; ++ t)
+    {
+        if (graph->tasks[t].event)
+        {
+            clReleaseEvent(graph->tasks[t].event);
+            graph->tasks[t].event = 0;
+        }
+    }
+}
+
+void graphRelease(TaskGraph* graph)
+{
+    releaseEvents(graph);
+    free(graph->tasks);
+    free(graph->buffers);
+    memset(graph, 0, sizeof(*graph));
+}
+
+// Append an empty task, or return NULL.
+static Task* addTask(TaskGraph* graph, TaskType type)
+{
+    if (graph->taskCount == graph->taskCapacity)
+    {
+        int const capacity = graph->taskCapacity ? 2 * graph->taskCapacity : 16;
+        Task* tasks = (Task*) realloc(graph->tasks, capacity * sizeof(Task));
+        if (NULL == tasks)
+            return NULL;
+        graph->tasks = tasks;
+        graph->taskCapacity = capacity;
+    }
+    Task* task = &graph->tasks[graph->taskCount];
+    memset(task, 0, sizeof(*task));
+    task->type = type;
+    return task;
+}
+
+// Return the access state of a buffer, adding it if it is new.
+static BufferState* bufferState(TaskGraph* graph, cl_mem buffer)
+{
+    for (int b = 0; b < graph->bufferCount; ++ b)
+    {
+        if (graph->buffers[b].buffer == buffer)
+            return &graph->buffers[b];
+    }
+    if (graph->bufferCount == graph->bufferCapacity)
+    {
+        int const capacity = graph->bufferCapacity ? 2 * graph->bufferCapacity : 16;
+        BufferState* buffers = (BufferState*) realloc(graph->buffers,
+                                                      capacity * sizeof(BufferState));
+        if (NULL == buffers)
+            return NULL;
+        graph->buffers = buffers;
+        graph->bufferCapacity = capacity;
+    }
+    BufferState* state = &graph->buffers[graph->bufferCount++];
+    memset(state, 0, sizeof(*state));
+    state->buffer = buffer;
+    state->lastWriter = -1;
+    return state;
+}
+
+static int addDependency(Task* task, int dependency)
+{
+    if (dependency < 0)
+        return 1;
+    for (int d = 0; d < task->dependencyCount; ++ d)
+    {
+        if (task->dependencies[d] == dependency)
+            return 1;
+    }
+    if (task->dependencyCount == TASK_MAX_DEPENDENCIES)
+    {
+        printf("A task depends on more than %d others\n", TASK_MAX_DEPENDENCIES);
+        return 0;
+    }
+    task->dependencies[task->dependencyCount++] = dependency;
+    return 1;
+}
+
+// Add the dependencies of the task being added (at index
+// graph->taskCount) that follow from it reading and/or writing a buffer.
+static int access(TaskGraph* graph, Task* task, cl_mem buffer, int reads, int writes)
+{
+    BufferState* state = bufferState(graph, buffer);
+    if (NULL == state)
+        return 0;
+    int const index = graph->taskCount;
+
+    // Read after write, and write after write.
+    if (!addDependency(task, state->lastWriter))
+        return 0;
+    // Write after read.  A reader that finds the list of readers full
+    // waits for them too, and then stands in for them (see commitAccess).
+    if (writes || (reads && TASK_MAX_READERS == state->readerCount))
+    {
+        for (int r = 0; r < state->readerCount; ++ r)
+        {
+            if (state->readers[r] != index && !addDependency(task, state->readers[r]))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+// Update the buffer's state once all of a task's accesses are known, so
+// that a kernel that reads and writes the same buffer doesn't depend on
+// itself.
+static void commitAccess(TaskGraph* graph, cl_mem buffer, int reads, int writes)
+{
+    BufferState* state = bufferState(graph, buffer);
+    int const index = graph->taskCount;
+    for (int r = 0; r < state->readerCount && !writes; ++ r)
+    {
+        // The buffer is passed to the kernel more than once.
+        if (state->readers[r] == index)
+            return;
+    }
+    if (writes || (reads && TASK_MAX_READERS == state->readerCount))
+    {
+        // A reader that waited for all earlier readers is ordered after
+        // them, so later writers only need to wait for it.
+        state->lastWriter = index;
+        state->readerCount = 0;
+    }
+    else if (reads)
+    {
+        state->readers[state->readerCount++] = index;
+    }
+}
+
+int graphWrite(TaskGraph* graph, cl_mem buffer, void const* source, size_t size)
+{
+    Task* task = addTask(graph, TASK_WRITE);
+    if (NULL == task || !access(graph, task, buffer, 0, 1))
+        return -1;
+    task->buffer = buffer;
+    task->host = (void*) source;
+    task->size = size;
+    commitAccess(graph, buffer, 0, 1);
+    return graph->taskCount++;
+}
+
+int graphRead(TaskGraph* graph, cl_mem buffer, void* destination, size_t size)
+{
+    Task* task = addTask(graph, TASK_READ);
+    if (NULL == task || !access(graph, task, buffer, 1, 0))
+        return -1;
+    task->buffer = buffer;
+    task->host = destination;
+    task->size = size;
+    commitAccess(graph, buffer, 1, 0);
+    return graph->taskCount++;
+}
+
+int graphKernel(TaskGraph* graph, cl_kernel kernel, size_t globalSize,
+                cl_uint argCount, TaskArg const* args)
+{
+    if (argCount > TASK_MAX_ARGS)
+    {
+        printf("A kernel task has more than %d arguments\n", TASK_MAX_ARGS);
+        return -1;
+    }
+    Task* task = addTask(graph, TASK_KERNEL);
+    if (NULL == task)
+        return -1;
+    for (cl_uint a = 0; a < argCount; ++ a)
+    {
+        if (args[a].size > TASK_MAX_ARG_SIZE)
+        {
+            printf("Kernel argument %u is larger than %d bytes\n", a, TASK_MAX_ARG_SIZE);
+            return -1;
+        }
+        if (TASK_ARG_VALUE != args[a].access
+            && !access(graph, task, *(cl_mem const*) args[a].value,
+                       TASK_ARG_OUT != args[a].access, TASK_ARG_IN != args[a].access))
+        {
+            return -1;
+        }
+        task->argSizes[a] = args[a].size;
+        memcpy(task->argValues[a], args[a].value, args[a].size);
+    }
+    for (cl_uint a = 0; a < argCount; ++ a)
+    {
+        if (TASK_ARG_VALUE != args[a].access)
+            commitAccess(graph, *(cl_mem const*) args[a].value,
+                         TASK_ARG_OUT != args[a].access, TASK_ARG_IN != args[a].access);
+    }
+    task->kernel = kernel;
+    task->globalSize = globalSize;
+    task->argCount = argCount;
+    return graph->taskCount++;
+}
+
+cl_int graphSubmit(TaskGraph* graph, cl_command_queue const* queues,
+                   unsigned queueCount)
+{
+    releaseEvents(graph);
+    if (0 == queueCount)
+        return CL_INVALID_VALUE;
+    unsigned nextQueue = 0;
+    cl_int r = CL_SUCCESS;
+    for (int t = 0; t < graph->taskCount && CL_SUCCESS == r; ++ t)
+    {
+        Task* task = &graph->tasks[t];
+        cl_event waitList[TASK_MAX_DEPENDENCIES];
+        for (int d = 0; d < task->dependencyCount; ++ d)
+        {
+            waitList[d] = graph->tasks[task->dependencies[d]].event;
+        }
+        if (task->dependencyCount > 0)
+        {
+            task->queue = graph->tasks[task->dependencies[0]].queue;
+        }
+        else
+        {
+            task->queue = nextQueue;
+            nextQueue = (nextQueue + 1) % queueCount;
+        }
+        cl_command_queue queue = queues[task->queue];
+        cl_uint const waitCount = (cl_uint) task->dependencyCount;
+
+        switch (task->type)
+        {
+        case TASK_WRITE:
+            r = clEnqueueWriteBuffer(queue, task->buffer, CL_FALSE, 0, task->size,
+                                     task->host, waitCount,
+                                     waitCount ? waitList : NULL, &task->event);
+            break;
+        case TASK_READ:
+            r = clEnqueueReadBuffer(queue, task->buffer, CL_FALSE, 0, task->size,
+                                    task->host, waitCount,
+                                    waitCount ? waitList : NULL, &task->event);
+            break;
+        case TASK_KERNEL:
+            // Enqueueing captures the argument values, so tasks can share
+            // a kernel object.
+            for (cl_uint a = 0; a < task->argCount && CL_SUCCESS == r; ++ a)
+            {
+                r = clSetKernelArg(task->kernel, a, task->argSizes[a],
+                                   task->argValues[a]);
+            }
+            if (CL_SUCCESS == r)
+                r = clEnqueueNDRangeKernel(queue, task->kernel, 1, NULL,
+                                           &task->globalSize, NULL, waitCount,
+                                           waitCount ? waitList : NULL, &task->event);
+            break;
+        }
+        if (CL_SUCCESS != r)
+            printf("Enqueueing task %d failed with return code %d\n", t, r);
+    }
+
+    // Submit the work on every queue, since tasks on one queue may be
+    // waiting for events on another.
+    for (unsigned q = 0; q < queueCount; ++ q)
+    {
+        clFlush(queues[q]);
+    }
+    return r;
+}
+
+cl_int graphWait(TaskGraph* graph)
+{
+    cl_int result = CL_SUCCESS;
+    for (int t = 0; t < graph->taskCount; ++ t)
+    {
+        if (graph->tasks[t].event)
+        {
+            cl_int const r = clWaitForEvents(1, &graph->tasks[t].event);
+            if (CL_SUCCESS != r && CL_SUCCESS == result)
+                result = r;
+        }
+    }
+    return result;
+}
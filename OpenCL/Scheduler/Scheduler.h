@@ -0,0 +1,123 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stddef.h>
+#include <CL/opencl.h>
+
+// A scheduler that builds a dependency graph of buffer writes, kernels
+// and buffer reads, and submits it with explicit event wait lists so that
+// independent commands can overlap on the device.
+//
+// Tasks are added in program order, together with the buffers they read
+// and write.  The dependencies follow from those accesses: a task that
+// reads a buffer waits for its last writer, and a task that writes a
+// buffer waits for its last writer and for every reader since.  Nothing
+// else is ordered, so the graph can be submitted to an out-of-order queue
+// or spread over several in-order queues.  A graph can be submitted any
+// number of times.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TASK_MAX_ARGS 8
+#define TASK_MAX_ARG_SIZE 16
+// The most tasks one task can wait for, and the most readers of a buffer
+// that are tracked separately.
+#define TASK_MAX_DEPENDENCIES 16
+#define TASK_MAX_READERS 8
+
+typedef enum
+{
+    TASK_WRITE,
+    TASK_READ,
+    TASK_KERNEL
+} TaskType;
+
+// How a kernel argument is used: a plain value, or a buffer (whose
+// cl_mem 'value' points to) that the kernel reads, writes or both.
+typedef enum
+{
+    TASK_ARG_VALUE,
+    TASK_ARG_IN,
+    TASK_ARG_OUT,
+    TASK_ARG_INOUT
+} TaskArgAccess;
+
+typedef struct
+{
+    TaskArgAccess access;
+    size_t size;
+    void const* value;
+} TaskArg;
+
+typedef struct
+{
+    TaskType type;
+    // TASK_WRITE and TASK_READ
+    cl_mem buffer;
+    void* host;
+    size_t size;
+    // TASK_KERNEL, with copies of the argument values.
+    cl_kernel kernel;
+    size_t globalSize;
+    cl_uint argCount;
+    size_t argSizes[TASK_MAX_ARGS];
+    unsigned char argValues[TASK_MAX_ARGS][TASK_MAX_ARG_SIZE];
+    // Indices of the tasks this one waits for.
+    int dependencyCount;
+    int dependencies[TASK_MAX_DEPENDENCIES];
+    // The queue the task was last submitted to, and its event.
+    unsigned queue;
+    cl_event event;
+} Task;
+
+// The accesses to one buffer since it was last written.
+typedef struct
+{
+    cl_mem buffer;
+    int lastWriter;
+    int readerCount;
+    int readers[TASK_MAX_READERS];
+} BufferState;
+
+typedef struct
+{
+    Task* tasks;
+    int taskCount;
+    int taskCapacity;
+    BufferState* buffers;
+    int bufferCount;
+    int bufferCapacity;
+} TaskGraph;
+
+void graphInit(TaskGraph* graph);
+// Free the graph, releasing the events of its last submission.
+void graphRelease(TaskGraph* graph);
+
+// Add a task that copies 'size' bytes from host memory into a buffer.
+// Returns the task's index, or -1 on failure.
+int graphWrite(TaskGraph* graph, cl_mem buffer, void const* source, size_t size);
+// Add a task that copies 'size' bytes from a buffer into host memory.
+int graphRead(TaskGraph* graph, cl_mem buffer, void* destination, size_t size);
+// Add a task that runs a kernel over 'globalSize' work-items.  The
+// argument values are copied.
+int graphKernel(TaskGraph* graph, cl_kernel kernel, size_t globalSize,
+                cl_uint argCount, TaskArg const* args);
+
+// Enqueue every task.  With a single queue (in order or out of order)
+// every task goes to it; with several, a task goes to the queue of its
+// first dependency, so that chains stay on one queue, and independent
+// tasks are spread round-robin.  Either way the dependencies are passed
+// as event wait lists.  The queues are flushed, but not waited for.
+cl_int graphSubmit(TaskGraph* graph, cl_command_queue const* queues,
+                   unsigned queueCount);
+
+// Wait for every task of the last submission.
+cl_int graphWait(TaskGraph* graph);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
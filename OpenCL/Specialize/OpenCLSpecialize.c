@@ -0,0 +1,203 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Specialize.h"
+
+// This sample runs a saxpy (z=a*x+y) with kernels specialized at run
+// time: kernel.cl is rebuilt with -D options that compile in a, the
+// length, the vector width and an unroll factor, and optionally with
+// -cl-mad-enable and -cl-fast-relaxed-math (see Specialize.h).
+//
+// For each configuration it times the first call, which includes the
+// build, and the median of the following calls, which find the program
+// in the cache.  It then cycles through more configurations than the
+// cache holds, to show the least recently used ones being rebuilt.
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int compareDoubles(void const* a, void const* b)
+{
+    double const x = *(double const*) a;
+    double const y = *(double const*) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Run one saxpy and wait for it.
+static cl_int run(SpecializeCache* cache, Specialization const* specialization,
+                  float a, cl_mem x, cl_mem y, cl_mem z, size_t count)
+{
+    cl_int r = specializeEnqueueSaxpy(cache, specialization, a, x, y, z, count,
+                                      0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clFinish(cache->runtime->queue);
+    return r;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLSpecialize [elements [repeats]]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) 1 << 24;
+    int const repeats = argc > 2 ? atoi(argv[2]) : 20;
+    if (0 == dimension || repeats < 1)
+    {
+        printf("Usage: %s [elements [repeats]]\n", argv[0]);
+        return 1;
+    }
+
+    Runtime runtime;
+    cl_int r = runtimeCreate(&runtime, NULL);
+    if (CL_SUCCESS != r)
+        return r;
+    SpecializeCache cache;
+    r = specializeCreate(&cache, &runtime, "kernel.cl");
+    if (CL_SUCCESS != r)
+        return r;
+
+    float const a = 2.0f;
+    size_t const size = dimension * sizeof(cl_float);
+    float* x = (float*) malloc(size);
+    float* y = (float*) malloc(size);
+    float* z = (float*) malloc(size);
+    double* times = (double*) malloc(sizeof(double) * repeats);
+    if (NULL == x || NULL == y || NULL == z || NULL == times)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+    cl_mem devX = runtimeAcquireBuffer(&runtime, size, &r);
+    cl_mem devY = 0;
+    cl_mem devZ = 0;
+    if (CL_SUCCESS == r)
+        devY = runtimeAcquireBuffer(&runtime, size, &r);
+    if (CL_SUCCESS == r)
+        devZ = runtimeAcquireBuffer(&runtime, size, &r);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime.queue, devX, CL_TRUE, 0, size, x, 0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clEnqueueWriteBuffer(runtime.queue, devY, CL_TRUE, 0, size, y, 0, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("Unable to set up device buffers, return code %d\n", r);
+        return r;
+    }
+
+    // fixedA, a, fixedLength, length, width, unroll, madEnable,
+    // fastRelaxedMath
+    // TODO: Try the configurations that matter for your device.
+    Specialization const configurations[] =
+    {
+        {0, 0.0f, 0, 0, 1, 1, 0, 0},
+        {1, a, 0, 0, 1, 1, 0, 0},
+        {1, a, 1, dimension, 1, 1, 0, 0},
+        {0, 0.0f, 0, 0, 4, 1, 0, 0},
+        {0, 0.0f, 0, 0, 4, 4, 0, 0},
+        {1, a, 1, dimension, 4, 4, 0, 0},
+        {1, a, 1, dimension, 4, 4, 1, 1},
+        {1, a, 1, dimension, 16, 2, 1, 1}
+    };
+    int const configurationCount = sizeof(configurations) / sizeof(configurations[0]);
+
+    printf("%zu elements\n", dimension);
+    printf("%11s %11s %9s  %s\n", "first call", "median", "GB/s", "options");
+    for (int c = 0; c < configurationCount; ++ c)
+    {
+        Specialization const* specialization = &configurations[c];
+        char options[SPECIALIZE_MAX_OPTIONS];
+        specializeOptions(specialization, options, sizeof(options));
+
+        memset(z, 0, size);
+        r = clEnqueueWriteBuffer(runtime.queue, devZ, CL_TRUE, 0, size, z, 0, NULL, NULL);
+        double const start = now();
+        if (CL_SUCCESS == r)
+            r = run(&cache, specialization, a, devX, devY, devZ, dimension);
+        double const first = now() - start;
+        for (int t = 0; t < repeats && CL_SUCCESS == r; ++ t)
+        {
+            double const start = now();
+            r = run(&cache, specialization, a, devX, devY, devZ, dimension);
+            times[t] = now() - start;
+        }
+        if (CL_SUCCESS == r)
+            r = clEnqueueReadBuffer(runtime.queue, devZ, CL_TRUE, 0, size, z,
+                                    0, NULL, NULL);
+        if (CL_SUCCESS != r)
+        {
+            printf("Running with \"%s\" failed with return code %d\n", options, r);
+            return r;
+        }
+        qsort(times, repeats, sizeof(double), compareDoubles);
+        double const median = times[repeats / 2];
+        printf("%8.3f ms %8.3f ms %9.2f  %s\n", first * 1e3, median * 1e3,
+               3.0 * size / median * 1e-9, options);
+
+        // Check that results are correct.  Multiplying by 2 is exact, so
+        // the result is exact even with -cl-mad-enable.
+        for (size_t i = 0; i < dimension; ++ i)
+        {
+            if (x[i]*a + y[i] != z[i])
+            {
+                printf("Unexpected result at element %zu:\n", i);
+                printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                       x[i], a, y[i], z[i]);
+                return 100;
+            }
+        }
+    }
+    printf("Cache: %zu hits, %zu builds, %zu evictions\n",
+           cache.hits, cache.misses, cache.evictions);
+
+    // One more configuration than the cache holds, in turn: every lookup
+    // misses, as the next one needed is always the least recently used.
+    // Specialize only the configurations that are hot.
+    size_t const missesBefore = cache.misses;
+    double const cycleStart = now();
+    for (int round = 0; round < 2 && CL_SUCCESS == r; ++ round)
+    {
+        for (int c = 0; c <= SPECIALIZE_CACHE_SIZE && CL_SUCCESS == r; ++ c)
+        {
+            Specialization specialization = configurations[0];
+            specialization.fixedA = 1;
+            specialization.a = (float) (c + 3);
+            r = run(&cache, &specialization, 0.0f, devX, devY, devZ, dimension);
+        }
+    }
+    if (CL_SUCCESS != r)
+    {
+        printf("Cycling through configurations failed with return code %d\n", r);
+        return r;
+    }
+    printf("Cycling through %d fixed values of a twice: %zu builds, %.3f ms\n",
+           SPECIALIZE_CACHE_SIZE + 1, cache.misses - missesBefore,
+           (now() - cycleStart) * 1e3);
+    printf("Cache: %zu hits, %zu builds, %zu evictions\n",
+           cache.hits, cache.misses, cache.evictions);
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(x);
+    free(y);
+    free(z);
+    free(times);
+
+    // Give the buffers back and release everything.
+    runtimeReleaseBuffer(&runtime, devX);
+    runtimeReleaseBuffer(&runtime, devY);
+    runtimeReleaseBuffer(&runtime, devZ);
+    specializeRelease(&cache);
+    runtimeRelease(&runtime);
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Specialize.h"
+
+// Read a whole file into a null-terminated string, or return NULL.
+static char* readFile(char const* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (NULL == file)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* contents = size >= 0 ? (char*) malloc(size + 1) : NULL;
+    if (NULL != contents && size != (long) fread(contents, 1, size, file))
+    {
+        free(contents);
+        contents = NULL;
+    }
+    fclose(file);
+    if (NULL != contents)
+        contents[size] = 0;
+    return contents;
+}
+
+cl_int specializeCreate(SpecializeCache* cache, Runtime* runtime,
+                        char const* kernelPath)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->runtime = runtime;
+    cache->source = readFile(kernelPath);
+    if (NULL == cache->source)
+    {
+        printf("Unable to read kernel source file %s\n", kernelPath);
+        return CL_INVALID_VALUE;
+    }
+    return CL_SUCCESS;
+}
+
+static void releaseProgram(SpecializedProgram* entry)
+{
+    if (entry->kernel)
+        clReleaseKernel(entry->kernel);
+    if (entry->program)
+        clReleaseProgram(entry->program);
+    memset(entry, 0, sizeof(*entry));
+}
+
+void specializeRelease(SpecializeCache* cache)
+{
+    for (unsigned p = 0; p < cache->count; ++ p)
+    {
+        releaseProgram(&cache->programs[p]);
+    }
+    free(cache->source);
+    memset(cache, 0, sizeof(*cache));
+}
+
+int specializeOptions(Specialization const* specialization, char* options,
+                      size_t size)
+{
+    unsigned const width = specialization->width ? specialization->width : 1;
+    unsigned const unroll = specialization->unroll ? specialization->unroll : 1;
+    if ((1 != width && 2 != width && 4 != width && 8 != width && 16 != width)
+        || (specialization->fixedA && !isfinite(specialization->a)))
+    {
+        return 0;
+    }
+
+    // a is written as a hexadecimal float literal, which is exact.
+    int length = snprintf(options, size, "-D WIDTH=%u -D UNROLL=%u", width, unroll);
+    if (specialization->fixedA && length >= 0 && (size_t) length < size)
+        length += snprintf(options + length, size - length, " -D FIXED_A=%af",
+                           (double) specialization->a);
+    if (specialization->fixedLength && length >= 0 && (size_t) length < size)
+        length += snprintf(options + length, size - length, " -D LENGTH=%lluUL",
+                           (unsigned long long) specialization->length);
+    if (specialization->madEnable && length >= 0 && (size_t) length < size)
+        length += snprintf(options + length, size - length, " -cl-mad-enable");
+    if (specialization->fastRelaxedMath && length >= 0 && (size_t) length < size)
+        length += snprintf(options + length, size - length, " -cl-fast-relaxed-math");
+    return length >= 0 && (size_t) length < size;
+}
+
+// Build the program for 'options' into a cache entry.
+static cl_int build(SpecializeCache* cache, SpecializedProgram* entry,
+                    char const* options)
+{
+    Runtime* runtime = cache->runtime;
+    char const* sourceLines[1] = {cache->source};
+    cl_int r = CL_SUCCESS;
+    entry->program = clCreateProgramWithSource(runtime->context, 1, sourceLines,
+                                               NULL, &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateProgramWithSource failed with return code %d\n", r);
+        return r;
+    }
+    r = clBuildProgram(entry->program, 1, &runtime->device, options, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clBuildProgram with \"%s\" failed with return value %d; error log:\n",
+               options, r);
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(entry->program, runtime->device,
+                                            CL_PROGRAM_BUILD_LOG,
+                                            sizeof(buildLog), buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            printf("%s\n", buildLog);
+        }
+        return r;
+    }
+    entry->kernel = clCreateKernel(entry->program, "saxpy", &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateKernel failed with return code %d\n", r);
+        return r;
+    }
+    strcpy(entry->options, options);
+    return CL_SUCCESS;
+}
+
+cl_kernel specializeKernel(SpecializeCache* cache,
+                           Specialization const* specialization, cl_int* error)
+{
+    char options[SPECIALIZE_MAX_OPTIONS];
+    if (!specializeOptions(specialization, options, sizeof(options)))
+    {
+        printf("Invalid specialization\n");
+        *error = CL_INVALID_VALUE;
+        return 0;
+    }
+
+    ++ cache->clock;
+    for (unsigned p = 0; p < cache->count; ++ p)
+    {
+        SpecializedProgram* entry = &cache->programs[p];
+        if (0 == strcmp(entry->options, options))
+        {
+            entry->lastUse = cache->clock;
+            ++ cache->hits;
+            *error = CL_SUCCESS;
+            return entry->kernel;
+        }
+    }
+
+    // Not built yet: take a free entry, or the least recently used one.
+    ++ cache->misses;
+    SpecializedProgram* entry = NULL;
+    if (cache->count < SPECIALIZE_CACHE_SIZE)
+    {
+        entry = &cache->programs[cache->count++];
+    }
+    else
+    {
+        entry = &cache->programs[0];
+        for (unsigned p = 1; p < cache->count; ++ p)
+        {
+            if (cache->programs[p].lastUse < entry->lastUse)
+                entry = &cache->programs[p];
+        }
+        releaseProgram(entry);
+        ++ cache->evictions;
+    }
+    *error = build(cache, entry, options);
+    if (CL_SUCCESS != *error)
+    {
+        // Give the entry back, keeping the others in place.
+        releaseProgram(entry);
+        *entry = cache->programs[-- cache->count];
+        memset(&cache->programs[cache->count], 0, sizeof(SpecializedProgram));
+        return 0;
+    }
+    entry->lastUse = cache->clock;
+    return entry->kernel;
+}
+
+cl_int specializeEnqueueSaxpy(SpecializeCache* cache,
+                              Specialization const* specialization, float a,
+                              cl_mem x, cl_mem y, cl_mem z, size_t count,
+                              cl_uint waitCount, cl_event const* waitList,
+                              cl_event* event)
+{
+    if (specialization->fixedLength && specialization->length != count)
+    {
+        printf("The kernel was specialized for %llu elements, not %zu\n",
+               (unsigned long long) specialization->length, count);
+        return CL_INVALID_VALUE;
+    }
+    cl_int r = CL_SUCCESS;
+    cl_kernel kernel = specializeKernel(cache, specialization, &r);
+    if (CL_SUCCESS != r)
+        return r;
+
+    // Enough work-items for the vectors, and for the tail.
+    size_t const width = specialization->width ? specialization->width : 1;
+    size_t const unroll = specialization->unroll ? specialization->unroll : 1;
+    size_t const vectors = count / width;
+    size_t const tail = count - vectors * width;
+    size_t global = (vectors + unroll - 1) / unroll;
+    if (global < tail)
+        global = tail;
+    if (0 == global)
+        return clEnqueueMarkerWithWaitList(cache->runtime->queue, waitCount,
+                                           waitList, event);
+
+    float const factor = specialization->fixedA ? specialization->a : a;
+    cl_ulong const elements = count;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &x);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &y);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &z);
+    clSetKernelArg(kernel, 3, sizeof(cl_float), &factor);
+    clSetKernelArg(kernel, 4, sizeof(cl_ulong), &elements);
+    return clEnqueueNDRangeKernel(cache->runtime->queue, kernel, 1, NULL, &global,
+                                  NULL, waitCount, waitList, event);
+}
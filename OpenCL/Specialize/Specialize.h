@@ -0,0 +1,95 @@
+#ifndef SPECIALIZE_H
+#define SPECIALIZE_H
+
+#include "Runtime.h"
+
+// Specialized builds of this directory's kernel.cl.  Values that are
+// usually only known at run time (a, the length) can be compiled in as
+// constants, along with the vector width and unroll factor and the math
+// options, by building the program with -D options.
+//
+// Building a program takes milliseconds to seconds, so the built
+// programs are kept in a small cache keyed by the option string, and the
+// least recently used one is released when the cache is full.  A
+// configuration that is used over and over is only built once.
+//
+// The cache uses the context, device and queue of a Runtime (see
+// ../Runtime), and like it is not thread-safe.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPECIALIZE_CACHE_SIZE 8
+#define SPECIALIZE_MAX_OPTIONS 256
+
+// What to compile in.  A zeroed Specialization is the generic kernel.
+typedef struct
+{
+    // Compile in a, which must be finite.
+    int fixedA;
+    float a;
+    // Compile in the length; the kernel then only runs on that length.
+    int fixedLength;
+    cl_ulong length;
+    // 0 or 1 for scalar loads and stores, otherwise 2, 4, 8 or 16.
+    unsigned width;
+    // Vectors per work-item; 0 means 1.
+    unsigned unroll;
+    // -cl-mad-enable and -cl-fast-relaxed-math.
+    int madEnable;
+    int fastRelaxedMath;
+} Specialization;
+
+typedef struct
+{
+    char options[SPECIALIZE_MAX_OPTIONS];
+    cl_program program;
+    cl_kernel kernel;
+    unsigned long lastUse;
+} SpecializedProgram;
+
+typedef struct
+{
+    Runtime* runtime;
+    char* source;
+    unsigned count;
+    SpecializedProgram programs[SPECIALIZE_CACHE_SIZE];
+    unsigned long clock;
+    // Statistics: lookups that found a built program, builds, and
+    // programs released to make room.
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+} SpecializeCache;
+
+// Set up an empty cache for the kernel source in 'kernelPath'.
+cl_int specializeCreate(SpecializeCache* cache, Runtime* runtime,
+                        char const* kernelPath);
+void specializeRelease(SpecializeCache* cache);
+
+// Write the build options for a specialization.  The options are always
+// written in the same order, so that equal specializations have equal
+// strings.  Returns 0 if the specialization is invalid.
+int specializeOptions(Specialization const* specialization, char* options,
+                      size_t size);
+
+// Return the saxpy kernel built for a specialization, building it if it
+// isn't in the cache.  The kernel belongs to the cache, and stays valid
+// until the cache releases its program.
+cl_kernel specializeKernel(SpecializeCache* cache,
+                           Specialization const* specialization, cl_int* error);
+
+// Enqueue z = a*x + y over 'count' elements with the specialized kernel.
+// A fixed a overrides 'a', and a fixed length must equal 'count'.
+cl_int specializeEnqueueSaxpy(SpecializeCache* cache,
+                              Specialization const* specialization, float a,
+                              cl_mem x, cl_mem y, cl_mem z, size_t count,
+                              cl_uint waitCount, cl_event const* waitList,
+                              cl_event* event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
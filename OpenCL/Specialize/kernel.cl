@@ -0,0 +1,67 @@
+// This kernel computes z = a*x + y over 'count' elements.  It is built
+// with any of these constants defined (with -D), to specialize it:
+//
+//   FIXED_A  the value of a, so the 'a' argument is ignored
+//   LENGTH   the number of elements, so 'count' is ignored
+//   WIDTH    floats per load and store: 1 (the default), 2, 4, 8 or 16
+//   UNROLL   vectors of WIDTH floats per work-item (default 1)
+//
+// Work-item n processes vectors n, n + global size, ..., UNROLL of them,
+// so consecutive work-items access consecutive vectors.  When the length
+// isn't a multiple of WIDTH, the first few work-items also process one of
+// the last elements each.  The host launches max(vectors / UNROLL, tail)
+// work-items, rounded up.
+
+#ifndef WIDTH
+#define WIDTH 1
+#endif
+#ifndef UNROLL
+#define UNROLL 1
+#endif
+
+#define CONCAT_(a, b) a##b
+#define CONCAT(a, b) CONCAT_(a, b)
+
+#if WIDTH == 1
+#define LOAD(n, p) (p)[n]
+#define STORE(v, n, p) ((p)[n] = (v))
+#else
+#define LOAD(n, p) CONCAT(vload, WIDTH)(n, p)
+#define STORE(v, n, p) CONCAT(vstore, WIDTH)(v, n, p)
+#endif
+
+__kernel void saxpy(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong count)
+{
+#ifdef FIXED_A
+    float const factor = FIXED_A;
+#else
+    float const factor = a;
+#endif
+#ifdef LENGTH
+    ulong const elements = LENGTH;
+#else
+    ulong const elements = count;
+#endif
+    ulong const vectors = elements / WIDTH;
+    size_t const n = get_global_id(0);
+    size_t const stride = get_global_size(0);
+
+#pragma unroll
+    for (int u = 0; u < UNROLL; ++u)
+    {
+        size_t const v = n + u * stride;
+        if (v < vectors)
+        {
+            STORE(factor * LOAD(v, x) + LOAD(v, y), v, z);
+        }
+    }
+
+#if WIDTH > 1
+    ulong const tail = vectors * WIDTH + n;
+    if (tail < elements)
+    {
+        z[tail] = factor * x[tail] + y[tail];
+    }
+#endif
+}
@@ -0,0 +1,348 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <CL/opencl.h>
+
+// This sample streams a saxpy (z=a*x+y) over host arrays that may be much
+// larger than device memory.  The arrays are cut into chunks, and a ring
+// of two or three sets of chunk-sized device buffers is rotated across
+// three in-order queues: one for uploads, one for the kernel and one for
+// downloads.  The queues are chained with events only where a real
+// dependency exists, so that the upload of chunk N+1, the kernel of chunk
+// N and the download of chunk N-1 can all run at the same time.
+
+#define MAX_RING_SIZE 3
+
+// One set of device buffers, together with the events of the last
+// commands that used it.
+typedef struct
+{
+    cl_mem devXmem;
+    cl_mem devYmem;
+    cl_mem devZmem;
+    cl_event uploaded;
+    cl_event computed;
+    cl_event downloaded;
+} BufferSet;
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Replace an event handle, releasing the one it held.
+static void replaceEvent(cl_event* event, cl_event replacement)
+{
+    if (*event)
+        clReleaseEvent(*event);
+    *event = replacement;
+}
+
+// Stream the whole of x and y through the ring of buffer sets, writing z.
+static cl_int stream(cl_command_queue uploadQueue,
+                     cl_command_queue computeQueue,
+                     cl_command_queue downloadQueue,
+                     cl_kernel kernel, BufferSet* ring, int ringSize,
+                     float const* x, float const* y, float* z, float a,
+                     size_t dimension, size_t chunkSize)
+{
+    cl_int r = CL_SUCCESS;
+    size_t chunk = 0;
+    for (size_t offset = 0; offset < dimension && CL_SUCCESS == r;
+         offset += chunkSize, ++ chunk)
+    {
+        BufferSet* set = &ring[chunk % ringSize];
+        size_t count = dimension - offset < chunkSize
+                       ? dimension - offset : chunkSize;
+        size_t const bytes = count * sizeof(cl_float);
+        cl_event uploaded = 0;
+        cl_event computed = 0;
+        cl_event downloaded = 0;
+
+        // The uploads overwrite x and y of this set, so they must wait
+        // until the kernel of the chunk that last used the set is done.
+        cl_uint waitCount = set->computed ? 1 : 0;
+        r = clEnqueueWriteBuffer(uploadQueue, set->devXmem, CL_FALSE, 0,
+                                 bytes, x + offset, waitCount,
+                                 waitCount ? &set->computed : NULL, NULL);
+        if (CL_SUCCESS == r)
+        {
+            r = clEnqueueWriteBuffer(uploadQueue, set->devYmem, CL_FALSE, 0,
+                                     bytes, y + offset, 0, NULL, &uploaded);
+        }
+
+        // The kernel needs this chunk's inputs, and overwrites z of this
+        // set, so it must also wait until the previous download from the
+        // set is done.
+        if (CL_SUCCESS == r)
+        {
+            cl_event waitList[2] = {uploaded, set->downloaded};
+            waitCount = set->downloaded ? 2 : 1;
+            clSetKernelArg(kernel, 0, sizeof(cl_mem), &set->devXmem);
+            clSetKernelArg(kernel, 1, sizeof(cl_mem), &set->devYmem);
+            clSetKernelArg(kernel, 2, sizeof(cl_mem), &set->devZmem);
+            clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+            r = clEnqueueNDRangeKernel(computeQueue, kernel, 1, NULL, &count,
+                                       NULL, waitCount, waitList, &computed);
+        }
+
+        // The download only needs this chunk's kernel.
+        if (CL_SUCCESS == r)
+        {
+            r = clEnqueueReadBuffer(downloadQueue, set->devZmem, CL_FALSE, 0,
+                                    bytes, z + offset, 1, &computed,
+                                    &downloaded);
+        }
+
+        replaceEvent(&set->uploaded, uploaded);
+        replaceEvent(&set->computed, computed);
+        replaceEvent(&set->downloaded, downloaded);
+
+        // Flush every queue so that the device can start on each command
+        // as soon as its dependencies are met, rather than when the next
+        // blocking call happens.
+        clFlush(uploadQueue);
+        clFlush(computeQueue);
+        clFlush(downloadQueue);
+    }
+
+    // Wait for the tail of the stream.
+    clFinish(uploadQueue);
+    clFinish(computeQueue);
+    cl_int const rfinish = clFinish(downloadQueue);
+    for (int s = 0; s < ringSize; ++ s)
+    {
+        replaceEvent(&ring[s].uploaded, 0);
+        replaceEvent(&ring[s].computed, 0);
+        replaceEvent(&ring[s].downloaded, 0);
+    }
+    return CL_SUCCESS == r ? rfinish : r;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLStreaming [elements [chunkElements [ringSize]]]
+    // The total size is limited only by host memory; device memory holds
+    // just ringSize sets of three chunk-sized buffers.
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) 64 << 20;
+    size_t const chunkSize = argc > 2 ? (size_t) strtoull(argv[2], NULL, 10)
+                                      : (size_t) 4 << 20;
+    int const ringSize = argc > 3 ? atoi(argv[3]) : 3;
+    if (0 == dimension || 0 == chunkSize
+        || ringSize < 1 || ringSize > MAX_RING_SIZE)
+    {
+        printf("Usage: %s [elements [chunkElements [ringSize (1-%d)]]]\n",
+               argv[0], MAX_RING_SIZE);
+        return 1;
+    }
+
+    // Get the list of platforms.
+    int const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint numPlatforms = 0;
+    cl_int r = clGetPlatformIDs(maxPlatformCount, &platforms[0], &numPlatforms);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: You may want to look at the list of platforms that are
+    // returned, and choose the most appropriate one for your needs.
+    int const platformToUse = 0;
+
+    // Get the devices available for the chosen platform.
+    cl_uint deviceCount = 0;
+    size_t const maxDeviceCount = 8;
+    cl_device_id devices[maxDeviceCount];
+    r = clGetDeviceIDs(platforms[platformToUse], CL_DEVICE_TYPE_ALL,
+                       maxDeviceCount, &devices[0], &deviceCount);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: If you have multiple devices, you may specify which one
+    // you'd like to use by changing this variable.
+    int const deviceToUse = 0;
+    cl_device_id device = devices[deviceToUse];
+
+    cl_context context = clCreateContext(0, 1, &device, NULL, NULL, &r);
+    if (0 == context || CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return value %p and code %d\n",
+               context, r);
+        return r;
+    }
+
+    // Create separate queues for uploads, kernels and downloads.  Commands
+    // in different in-order queues are free to overlap; only the event
+    // wait lists set up in stream() order them.
+    cl_command_queue queues[3];
+    for (int q = 0; q < 3; ++ q)
+    {
+        queues[q] = clCreateCommandQueue(context, device, 0, &r);
+        if (0 == queues[q] || CL_SUCCESS != r)
+        {
+            printf("clCreateCommandQueue failed with return value %p and code %d\n",
+                   queues[q], r);
+            return r;
+        }
+    }
+
+    // Read the kernel source and build it.
+    FILE* kernelFile = fopen("kernel.cl", "rb");
+    if (NULL == kernelFile)
+    {
+        printf("Unable to open kernel source file\n");
+        return 1;
+    }
+    fseek(kernelFile, 0, SEEK_END);
+    long kernelSize = ftell(kernelFile);
+    fseek(kernelFile, 0, SEEK_SET);
+    char* kernelSource = (char*) malloc(kernelSize+1);
+    if (kernelSize != (long) fread(kernelSource, 1, kernelSize, kernelFile))
+    {
+        printf("Unable to read kernel source\n");
+        return 4;
+    }
+    fclose(kernelFile);
+    kernelSource[kernelSize] = 0;
+
+    const char* sourceLines[1] = {kernelSource};
+    cl_program program = clCreateProgramWithSource(context, 1,
+                         &sourceLines[0], NULL, &r);
+    free(kernelSource);
+    kernelSource = NULL;
+    if (0 == program || CL_SUCCESS != r)
+    {
+        printf("clCreateProgramWithSource failed with return value %p and code %d\n",
+               program, r);
+        return r;
+    }
+
+    r = clBuildProgram(program, 0, 0, 0, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("clBuildProgram failed with return value %d; error log:\n", r);
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG,
+                                            sizeof(buildLog), buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            printf("%s\n", buildLog);
+        }
+        return r;
+    }
+
+    cl_kernel kernel = clCreateKernel(program, "saxpy", &r);
+    if (0 == kernel || CL_SUCCESS != r)
+    {
+        printf("clCreateKernel failed with return value %p and code %d\n",
+               kernel, r);
+        return r;
+    }
+
+    // Allocate the ring of device buffer sets.
+    BufferSet ring[MAX_RING_SIZE];
+    memset(ring, 0, sizeof(ring));
+    size_t const chunkBytes = chunkSize * sizeof(cl_float);
+    for (int s = 0; s < ringSize; ++ s)
+    {
+        ring[s].devXmem = clCreateBuffer(context, CL_MEM_READ_ONLY, chunkBytes, NULL, &r);
+        if (CL_SUCCESS == r)
+            ring[s].devYmem = clCreateBuffer(context, CL_MEM_READ_ONLY, chunkBytes, NULL, &r);
+        if (CL_SUCCESS == r)
+            ring[s].devZmem = clCreateBuffer(context, CL_MEM_WRITE_ONLY, chunkBytes, NULL, &r);
+        if (CL_SUCCESS != r)
+        {
+            printf("clCreateBuffer failed for buffer set %d with code %d\n", s, r);
+            return r;
+        }
+    }
+
+    // Allocate host memory for input and output vectors, and set values
+    // to something easy to verify.
+    // TODO: Transfers from pageable memory may be staged through a driver
+    // buffer, which limits how much they overlap with kernels.  If the
+    // arrays can be allocated in pinned memory (e.g. by mapping buffers
+    // created with CL_MEM_ALLOC_HOST_PTR) the copies can run as DMA.
+    float const a = 2.0f;
+    float* x = (float*) malloc(sizeof(float) * dimension);
+    float* y = (float*) malloc(sizeof(float) * dimension);
+    float* z = (float*) malloc(sizeof(float) * dimension);
+    if (NULL == x || NULL == y || NULL == z)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+
+    // Run once with a single buffer set, where each chunk has to wait for
+    // the previous one to be downloaded, and then with the full ring.
+    int const ringSizes[2] = {1, ringSize};
+    for (int run = 0; run < 2; ++ run)
+    {
+        memset(z, 0, sizeof(float) * dimension);
+
+        double const start = now();
+        r = stream(queues[0], queues[1], queues[2], kernel, ring, ringSizes[run],
+                   x, y, z, a, dimension, chunkSize);
+        double const seconds = now() - start;
+        if (CL_SUCCESS != r)
+        {
+            printf("Streaming failed with return code %d\n", r);
+            return r;
+        }
+        printf("Ring of %d buffer set(s): %zu elements in %zu-element chunks, "
+               "%.3f ms (%.2f GB/s)\n", ringSizes[run], dimension, chunkSize,
+               seconds * 1e3, 3.0 * dimension * sizeof(cl_float) / seconds * 1e-9);
+
+        // Check that results are correct.  Note that the code below
+        // depends on the computation being exact, which may not be the
+        // case for more complicated computations.
+        for (size_t i = 0; i < dimension; ++ i)
+        {
+            if (x[i]*a + y[i] != z[i])
+            {
+                printf("Unexpected result at element %zu:\n", i);
+                printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                       x[i], a, y[i], z[i]);
+                return 100;
+            }
+        }
+    }
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(x);
+    free(y);
+    free(z);
+
+    // Release device objects.
+    for (int s = 0; s < ringSize; ++ s)
+    {
+        clReleaseMemObject(ring[s].devXmem);
+        clReleaseMemObject(ring[s].devYmem);
+        clReleaseMemObject(ring[s].devZmem);
+    }
+    clReleaseKernel(kernel);
+    clReleaseProgram(program);
+    for (int q = 0; q < 3; ++ q)
+    {
+        clReleaseCommandQueue(queues[q]);
+    }
+    clReleaseContext(context);
+
+    return 0;
+}
@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Trace.h"
+
+// This sample is the Minimal sample's saxpy (z=a*x+y), with every OpenCL
+// call wrapped in a host span and every enqueued command profiled on the
+// device (see Trace.h).  Run it with the OPENCL_TRACE environment
+// variable set to a file name, e.g.
+//
+//   OPENCL_TRACE=trace.json ./OpenCLTrace
+//
+// and open the file in chrome://tracing or https://ui.perfetto.dev to see
+// where the time goes: platform and device queries, context and queue
+// creation, the program build, buffer creation, the uploads, the kernel
+// and the readback.  Without OPENCL_TRACE nothing is recorded.
+
+int main(int argc, char** argv)
+{
+    // OpenCLTrace [elements]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) 1 << 22;
+    if (0 == dimension)
+    {
+        printf("Usage: %s [elements]\n", argv[0]);
+        return 1;
+    }
+    traceStart(NULL);
+    TRACE_BEGIN(total);
+
+    // Get the list of platforms.
+    int const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint numPlatforms = 0;
+    TRACE_BEGIN(getPlatforms);
+    cl_int r = clGetPlatformIDs(maxPlatformCount, &platforms[0], &numPlatforms);
+    TRACE_END(getPlatforms, "clGetPlatformIDs");
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: You may want to look at the list of platforms that are
+    // returned, and choose the most appropriate one for your needs.
+    int const platformToUse = 0;
+
+    // Get the devices available for the chosen platform.
+    cl_uint deviceCount = 0;
+    size_t const maxDeviceCount = 8;
+    cl_device_id devices[maxDeviceCount];
+    TRACE_BEGIN(getDevices);
+    r = clGetDeviceIDs(platforms[platformToUse], CL_DEVICE_TYPE_ALL,
+                       maxDeviceCount, &devices[0], &deviceCount);
+    TRACE_END(getDevices, "clGetDeviceIDs");
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: If you have multiple devices, you may specify which one
+    // you'd like to use by changing this variable.
+    int const deviceToUse = 0;
+    cl_device_id device = devices[deviceToUse];
+
+    TRACE_BEGIN(createContext);
+    cl_context context = clCreateContext(0, 1, &device, NULL, NULL, &r);
+    TRACE_END(createContext, "clCreateContext");
+    if (0 == context || CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return value %p and code %d\n",
+               context, r);
+        return r;
+    }
+
+    // The queue profiles its commands only while tracing.
+    TRACE_BEGIN(createQueue);
+    cl_command_queue commandQueue = clCreateCommandQueue(context, device,
+                                    TRACE_QUEUE_PROPERTIES, &r);
+    TRACE_END(createQueue, "clCreateCommandQueue");
+    if (0 == commandQueue || CL_SUCCESS != r)
+    {
+        printf("clCreateCommandQueue failed with return value %p and code %d\n",
+               commandQueue, r);
+        return r;
+    }
+
+    // Read the kernel source.
+    TRACE_BEGIN(readSource);
+    FILE* kernelFile = fopen("kernel.cl", "rb");
+    if (NULL == kernelFile)
+    {
+        printf("Unable to open kernel source file\n");
+        return 1;
+    }
+    fseek(kernelFile, 0, SEEK_END);
+    long kernelSize = ftell(kernelFile);
+    fseek(kernelFile, 0, SEEK_SET);
+    char* kernelSource = (char*) malloc(kernelSize+1);
+    if (kernelSize != (long) fread(kernelSource, 1, kernelSize, kernelFile))
+    {
+        printf("Unable to read kernel source\n");
+        return 4;
+    }
+    fclose(kernelFile);
+    kernelSource[kernelSize] = 0;
+    TRACE_END(readSource, "read kernel.cl");
+
+    const char* sourceLines[1] = {kernelSource};
+    TRACE_BEGIN(createProgram);
+    cl_program program = clCreateProgramWithSource(context, 1,
+                         &sourceLines[0], NULL, &r);
+    TRACE_END(createProgram, "clCreateProgramWithSource");
+    free(kernelSource);
+    kernelSource = NULL;
+    if (0 == program || CL_SUCCESS != r)
+    {
+        printf("clCreateProgramWithSource failed with return value %p and code %d\n",
+               program, r);
+        return r;
+    }
+
+    TRACE_BEGIN(build);
+    r = clBuildProgram(program, 0, 0, 0, 0, 0);
+    TRACE_END(build, "clBuildProgram");
+    if (CL_SUCCESS != r)
+    {
+        printf("clBuildProgram failed with return value %d; error log:\n", r);
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG,
+                                            sizeof(buildLog), buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            printf("%s\n", buildLog);
+        }
+        return r;
+    }
+
+    TRACE_BEGIN(createKernel);
+    cl_kernel kernel = clCreateKernel(program, "saxpy", &r);
+    TRACE_END(createKernel, "clCreateKernel");
+    if (0 == kernel || CL_SUCCESS != r)
+    {
+        printf("clCreateKernel failed with return value %p and code %d\n",
+               kernel, r);
+        return r;
+    }
+
+    // Allocate host memory for input and output vectors, and set values
+    // to something easy to verify.
+    TRACE_BEGIN(hostSetup);
+    float* x = (float*) malloc(sizeof(float) * dimension);
+    float* y = (float*) malloc(sizeof(float) * dimension);
+    float* z = (float*) malloc(sizeof(float) * dimension);
+    if (NULL == x || NULL == y || NULL == z)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+    }
+    TRACE_END(hostSetup, "host arrays");
+
+    // Unlike the Minimal sample, the buffers are filled with explicit
+    // writes rather than CL_MEM_COPY_HOST_PTR, so that the uploads show up
+    // as device commands.
+    size_t const size = dimension * sizeof(cl_float);
+    TRACE_BEGIN(createBuffers);
+    cl_mem devXmem = clCreateBuffer(context, CL_MEM_READ_ONLY, size, NULL, &r);
+    cl_mem devYmem = 0;
+    cl_mem devZmem = 0;
+    if (CL_SUCCESS == r)
+        devYmem = clCreateBuffer(context, CL_MEM_READ_ONLY, size, NULL, &r);
+    if (CL_SUCCESS == r)
+        devZmem = clCreateBuffer(context, CL_MEM_WRITE_ONLY, size, NULL, &r);
+    TRACE_END(createBuffers, "clCreateBuffer x3");
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    cl_event writeX = 0;
+    cl_event writeY = 0;
+    cl_event saxpy = 0;
+    cl_event readZ = 0;
+    TRACE_BEGIN(enqueueWrites);
+    r = clEnqueueWriteBuffer(commandQueue, devXmem, CL_FALSE, 0, size, x,
+                             0, NULL, TRACE_EVENT(writeX));
+    TRACE_COMMAND("write x", commandQueue, writeX);
+    if (CL_SUCCESS == r)
+    {
+        r = clEnqueueWriteBuffer(commandQueue, devYmem, CL_FALSE, 0, size, y,
+                                 0, NULL, TRACE_EVENT(writeY));
+        TRACE_COMMAND("write y", commandQueue, writeY);
+    }
+    TRACE_END(enqueueWrites, "clEnqueueWriteBuffer x2");
+    if (CL_SUCCESS != r)
+    {
+        printf("clEnqueueWriteBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    // Set kernel parameters, and execute the kernel.
+    float const a = 2.0f;
+    TRACE_BEGIN(setArgs);
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &devXmem);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &devYmem);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &devZmem);
+    r = clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+    TRACE_END(setArgs, "clSetKernelArg x4");
+    if (CL_SUCCESS != r)
+    {
+        printf("clSetKernelArg failed with return code %d\n", r);
+        return r;
+    }
+    TRACE_BEGIN(enqueueKernel);
+    r = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, &dimension, NULL,
+                               0, NULL, TRACE_EVENT(saxpy));
+    TRACE_COMMAND("saxpy", commandQueue, saxpy);
+    TRACE_END(enqueueKernel, "clEnqueueNDRangeKernel");
+    if (CL_SUCCESS != r)
+    {
+        printf("clEnqueueNDRangeKernel failed with return code %d\n", r);
+        return r;
+    }
+
+    // Copy the results back to host memory.  The read is blocking, so the
+    // host span covers everything still queued.
+    TRACE_BEGIN(enqueueRead);
+    r = clEnqueueReadBuffer(commandQueue, devZmem, CL_TRUE, 0, size, z,
+                            0, NULL, TRACE_EVENT(readZ));
+    TRACE_COMMAND("read z", commandQueue, readZ);
+    TRACE_END(enqueueRead, "clEnqueueReadBuffer (blocking)");
+    if (CL_SUCCESS != r)
+    {
+        printf("clEnqueueReadBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    // Check that results are correct.  Note that the code below
+    // depends on the computation being exact.
+    TRACE_BEGIN(check);
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                   x[i], a, y[i], z[i]);
+            return 100;
+        }
+    }
+    TRACE_END(check, "check results");
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(x);
+    free(y);
+    free(z);
+
+    // Write the trace, which waits for and releases the traced events,
+    // while their queue and context still exist.
+    TRACE_END(total, "OpenCLTrace");
+    int const traced = traceStop();
+
+    // Release device memory, kernel, program, command queue, and context.
+    clReleaseMemObject(devXmem);
+    clReleaseMemObject(devYmem);
+    clReleaseMemObject(devZmem);
+    clReleaseKernel(kernel);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(commandQueue);
+    clReleaseContext(context);
+
+    return traced ? 0 : 1;
+}
@@ -0,0 +1,296 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Trace.h"
+
+#define TRACE_MAX_THREADS 64
+#define TRACE_MAX_QUEUES 64
+
+typedef struct
+{
+    char const* name;
+    double start;
+    double end;
+    int thread;
+} HostSpan;
+
+typedef struct
+{
+    char const* name;
+    int queue;
+    cl_event event;
+    // The host time just after the command was enqueued.
+    double enqueued;
+} DeviceCommand;
+
+int traceEnabled = 0;
+
+// Everything below is protected by the mutex while tracing.
+static pthread_mutex_t traceMutex = PTHREAD_MUTEX_INITIALIZER;
+static char* tracePath;
+static double traceOrigin;
+static HostSpan* spans;
+static size_t spanCount;
+static size_t spanCapacity;
+static DeviceCommand* commands;
+static size_t commandCount;
+static size_t commandCapacity;
+static pthread_t threads[TRACE_MAX_THREADS];
+static int threadCount;
+static cl_command_queue queues[TRACE_MAX_QUEUES];
+static int queueCount;
+
+double traceNow(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+void traceStart(char const* path)
+{
+    if (NULL == path)
+        path = getenv("OPENCL_TRACE");
+    if (NULL == path || 0 == path[0] || traceEnabled)
+        return;
+    tracePath = (char*) malloc(strlen(path) + 1);
+    if (NULL == tracePath)
+        return;
+    strcpy(tracePath, path);
+    traceOrigin = traceNow();
+    traceEnabled = 1;
+}
+
+// The track of the calling thread.  Threads beyond the limit share the
+// last track.
+static int threadTrack(void)
+{
+    pthread_t const self = pthread_self();
+    for (int t = 0; t < threadCount; ++ t)
+    {
+        if (pthread_equal(threads[t], self))
+            return t;
+    }
+    if (threadCount == TRACE_MAX_THREADS)
+        return TRACE_MAX_THREADS - 1;
+    threads[threadCount] = self;
+    return threadCount++;
+}
+
+static int queueTrack(cl_command_queue queue)
+{
+    for (int q = 0; q < queueCount; ++ q)
+    {
+        if (queues[q] == queue)
+            return q;
+    }
+    if (queueCount == TRACE_MAX_QUEUES)
+        return TRACE_MAX_QUEUES - 1;
+    queues[queueCount] = queue;
+    return queueCount++;
+}
+
+// Make room for one more element in a growing array.
+static int reserve(void** array, size_t count, size_t* capacity, size_t elementSize)
+{
+    if (count < *capacity)
+        return 1;
+    size_t const grown = *capacity ? 2 * *capacity : 1024;
+    void* resized = realloc(*array, grown * elementSize);
+    if (NULL == resized)
+        return 0;
+    *array = resized;
+    *capacity = grown;
+    return 1;
+}
+
+void traceHostSpan(char const* name, double start)
+{
+    double const end = traceNow();
+    pthread_mutex_lock(&traceMutex);
+    if (reserve((void**) &spans, spanCount, &spanCapacity, sizeof(HostSpan)))
+    {
+        HostSpan* span = &spans[spanCount++];
+        span->name = name;
+        span->start = start;
+        span->end = end;
+        span->thread = threadTrack();
+    }
+    pthread_mutex_unlock(&traceMutex);
+}
+
+void traceDeviceCommand(char const* name, cl_command_queue queue, cl_event event)
+{
+    double const enqueued = traceNow();
+    if (0 == event)
+        return;
+    pthread_mutex_lock(&traceMutex);
+    if (reserve((void**) &commands, commandCount, &commandCapacity,
+                sizeof(DeviceCommand)))
+    {
+        DeviceCommand* command = &commands[commandCount++];
+        command->name = name;
+        command->queue = queueTrack(queue);
+        command->event = event;
+        command->enqueued = enqueued;
+    }
+    else
+    {
+        clReleaseEvent(event);
+    }
+    pthread_mutex_unlock(&traceMutex);
+}
+
+// Write a name as a JSON string.
+static void writeString(FILE* file, char const* s)
+{
+    fputc('"', file);
+    for (; *s; ++ s)
+    {
+        if ('"' == *s || '\\' == *s)
+            fputc('\\', file);
+        if ((unsigned char) *s >= ' ')
+            fputc(*s, file);
+    }
+    fputc('"', file);
+}
+
+static void writeTrackName(FILE* file, int pid, int tid, char const* kind, int index,
+                           char const* suffix)
+{
+    fprintf(file, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"name\":\"%s %d%s\"}}", pid, tid, kind, index, suffix);
+}
+
+int traceStop(void)
+{
+    if (!traceEnabled)
+        return 1;
+    traceEnabled = 0;
+
+    // The device timestamps come from the device's clock.  Each command
+    // was queued before the host recorded it, so the offset from device to
+    // host time is at most (enqueued - queued) for every command; the
+    // smallest of those is the closest estimate.  Queues are estimated
+    // separately, as they may be on different devices.
+    enum { QUEUED, SUBMIT, START, END, TIMESTAMPS };
+    cl_profiling_info const infos[TIMESTAMPS] =
+    {
+        CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_SUBMIT,
+        CL_PROFILING_COMMAND_START, CL_PROFILING_COMMAND_END
+    };
+    cl_ulong (*timestamps)[TIMESTAMPS] =
+        (cl_ulong (*)[TIMESTAMPS]) calloc(commandCount ? commandCount : 1,
+                                          sizeof(*timestamps));
+    int* profiled = (int*) calloc(commandCount ? commandCount : 1, sizeof(int));
+    double offsets[TRACE_MAX_QUEUES];
+    int haveOffset[TRACE_MAX_QUEUES] = {0};
+    size_t unprofiled = 0;
+    for (size_t c = 0; c < commandCount && NULL != timestamps && NULL != profiled; ++ c)
+    {
+        DeviceCommand const* command = &commands[c];
+        cl_int r = clWaitForEvents(1, &command->event);
+        for (int i = 0; i < TIMESTAMPS && CL_SUCCESS == r; ++ i)
+        {
+            r = clGetEventProfilingInfo(command->event, infos[i], sizeof(cl_ulong),
+                                        &timestamps[c][i], NULL);
+        }
+        if (CL_SUCCESS != r)
+        {
+            ++ unprofiled;
+            continue;
+        }
+        profiled[c] = 1;
+        double const offset = command->enqueued - timestamps[c][QUEUED] * 1e-9;
+        if (!haveOffset[command->queue] || offset < offsets[command->queue])
+        {
+            offsets[command->queue] = offset;
+            haveOffset[command->queue] = 1;
+        }
+    }
+    if (unprofiled > 0)
+        printf("%zu traced commands have no profiling information; were their "
+               "queues created with TRACE_QUEUE_PROPERTIES?\n", unprofiled);
+
+    // Host threads are process 1 and queues process 2, so the timeline
+    // shows them as two groups.  Each queue has an execution track (tid
+    // 2q) and a waiting track (tid 2q+1).
+    FILE* file = fopen(tracePath, "w");
+    int ok = NULL != file && NULL != timestamps && NULL != profiled;
+    if (ok)
+    {
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        fprintf(file, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,"
+                "\"args\":{\"name\":\"host\"}}");
+        fprintf(file, ",\n{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":2,"
+                "\"args\":{\"name\":\"device\"}}");
+        for (int t = 0; t < threadCount; ++ t)
+        {
+            writeTrackName(file, 1, t, "thread", t, "");
+        }
+        for (int q = 0; q < queueCount; ++ q)
+        {
+            writeTrackName(file, 2, 2 * q, "queue", q, "");
+            writeTrackName(file, 2, 2 * q + 1, "queue", q, " waiting");
+        }
+        for (size_t s = 0; s < spanCount; ++ s)
+        {
+            HostSpan const* span = &spans[s];
+            fprintf(file, ",\n{\"ph\":\"X\",\"name\":");
+            writeString(file, span->name);
+            fprintf(file, ",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    span->thread, (span->start - traceOrigin) * 1e6,
+                    (span->end - span->start) * 1e6);
+        }
+        for (size_t c = 0; c < commandCount; ++ c)
+        {
+            if (!profiled[c])
+                continue;
+            DeviceCommand const* command = &commands[c];
+            double const offset = offsets[command->queue] - traceOrigin;
+            double t[TIMESTAMPS];
+            for (int i = 0; i < TIMESTAMPS; ++ i)
+            {
+                t[i] = (timestamps[c][i] * 1e-9 + offset) * 1e6;
+            }
+            fprintf(file, ",\n{\"ph\":\"X\",\"name\":");
+            writeString(file, command->name);
+            fprintf(file, ",\"pid\":2,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    2 * command->queue, t[START], t[END] - t[START]);
+            fprintf(file, ",\n{\"ph\":\"X\",\"name\":");
+            writeString(file, command->name);
+            fprintf(file, ",\"pid\":2,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"args\":{\"queued to submit (us)\":%.3f,"
+                    "\"submit to start (us)\":%.3f}}",
+                    2 * command->queue + 1, t[QUEUED], t[START] - t[QUEUED],
+                    t[SUBMIT] - t[QUEUED], t[START] - t[SUBMIT]);
+        }
+        fprintf(file, "\n]}\n");
+    }
+    if (NULL != file && 0 != fclose(file))
+        ok = 0;
+    if (!ok)
+        printf("Unable to write the trace to %s\n", tracePath);
+
+    // Release everything, ready for another traceStart.
+    for (size_t c = 0; c < commandCount; ++ c)
+    {
+        clReleaseEvent(commands[c].event);
+    }
+    free(timestamps);
+    free(profiled);
+    free(commands);
+    free(spans);
+    free(tracePath);
+    commands = NULL;
+    spans = NULL;
+    tracePath = NULL;
+    commandCount = commandCapacity = 0;
+    spanCount = spanCapacity = 0;
+    threadCount = 0;
+    queueCount = 0;
+    return ok;
+}
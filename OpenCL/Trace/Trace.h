@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <CL/opencl.h>
+
+// Instrumentation that records what the host and the device spend their
+// time on, and writes it as a Chrome trace (JSON) that chrome://tracing
+// or https://ui.perfetto.dev can show as a timeline.
+//
+//   - Host spans: wrap a call in TRACE_BEGIN and TRACE_END.  Each host
+//     thread gets its own track.
+//   - Device commands: pass TRACE_EVENT(event) as the event of an
+//     enqueue, and then hand the event over with TRACE_COMMAND.  Each
+//     queue gets its own track, with the time from CL_PROFILING_COMMAND_
+//     START to END, plus a second track with the time the command waited
+//     from QUEUED (through SUBMIT) to START.  Queues must be created with
+//     TRACE_QUEUE_PROPERTIES for the device to record the timestamps.
+//
+// Tracing is off until traceStart, and then everything is kept in memory
+// until traceStop writes the file.  While it is off, each macro costs a
+// test of traceEnabled and nothing else, so the instrumentation can stay
+// in production builds.  Names must be string literals (or otherwise
+// outlive the trace), as only the pointers are kept.
+//
+// The macros can be used from any thread, but traceStart and traceStop
+// must not run while other threads are tracing.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int traceEnabled;
+
+// Start a host span, in a new local variable named 'span'.
+#define TRACE_BEGIN(span) double const span = traceEnabled ? traceNow() : 0.0
+// End the host span started as 'span', and record it as 'name'.
+#define TRACE_END(span, name) \
+    do { if (traceEnabled) traceHostSpan(name, span); } while (0)
+
+// The event argument for an enqueue: where to put the event if tracing,
+// NULL otherwise.  'event' should be a cl_event initialized to 0.
+#define TRACE_EVENT(event) (traceEnabled ? &(event) : NULL)
+// Record the command 'event' belongs to, taking over the event.
+#define TRACE_COMMAND(name, queue, event) \
+    do { if (traceEnabled) traceDeviceCommand(name, queue, event); } while (0)
+
+// The properties to create queues with, so that commands are profiled.
+#define TRACE_QUEUE_PROPERTIES \
+    ((cl_command_queue_properties) (traceEnabled ? CL_QUEUE_PROFILING_ENABLE : 0))
+
+// Start tracing, to be written to 'path', or to the file named by the
+// OPENCL_TRACE environment variable if 'path' is NULL (and if that is not
+// set, tracing stays off).
+void traceStart(char const* path);
+// Wait for the recorded commands, write the trace file, release the
+// recorded events, and turn tracing off.  Call it before releasing the
+// traced queues and their contexts.  Returns 0 if the file couldn't be
+// written.
+int traceStop(void);
+
+// The functions behind the macros.
+double traceNow(void);
+void traceHostSpan(char const* name, double start);
+void traceDeviceCommand(char const* name, cl_command_queue queue, cl_event event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
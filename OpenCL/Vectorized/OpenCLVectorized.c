@@ -0,0 +1,371 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CL/opencl.h>
+
+// This sample runs a saxpy (z=a*x+y) of any length with kernels that
+// process 1, 2, 4, 8 or 16 floats per work-item, and picks the vector
+// width at runtime: either the device's
+// CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT, or whichever width is fastest
+// when each is timed on the actual problem.
+//
+// The vector kernel covers the largest multiple of the width, and the
+// scalar kernel covers the remaining elements (the "tail"), so the length
+// doesn't have to divide evenly.
+
+#define WIDTH_COUNT 5
+static size_t const widths[WIDTH_COUNT] = {1, 2, 4, 8, 16};
+static char const* const kernelNames[WIDTH_COUNT] =
+{
+    "saxpy1", "saxpy2", "saxpy4", "saxpy8", "saxpy16"
+};
+
+// Enqueue z=a*x+y over 'count' elements using the kernel for widths[w],
+// followed if needed by the scalar kernel for the tail.  If 'nanoseconds'
+// is not NULL, wait for completion and return the device time from the
+// start of the first kernel to the end of the last in it.
+static cl_int runSaxpy(cl_command_queue queue, cl_kernel* kernels, int w,
+                       cl_mem devXmem, cl_mem devYmem, cl_mem devZmem,
+                       float a, size_t count, cl_ulong* nanoseconds)
+{
+    cl_ulong const vectors = widths[w] > 1 ? count / widths[w] : 0;
+    size_t const tailStart = (size_t) vectors * widths[w];
+    cl_event events[2] = {0, 0};
+    int eventCount = 0;
+    cl_int r = CL_SUCCESS;
+
+    if (vectors > 0)
+    {
+        cl_kernel kernel = kernels[w];
+        size_t const global = (size_t) vectors;
+        clSetKernelArg(kernel, 0, sizeof(cl_mem), &devXmem);
+        clSetKernelArg(kernel, 1, sizeof(cl_mem), &devYmem);
+        clSetKernelArg(kernel, 2, sizeof(cl_mem), &devZmem);
+        clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+        clSetKernelArg(kernel, 4, sizeof(cl_ulong), &vectors);
+        r = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &global, NULL,
+                                   0, NULL, &events[eventCount++]);
+    }
+
+    // The tail runs the scalar kernel with a global offset, so its
+    // work-items' global IDs are the element indices it covers.
+    if (CL_SUCCESS == r && tailStart < count)
+    {
+        cl_kernel kernel = kernels[0];
+        cl_ulong const end = count;
+        size_t const global = count - tailStart;
+        clSetKernelArg(kernel, 0, sizeof(cl_mem), &devXmem);
+        clSetKernelArg(kernel, 1, sizeof(cl_mem), &devYmem);
+        clSetKernelArg(kernel, 2, sizeof(cl_mem), &devZmem);
+        clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+        clSetKernelArg(kernel, 4, sizeof(cl_ulong), &end);
+        r = clEnqueueNDRangeKernel(queue, kernel, 1, &tailStart, &global, NULL,
+                                   0, NULL, &events[eventCount++]);
+    }
+
+    if (CL_SUCCESS == r && NULL != nanoseconds)
+    {
+        r = clFinish(queue);
+        cl_ulong start = 0;
+        cl_ulong finish = 0;
+        if (eventCount > 0)
+        {
+            clGetEventProfilingInfo(events[0], CL_PROFILING_COMMAND_START,
+                                    sizeof(start), &start, NULL);
+            clGetEventProfilingInfo(events[eventCount - 1], CL_PROFILING_COMMAND_END,
+                                    sizeof(finish), &finish, NULL);
+        }
+        *nanoseconds = finish > start ? finish - start : 0;
+    }
+    for (int e = 0; e < eventCount; ++ e)
+    {
+        if (events[e])
+            clReleaseEvent(events[e]);
+    }
+    return r;
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLVectorized [elements [measure|preferred|1|2|4|8|16]]
+    // The default length deliberately isn't a multiple of any vector
+    // width, so that the tail path is exercised.
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) (1 << 22) + 13;
+    char const* selection = argc > 2 ? argv[2] : "measure";
+
+    // Get the list of platforms.
+    int const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint numPlatforms = 0;
+    cl_int r = clGetPlatformIDs(maxPlatformCount, &platforms[0], &numPlatforms);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: You may want to look at the list of platforms that are
+    // returned, and choose the most appropriate one for your needs.
+    int const platformToUse = 0;
+
+    // Get the devices available for the chosen platform.
+    cl_uint deviceCount = 0;
+    size_t const maxDeviceCount = 8;
+    cl_device_id devices[maxDeviceCount];
+    r = clGetDeviceIDs(platforms[platformToUse], CL_DEVICE_TYPE_ALL,
+                       maxDeviceCount, &devices[0], &deviceCount);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: If you have multiple devices, you may specify which one
+    // you'd like to use by changing this variable.
+    int const deviceToUse = 0;
+    cl_device_id device = devices[deviceToUse];
+
+    cl_context context = clCreateContext(0, 1, &device, NULL, NULL, &r);
+    if (0 == context || CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return value %p and code %d\n",
+               context, r);
+        return r;
+    }
+
+    // Profiling is enabled so that the widths can be timed.
+    cl_command_queue commandQueue = clCreateCommandQueue(context, device,
+                                    CL_QUEUE_PROFILING_ENABLE, &r);
+    if (0 == commandQueue || CL_SUCCESS != r)
+    {
+        printf("clCreateCommandQueue failed with return value %p and code %d\n",
+               commandQueue, r);
+        return r;
+    }
+
+    // Read the kernel source and build it.
+    FILE* kernelFile = fopen("kernel.cl", "rb");
+    if (NULL == kernelFile)
+    {
+        printf("Unable to open kernel source file\n");
+        return 1;
+    }
+    fseek(kernelFile, 0, SEEK_END);
+    long kernelSize = ftell(kernelFile);
+    fseek(kernelFile, 0, SEEK_SET);
+    char* kernelSource = (char*) malloc(kernelSize+1);
+    if (kernelSize != (long) fread(kernelSource, 1, kernelSize, kernelFile))
+    {
+        printf("Unable to read kernel source\n");
+        return 4;
+    }
+    fclose(kernelFile);
+    kernelSource[kernelSize] = 0;
+
+    const char* sourceLines[1] = {kernelSource};
+    cl_program program = clCreateProgramWithSource(context, 1,
+                         &sourceLines[0], NULL, &r);
+    free(kernelSource);
+    kernelSource = NULL;
+    if (0 == program || CL_SUCCESS != r)
+    {
+        printf("clCreateProgramWithSource failed with return value %p and code %d\n",
+               program, r);
+        return r;
+    }
+
+    r = clBuildProgram(program, 0, 0, 0, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("clBuildProgram failed with return value %d; error log:\n", r);
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG,
+                                            sizeof(buildLog), buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            printf("%s\n", buildLog);
+        }
+        return r;
+    }
+
+    // Create a kernel for each vector width.
+    cl_kernel kernels[WIDTH_COUNT];
+    for (int w = 0; w < WIDTH_COUNT; ++ w)
+    {
+        kernels[w] = clCreateKernel(program, kernelNames[w], &r);
+        if (0 == kernels[w] || CL_SUCCESS != r)
+        {
+            printf("clCreateKernel failed for %s with code %d\n",
+                   kernelNames[w], r);
+            return r;
+        }
+    }
+
+    // Allocate host memory for input and output vectors, and set values
+    // to something easy to verify.
+    float const a = 2.0f;
+    float* x = (float*) malloc(sizeof(float) * dimension);
+    float* y = (float*) malloc(sizeof(float) * dimension);
+    float* z = (float*) malloc(sizeof(float) * dimension);
+    if (NULL == x || NULL == y || NULL == z)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 - (float) i;
+        z[i] = - (float) i;
+    }
+
+    cl_mem devXmem = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                    dimension*sizeof(cl_float), x, &r);
+    cl_mem devYmem = 0;
+    cl_mem devZmem = 0;
+    if (CL_SUCCESS == r)
+        devYmem = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                 dimension*sizeof(cl_float), y, &r);
+    if (CL_SUCCESS == r)
+        devZmem = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+                                 dimension*sizeof(cl_float), NULL, &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    // Pick the vector width.
+    int chosen = -1;
+    if (0 == strcmp(selection, "preferred"))
+    {
+        // Use the widest supported width that doesn't exceed the device's
+        // preferred width.
+        cl_uint preferred = 1;
+        clGetDeviceInfo(device, CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT,
+                        sizeof(preferred), &preferred, NULL);
+        chosen = 0;
+        for (int w = 0; w < WIDTH_COUNT; ++ w)
+        {
+            if (widths[w] <= preferred)
+                chosen = w;
+        }
+        printf("Device prefers float%u\n", preferred);
+    }
+    else if (0 == strcmp(selection, "measure"))
+    {
+        // Time every width on the real problem and keep the fastest.  Each
+        // width runs a few times and its best time counts, so that a one-off
+        // hiccup doesn't decide the choice.
+        // TODO: For a problem that is run many times, the measurement only
+        // needs to happen once per device, and the choice could be saved
+        // between runs.
+        int const trials = 5;
+        cl_ulong bestTime = 0;
+        for (int w = 0; w < WIDTH_COUNT; ++ w)
+        {
+            cl_ulong widthTime = 0;
+            for (int t = 0; t < trials; ++ t)
+            {
+                cl_ulong time = 0;
+                r = runSaxpy(commandQueue, kernels, w, devXmem, devYmem,
+                             devZmem, a, dimension, &time);
+                if (CL_SUCCESS != r)
+                {
+                    printf("Running %s failed with code %d\n", kernelNames[w], r);
+                    return r;
+                }
+                if (0 == t || time < widthTime)
+                    widthTime = time;
+            }
+            printf("  float%-2zu %10.3f ms  %7.2f GB/s\n", widths[w],
+                   widthTime * 1e-6,
+                   widthTime ? 3.0 * dimension * sizeof(cl_float) / widthTime : 0.0);
+            if (chosen < 0 || widthTime < bestTime)
+            {
+                chosen = w;
+                bestTime = widthTime;
+            }
+        }
+    }
+    else
+    {
+        size_t const requested = (size_t) strtoul(selection, NULL, 10);
+        for (int w = 0; w < WIDTH_COUNT; ++ w)
+        {
+            if (widths[w] == requested)
+                chosen = w;
+        }
+        if (chosen < 0)
+        {
+            printf("Usage: %s [elements [measure|preferred|1|2|4|8|16]]\n", argv[0]);
+            return 1;
+        }
+    }
+    printf("Using %s for %zu elements (%zu in the scalar tail)\n",
+           kernelNames[chosen], dimension,
+           widths[chosen] > 1 ? dimension % widths[chosen] : dimension);
+
+    // The measurements left correct results in devZmem; fill it with NaN
+    // first, so that the check below sees only what this run writes.
+    float const sentinel = NAN;
+    r = clEnqueueFillBuffer(commandQueue, devZmem, &sentinel, sizeof(sentinel), 0,
+                            dimension*sizeof(cl_float), 0, NULL, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("clEnqueueFillBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    // Run the chosen variant and copy the results back to host memory.
+    r = runSaxpy(commandQueue, kernels, chosen, devXmem, devYmem, devZmem,
+                 a, dimension, NULL);
+    if (CL_SUCCESS != r)
+    {
+        printf("Running %s failed with code %d\n", kernelNames[chosen], r);
+        return r;
+    }
+    r = clEnqueueReadBuffer(commandQueue, devZmem, CL_TRUE, 0,
+                            dimension*sizeof(cl_float), z, 0, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("clEnqueueReadBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    // Check that results are correct, including the tail.  Note that the
+    // code below depends on the computation being exact, which may not be
+    // the case for more complicated computations.
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+        {
+            printf("Unexpected result at element %zu:\n", i);
+            printf(" x[i]*a + y[i] = %f * %f + %f != z[i] = %f\n",
+                   x[i], a, y[i], z[i]);
+            return 100;
+        }
+    }
+    printf("Computation appears to have completed successfully.\n");
+
+    // Free memory
+    free(x);
+    free(y);
+    free(z);
+
+    // Release device memory, kernels, program, command queue, and context.
+    clReleaseMemObject(devXmem);
+    clReleaseMemObject(devYmem);
+    clReleaseMemObject(devZmem);
+    for (int w = 0; w < WIDTH_COUNT; ++ w)
+    {
+        clReleaseKernel(kernels[w]);
+    }
+    clReleaseProgram(program);
+    clReleaseCommandQueue(commandQueue);
+    clReleaseContext(context);
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+// These kernels compute z = a*x + y on vectors of any length.
+//
+// saxpy2, saxpy4, saxpy8 and saxpy16 process 2, 4, 8 or 16 consecutive
+// floats per work-item with vloadN/vstoreN, for 'vectors' groups of N
+// floats.  Wide loads and stores are what lets CPU devices (and some GPUs)
+// reach full memory bandwidth.  saxpy1 processes one float per work-item;
+// it handles lengths that aren't a multiple of the vector width, by being
+// launched with a global offset over the last few elements.
+//
+// Every kernel checks its bound, so the global size may be rounded up to
+// a multiple of the work-group size.
+
+__kernel void saxpy1(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong count)
+{
+    // Get element index n, which includes any global offset.
+    size_t n = get_global_id(0);
+
+    if (n < count)
+    {
+        z[n] = a*x[n] + y[n];
+    }
+}
+
+#define DEFINE_SAXPY(WIDTH) \
+__kernel void saxpy##WIDTH(__global float const* x, __global float const* y, \
+    __global float* z, float a, ulong vectors) \
+{ \
+    size_t n = get_global_id(0); \
+\
+    if (n < vectors) \
+    { \
+        vstore##WIDTH(a*vload##WIDTH(n, x) + vload##WIDTH(n, y), n, z); \
+    } \
+}
+
+DEFINE_SAXPY(2)
+DEFINE_SAXPY(4)
+DEFINE_SAXPY(8)
+DEFINE_SAXPY(16)
@@ -0,0 +1,279 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <CL/opencl.h>
+#include "Verify.h"
+
+// This sample runs a saxpy (z=a*x+y) built with -cl-fast-relaxed-math and
+// checks the results with the verification engine in Verify.cpp, which
+// spreads the comparison across all CPU threads, compares 8 or 16 floats
+// at a time with AVX2 or AVX-512, and accepts values within a few ULPs of
+// the host's result.
+//
+// The Minimal sample checks the results with a single-threaded loop that
+// demands exact equality.  That is fine for a small exact problem, but on
+// hundreds of millions of elements the loop can take longer than the
+// kernel, and once the device is allowed to fuse the multiply and add, an
+// exact comparison reports differences that aren't errors.  This sample
+// times both ways of checking.
+
+// The device may contract a*x + y into a fused multiply-add.
+static char const* const buildOptions = "-cl-fast-relaxed-math";
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void printReport(char const* name, VerifyReport const* report,
+                        double seconds, size_t dimension)
+{
+    printf("%-28s %9.3f ms %8.2f GB/s  %s x %u, %zu mismatches, max %llu ULPs\n",
+           name, seconds * 1e3,
+           seconds > 0 ? 3.0 * dimension * sizeof(float) / seconds * 1e-9 : 0.0,
+           report->simd, report->threadCount, report->mismatchCount,
+           (unsigned long long) report->maxUlpError);
+}
+
+int main(int argc, char** argv)
+{
+    // OpenCLVerification [elements [maxUlps]]
+    size_t const dimension = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10)
+                                      : (size_t) 1 << 26;
+    VerifyOptions options;
+    verifyDefaultOptions(&options);
+    if (argc > 2)
+        options.maxUlps = (uint32_t) strtoul(argv[2], NULL, 10);
+
+    // Get the list of platforms.
+    int const maxPlatformCount = 8;
+    cl_platform_id platforms[maxPlatformCount];
+    cl_uint numPlatforms = 0;
+    cl_int r = clGetPlatformIDs(maxPlatformCount, &platforms[0], &numPlatforms);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetPlatformIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: You may want to look at the list of platforms that are
+    // returned, and choose the most appropriate one for your needs.
+    int const platformToUse = 0;
+
+    // Get the devices available for the chosen platform.
+    cl_uint deviceCount = 0;
+    size_t const maxDeviceCount = 8;
+    cl_device_id devices[maxDeviceCount];
+    r = clGetDeviceIDs(platforms[platformToUse], CL_DEVICE_TYPE_ALL,
+                       maxDeviceCount, &devices[0], &deviceCount);
+    if (r != CL_SUCCESS)
+    {
+        printf("clGetDeviceIDs failed with return code %d\n", r);
+        return r;
+    }
+
+    // TODO: If you have multiple devices, you may specify which one
+    // you'd like to use by changing this variable.
+    int const deviceToUse = 0;
+    cl_device_id device = devices[deviceToUse];
+
+    cl_context context = clCreateContext(0, 1, &device, NULL, NULL, &r);
+    if (0 == context || CL_SUCCESS != r)
+    {
+        printf("clCreateContext failed with return value %p and code %d\n",
+               context, r);
+        return r;
+    }
+
+    cl_command_queue commandQueue = clCreateCommandQueue(context, device, 0, &r);
+    if (0 == commandQueue || CL_SUCCESS != r)
+    {
+        printf("clCreateCommandQueue failed with return value %p and code %d\n",
+               commandQueue, r);
+        return r;
+    }
+
+    // Read the kernel source and build it.
+    FILE* kernelFile = fopen("kernel.cl", "rb");
+    if (NULL == kernelFile)
+    {
+        printf("Unable to open kernel source file\n");
+        return 1;
+    }
+    fseek(kernelFile, 0, SEEK_END);
+    long kernelSize = ftell(kernelFile);
+    fseek(kernelFile, 0, SEEK_SET);
+    char* kernelSource = (char*) malloc(kernelSize+1);
+    if (kernelSize != (long) fread(kernelSource, 1, kernelSize, kernelFile))
+    {
+        printf("Unable to read kernel source\n");
+        return 4;
+    }
+    fclose(kernelFile);
+    kernelSource[kernelSize] = 0;
+
+    const char* sourceLines[1] = {kernelSource};
+    cl_program program = clCreateProgramWithSource(context, 1,
+                         &sourceLines[0], NULL, &r);
+    free(kernelSource);
+    kernelSource = NULL;
+    if (0 == program || CL_SUCCESS != r)
+    {
+        printf("clCreateProgramWithSource failed with return value %p and code %d\n",
+               program, r);
+        return r;
+    }
+
+    r = clBuildProgram(program, 1, &device, buildOptions, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("clBuildProgram failed with return value %d; error log:\n", r);
+        char buildLog[1024*16];
+        cl_int rlog = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG,
+                                            sizeof(buildLog), buildLog, NULL);
+        if (CL_SUCCESS == rlog)
+        {
+            printf("%s\n", buildLog);
+        }
+        return r;
+    }
+
+    cl_kernel kernel = clCreateKernel(program, "saxpy", &r);
+    if (0 == kernel || CL_SUCCESS != r)
+    {
+        printf("clCreateKernel failed with return value %p and code %d\n",
+               kernel, r);
+        return r;
+    }
+
+    // Allocate host memory for input and output vectors.  Unlike the
+    // Minimal sample, a isn't a power of two, so a*x isn't exact and a
+    // fused multiply-add may round differently; y is positive so that
+    // a*x + y doesn't cancel, which would magnify a one-ULP difference in
+    // a*x into many ULPs of the result.
+    float const a = 1.1f;
+    float* x = (float*) malloc(sizeof(float) * dimension);
+    float* y = (float*) malloc(sizeof(float) * dimension);
+    float* z = (float*) malloc(sizeof(float) * dimension);
+    if (NULL == x || NULL == y || NULL == z)
+    {
+        printf("Unable to allocate host memory for %zu elements\n", dimension);
+        return 1;
+    }
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        x[i] = (float) i;
+        y[i] = 100 + (float) i;
+        z[i] = - (float) i;
+    }
+
+    cl_mem devXmem = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                    dimension*sizeof(cl_float), x, &r);
+    cl_mem devYmem = 0;
+    cl_mem devZmem = 0;
+    if (CL_SUCCESS == r)
+        devYmem = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                 dimension*sizeof(cl_float), y, &r);
+    if (CL_SUCCESS == r)
+        devZmem = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+                                 dimension*sizeof(cl_float), NULL, &r);
+    if (CL_SUCCESS != r)
+    {
+        printf("clCreateBuffer failed with return code %d\n", r);
+        return r;
+    }
+
+    cl_ulong const count = dimension;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &devXmem);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &devYmem);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &devZmem);
+    clSetKernelArg(kernel, 3, sizeof(cl_float), &a);
+    clSetKernelArg(kernel, 4, sizeof(cl_ulong), &count);
+
+    double const kernelStart = now();
+    r = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, &dimension, NULL,
+                               0, NULL, NULL);
+    if (CL_SUCCESS == r)
+        r = clFinish(commandQueue);
+    double const kernelTime = now() - kernelStart;
+    if (CL_SUCCESS != r)
+    {
+        printf("clEnqueueNDRangeKernel failed with return code %d\n", r);
+        return r;
+    }
+    r = clEnqueueReadBuffer(commandQueue, devZmem, CL_TRUE, 0,
+                            dimension*sizeof(cl_float), z, 0, 0, 0);
+    if (CL_SUCCESS != r)
+    {
+        printf("clEnqueueReadBuffer failed with return code %d\n", r);
+        return r;
+    }
+    printf("%-28s %9.3f ms\n", "Kernel", kernelTime * 1e3);
+
+    // The check the Minimal sample does: one thread, exact equality.
+    double start = now();
+    size_t exactMismatches = 0;
+    for (size_t i = 0; i < dimension; ++ i)
+    {
+        if (x[i]*a + y[i] != z[i])
+            ++ exactMismatches;
+    }
+    double const exactTime = now() - start;
+    printf("%-28s %9.3f ms %8.2f GB/s  %zu elements differ\n",
+           "Exact loop", exactTime * 1e3,
+           exactTime > 0 ? 3.0 * dimension * sizeof(float) / exactTime * 1e-9 : 0.0,
+           exactMismatches);
+
+    // The engine restricted to one thread and scalar code, to show what
+    // the threads and SIMD contribute.
+    VerifyReport report;
+    VerifyOptions scalarOptions = options;
+    scalarOptions.threadCount = 1;
+    scalarOptions.scalarOnly = 1;
+    start = now();
+    verifySaxpy(x, y, a, z, dimension, &scalarOptions, &report);
+    printReport("Engine, scalar, one thread", &report, now() - start, dimension);
+
+    // TODO: If the kernel computed something with a known error bound
+    // (e.g. native_ or half_ math functions), set maxUlps or
+    // maxRelativeError to match it.
+    start = now();
+    int const passed = verifySaxpy(x, y, a, z, dimension, &options, &report);
+    printReport("Engine", &report, now() - start, dimension);
+
+    if (!passed)
+    {
+        printf("%zu elements are more than %u ULPs off; the first ones are:\n",
+               report.mismatchCount, options.maxUlps);
+        for (unsigned m = 0; m < report.reportedCount; ++ m)
+        {
+            VerifyMismatch const* mismatch = &report.reported[m];
+            printf("  z[%zu] = %.9g, expected %.9g\n", mismatch->index,
+                   mismatch->actual, mismatch->expected);
+        }
+        return 100;
+    }
+    printf("Computation appears to have completed successfully "
+           "(max error %llu ULPs, %g absolute).\n",
+           (unsigned long long) report.maxUlpError, report.maxAbsoluteError);
+
+    // Free memory
+    free(x);
+    free(y);
+    free(z);
+
+    // Release device memory, kernel, program, command queue, and context.
+    clReleaseMemObject(devXmem);
+    clReleaseMemObject(devYmem);
+    clReleaseMemObject(devZmem);
+    clReleaseKernel(kernel);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(commandQueue);
+    clReleaseContext(context);
+
+    return 0;
+}
@@ -0,0 +1,408 @@
+#include "Verify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define VERIFY_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define VERIFY_X86 0
+#endif
+
+// GCC and Clang only emit AVX2/AVX-512 instructions in functions that ask
+// for them, which lets this file be built without -mavx2 and still run on
+// any x86 CPU.  MSVC accepts the intrinsics anywhere.
+#if VERIFY_X86 && defined(__GNUC__)
+#define VERIFY_TARGET(isa) __attribute__((target(isa)))
+#else
+#define VERIFY_TARGET(isa)
+#endif
+
+namespace
+{
+
+enum Isa
+{
+    ISA_SCALAR,
+    ISA_AVX2,
+    ISA_AVX512
+};
+
+char const* const isaNames[] = {"scalar", "avx2", "avx512"};
+
+// What the actual values are compared against: an array of expected
+// values, or (if 'expected' is NULL) the saxpy a*x + y.
+struct Source
+{
+    float const* expected;
+    float const* x;
+    float const* y;
+    float a;
+    float const* actual;
+};
+
+// The results of one thread's part of the range.
+struct Partial
+{
+    size_t mismatchCount;
+    uint64_t maxUlpError;
+    double maxAbsoluteError;
+    std::vector<VerifyMismatch> reported;
+};
+
+Isa detectIsa()
+{
+#if VERIFY_X86 && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return ISA_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return ISA_AVX2;
+#elif VERIFY_X86 && defined(_MSC_VER)
+    // The CPU must support the instructions, and the OS must save the
+    // wider registers (XCR0 bits for YMM, and for opmask/ZMM).
+    int info[4];
+    __cpuid(info, 1);
+    bool const osxsave = 0 != (info[2] & (1 << 27));
+    unsigned long long const xcr0 = osxsave ? _xgetbv(0) : 0;
+    __cpuidex(info, 7, 0);
+    if ((info[1] & (1 << 16)) && 0xe6 == (xcr0 & 0xe6))
+        return ISA_AVX512;
+    if ((info[1] & (1 << 5)) && 0x6 == (xcr0 & 0x6))
+        return ISA_AVX2;
+#endif
+    return ISA_SCALAR;
+}
+
+inline float expectedAt(Source const& s, size_t i)
+{
+    return s.expected ? s.expected[i] : s.a*s.x[i] + s.y[i];
+}
+
+// Map a float to an integer that grows monotonically with its value, so
+// that the difference between two of them is their distance in ULPs.
+inline int64_t orderedBits(float f)
+{
+    int32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits < 0 ? -(int64_t) (bits & 0x7fffffff) : (int64_t) bits;
+}
+
+inline void checkElement(size_t i, float expected, float actual,
+                         VerifyOptions const& options, Partial& partial)
+{
+    bool pass = false;
+    if (std::isnan(expected) || std::isnan(actual))
+    {
+        pass = std::isnan(expected) && std::isnan(actual);
+    }
+    else
+    {
+        int64_t const distance = orderedBits(actual) - orderedBits(expected);
+        uint64_t const ulps = (uint64_t) (distance < 0 ? -distance : distance);
+        double const error = actual == expected
+            ? 0.0 : std::fabs((double) actual - (double) expected);
+        pass = ulps <= options.maxUlps
+            || error <= options.maxRelativeError * std::fabs((double) expected);
+        partial.maxUlpError = std::max(partial.maxUlpError, ulps);
+        partial.maxAbsoluteError = std::max(partial.maxAbsoluteError, error);
+    }
+    if (!pass)
+    {
+        ++ partial.mismatchCount;
+        if (partial.reported.size() < options.maxReported)
+        {
+            VerifyMismatch const mismatch = {i, expected, actual};
+            partial.reported.push_back(mismatch);
+        }
+    }
+}
+
+void verifyScalar(Source const& s, size_t begin, size_t end,
+                  VerifyOptions const& options, Partial& partial)
+{
+    for (size_t i = begin; i < end; ++ i)
+    {
+        checkElement(i, expectedAt(s, i), s.actual[i], options, partial);
+    }
+}
+
+#if VERIFY_X86
+
+// The SIMD paths compute the ULP distance of every lane with 32-bit
+// integer arithmetic.  Lanes that may fail (too many ULPs, a NaN, or
+// differing signs, where the 32-bit distance could overflow) are handed to
+// checkElement, which makes the final decision; all other lanes pass and
+// only contribute to the error statistics.  Each returns the index where
+// it stopped, leaving the last few elements to the scalar path.
+
+VERIFY_TARGET("avx2")
+size_t verifyAvx2(Source const& s, size_t begin, size_t end,
+                  VerifyOptions const& options, Partial& partial)
+{
+    __m256 const a = _mm256_set1_ps(s.a);
+    __m256i const signBit = _mm256_set1_epi32((int) 0x80000000u);
+    __m256i const limit = _mm256_set1_epi32(
+        (int) std::min<uint32_t>(options.maxUlps, 0x7fffffff));
+    __m256 const absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256i maxUlps = _mm256_setzero_si256();
+    __m256 maxError = _mm256_setzero_ps();
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 const actual = _mm256_loadu_ps(s.actual + i);
+        __m256 const expected = s.expected
+            ? _mm256_loadu_ps(s.expected + i)
+            : _mm256_add_ps(_mm256_mul_ps(a, _mm256_loadu_ps(s.x + i)),
+                            _mm256_loadu_ps(s.y + i));
+        __m256i const actualBits = _mm256_castps_si256(actual);
+        __m256i const expectedBits = _mm256_castps_si256(expected);
+
+        // ordered = bits < 0 ? 0x80000000 - bits : bits
+        __m256i const actualOrdered = _mm256_castps_si256(_mm256_blendv_ps(
+            actual, _mm256_castsi256_ps(_mm256_sub_epi32(signBit, actualBits)),
+            actual));
+        __m256i const expectedOrdered = _mm256_castps_si256(_mm256_blendv_ps(
+            expected, _mm256_castsi256_ps(_mm256_sub_epi32(signBit, expectedBits)),
+            expected));
+        __m256i const ulps = _mm256_abs_epi32(
+            _mm256_sub_epi32(actualOrdered, expectedOrdered));
+
+        // Only the sign bit of each lane of 'suspect' matters.
+        __m256i const suspect = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpgt_epi32(ulps, limit),
+                            _mm256_xor_si256(actualBits, expectedBits)),
+            _mm256_castps_si256(_mm256_cmp_ps(actual, expected, _CMP_UNORD_Q)));
+        int const mask = _mm256_movemask_ps(_mm256_castsi256_ps(suspect));
+        __m256i const suspectLanes = _mm256_srai_epi32(suspect, 31);
+
+        maxUlps = _mm256_max_epi32(maxUlps,
+                                   _mm256_andnot_si256(suspectLanes, ulps));
+        // max_ps returns its second operand if either is NaN, which keeps
+        // the NaN from inf - inf out of the maximum.
+        __m256 const error = _mm256_andnot_ps(_mm256_castsi256_ps(suspectLanes),
+            _mm256_and_ps(absMask, _mm256_sub_ps(actual, expected)));
+        maxError = _mm256_max_ps(error, maxError);
+
+        if (mask)
+        {
+            for (int lane = 0; lane < 8; ++ lane)
+            {
+                if (mask & (1 << lane))
+                    checkElement(i + lane, expectedAt(s, i + lane),
+                                 s.actual[i + lane], options, partial);
+            }
+        }
+    }
+
+    int32_t ulpLanes[8];
+    float errorLanes[8];
+    _mm256_storeu_si256((__m256i*) ulpLanes, maxUlps);
+    _mm256_storeu_ps(errorLanes, maxError);
+    for (int lane = 0; lane < 8; ++ lane)
+    {
+        partial.maxUlpError = std::max(partial.maxUlpError, (uint64_t) ulpLanes[lane]);
+        partial.maxAbsoluteError = std::max(partial.maxAbsoluteError,
+                                            (double) errorLanes[lane]);
+    }
+    return i;
+}
+
+// GCC 12's AVX-512 headers use deliberately uninitialized values as the
+// pass-through operand of unmasked operations, which -Wall reports.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+VERIFY_TARGET("avx512f")
+size_t verifyAvx512(Source const& s, size_t begin, size_t end,
+                    VerifyOptions const& options, Partial& partial)
+{
+    __m512 const a = _mm512_set1_ps(s.a);
+    __m512i const zero = _mm512_setzero_si512();
+    __m512i const signBit = _mm512_set1_epi32((int) 0x80000000u);
+    __m512i const limit = _mm512_set1_epi32(
+        (int) std::min<uint32_t>(options.maxUlps, 0x7fffffff));
+    __m512i const absMask = _mm512_set1_epi32(0x7fffffff);
+    __m512i maxUlps = _mm512_setzero_si512();
+    __m512 maxError = _mm512_setzero_ps();
+
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16)
+    {
+        __m512 const actual = _mm512_loadu_ps(s.actual + i);
+        __m512 const expected = s.expected
+            ? _mm512_loadu_ps(s.expected + i)
+            : _mm512_add_ps(_mm512_mul_ps(a, _mm512_loadu_ps(s.x + i)),
+                            _mm512_loadu_ps(s.y + i));
+        __m512i const actualBits = _mm512_castps_si512(actual);
+        __m512i const expectedBits = _mm512_castps_si512(expected);
+        __mmask16 const actualNegative = _mm512_cmplt_epi32_mask(actualBits, zero);
+        __mmask16 const expectedNegative = _mm512_cmplt_epi32_mask(expectedBits, zero);
+
+        __m512i const actualOrdered = _mm512_mask_sub_epi32(
+            actualBits, actualNegative, signBit, actualBits);
+        __m512i const expectedOrdered = _mm512_mask_sub_epi32(
+            expectedBits, expectedNegative, signBit, expectedBits);
+        __m512i const ulps = _mm512_abs_epi32(
+            _mm512_sub_epi32(actualOrdered, expectedOrdered));
+
+        __mmask16 const suspect = _mm512_cmpgt_epi32_mask(ulps, limit)
+            | (actualNegative ^ expectedNegative)
+            | _mm512_cmp_ps_mask(actual, expected, _CMP_UNORD_Q);
+        __mmask16 const fine = (__mmask16) ~suspect;
+
+        maxUlps = _mm512_mask_max_epi32(maxUlps, fine, maxUlps, ulps);
+        __m512 const error = _mm512_castsi512_ps(_mm512_and_epi32(absMask,
+            _mm512_castps_si512(_mm512_sub_ps(actual, expected))));
+        maxError = _mm512_mask_max_ps(maxError, fine, error, maxError);
+
+        if (suspect)
+        {
+            for (int lane = 0; lane < 16; ++ lane)
+            {
+                if (suspect & (1 << lane))
+                    checkElement(i + lane, expectedAt(s, i + lane),
+                                 s.actual[i + lane], options, partial);
+            }
+        }
+    }
+
+    partial.maxUlpError = std::max(partial.maxUlpError,
+                                   (uint64_t) _mm512_reduce_max_epi32(maxUlps));
+    partial.maxAbsoluteError = std::max(partial.maxAbsoluteError,
+                                        (double) _mm512_reduce_max_ps(maxError));
+    return i;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+void verifyRange(Isa isa, Source const& s, size_t begin, size_t end,
+                 VerifyOptions const& options, Partial& partial)
+{
+#if VERIFY_X86
+    if (ISA_AVX512 == isa)
+        begin = verifyAvx512(s, begin, end, options, partial);
+    else if (ISA_AVX2 == isa)
+        begin = verifyAvx2(s, begin, end, options, partial);
+#else
+    (void) isa;
+#endif
+    verifyScalar(s, begin, end, options, partial);
+}
+
+int verify(Source const& s, size_t count, VerifyOptions const* userOptions,
+           VerifyReport* report)
+{
+    VerifyOptions options;
+    if (userOptions)
+        options = *userOptions;
+    else
+        verifyDefaultOptions(&options);
+    options.maxReported = std::min<unsigned>(options.maxReported,
+                                             VERIFY_MAX_REPORTED);
+
+    // Each thread gets at least 64K elements, so that small checks don't
+    // pay for starting threads.
+    unsigned threadCount = options.threadCount
+        ? options.threadCount : std::thread::hardware_concurrency();
+    size_t const minPerThread = 1 << 16;
+    threadCount = (unsigned) std::max<size_t>(1,
+        std::min<size_t>(threadCount ? threadCount : 1, count / minPerThread));
+    Isa const isa = options.scalarOnly ? ISA_SCALAR : detectIsa();
+
+    // Split the range into contiguous parts that start on a multiple of
+    // 16 elements.
+    size_t const part = ((count + threadCount - 1) / threadCount + 15)
+                        / 16 * 16;
+    std::vector<Partial> partials(threadCount, Partial());
+    auto work = [&](unsigned t)
+    {
+        size_t const begin = std::min(count, t * part);
+        size_t const end = std::min(count, begin + part);
+        verifyRange(isa, s, begin, end, options, partials[t]);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < threadCount; ++ t)
+    {
+        try
+        {
+            threads.emplace_back(work, t);
+        }
+        catch (std::system_error const&)
+        {
+            // If a thread can't be started, do its part here instead.
+            work(t);
+        }
+    }
+    work(0);
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Combine the parts in order, so the reported mismatches stay sorted.
+    VerifyReport result;
+    std::memset(&result, 0, sizeof(result));
+    for (auto const& p : partials)
+    {
+        result.mismatchCount += p.mismatchCount;
+        result.maxUlpError = std::max(result.maxUlpError, p.maxUlpError);
+        result.maxAbsoluteError = std::max(result.maxAbsoluteError,
+                                           p.maxAbsoluteError);
+        for (auto const& mismatch : p.reported)
+        {
+            if (result.reportedCount < options.maxReported)
+                result.reported[result.reportedCount++] = mismatch;
+        }
+    }
+    result.simd = isaNames[isa];
+    result.threadCount = threadCount;
+    if (report)
+        *report = result;
+    return 0 == result.mismatchCount;
+}
+
+}
+
+extern "C" void verifyDefaultOptions(VerifyOptions* options)
+{
+    std::memset(options, 0, sizeof(*options));
+    options->maxUlps = 4;
+    options->maxRelativeError = 0.0f;
+    options->threadCount = 0;
+    options->maxReported = 10;
+    options->scalarOnly = 0;
+}
+
+extern "C" int verifyArrays(float const* expected, float const* actual,
+                            size_t count, VerifyOptions const* options,
+                            VerifyReport* report)
+{
+    Source const s = {expected, NULL, NULL, 0.0f, actual};
+    return verify(s, count, options, report);
+}
+
+extern "C" int verifySaxpy(float const* x, float const* y, float a,
+                           float const* z, size_t count,
+                           VerifyOptions const* options, VerifyReport* report)
+{
+    Source const s = {NULL, x, y, a, z};
+    return verify(s, count, options, report);
+}
@@ -0,0 +1,79 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A verification engine for checking large GPU results on the host.  The
+// range is split across threads, and each thread compares 16 or 8 floats
+// at a time with AVX-512 or AVX2 when the CPU supports them (falling back
+// to scalar code otherwise).  Instead of demanding exact equality, a value
+// passes if it is within a number of units in the last place (ULPs) of
+// the expected value, or within a relative tolerance of it, so results
+// computed with FMA contraction or -cl-fast-relaxed-math still pass.
+//
+// The functions have C linkage so they can be called from the C samples.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VERIFY_MAX_REPORTED 32
+
+typedef struct
+{
+    // A value passes if it is at most maxUlps ULPs from the expected
+    // value, or if |actual - expected| <= maxRelativeError * |expected|.
+    // Two NaNs compare equal; a NaN and a number never do.
+    uint32_t maxUlps;
+    float maxRelativeError;
+    // Number of threads to use; 0 means one per hardware thread.
+    unsigned threadCount;
+    // How many of the first mismatches to report (at most
+    // VERIFY_MAX_REPORTED).
+    unsigned maxReported;
+    // Set to force the scalar path, e.g. to compare speeds.
+    int scalarOnly;
+} VerifyOptions;
+
+typedef struct
+{
+    size_t index;
+    float expected;
+    float actual;
+} VerifyMismatch;
+
+typedef struct
+{
+    size_t mismatchCount;
+    // The largest error seen over all elements, in ULPs and absolute.
+    uint64_t maxUlpError;
+    double maxAbsoluteError;
+    // The first mismatches, in index order.
+    unsigned reportedCount;
+    VerifyMismatch reported[VERIFY_MAX_REPORTED];
+    // The instruction set and number of threads that were used.
+    char const* simd;
+    unsigned threadCount;
+} VerifyReport;
+
+// Fill in the default options: 4 ULPs, no relative tolerance, all
+// hardware threads, and 10 reported mismatches.
+void verifyDefaultOptions(VerifyOptions* options);
+
+// Compare actual[i] with expected[i] for i < count.  Returns 1 if every
+// element passed.
+int verifyArrays(float const* expected, float const* actual, size_t count,
+                 VerifyOptions const* options, VerifyReport* report);
+
+// Compare z[i] with a*x[i] + y[i] for i < count, computing the expected
+// values on the fly.  Returns 1 if every element passed.
+int verifySaxpy(float const* x, float const* y, float a, float const* z,
+                size_t count, VerifyOptions const* options,
+                VerifyReport* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,19 @@
+// This kernel computes z = a*x + y over 'count' elements.
+//
+// The host builds it with -cl-fast-relaxed-math, which allows the
+// compiler to contract a*x + y into a fused multiply-add.  The result can
+// then differ from the host's separately rounded multiply and add in the
+// last bit, which is why the host compares within a few ULPs rather than
+// exactly.
+
+__kernel void saxpy(__global float const* x, __global float const* y,
+    __global float* z, float a, ulong count)
+{
+    // Get element index n.
+    size_t n = get_global_id(0);
+
+    if (n < count)
+    {
+        z[n] = a*x[n] + y[n];
+    }
+}
@@ -1,2 +1,3 @@
 CC = gcc
+CXX = g++
 OPENCL_INCLUDE = /opt/AMDAPP/include